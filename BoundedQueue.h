@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2016
+ *  Somebody
+ */
+#ifndef SPVR_BOUNDEDQUEUE_H
+#define SPVR_BOUNDEDQUEUE_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+
+#if defined(_WIN32)
+#include <malloc.h>
+#else // ! _WIN32
+#include <stdlib.h>
+#endif // ! _WIN32
+
+namespace spvr
+{
+
+// Bounded multi-producer multi-consumer queue (D. Vyukov's sequence-per-slot design).
+// TryPush and TryPop never block and never allocate, a full queue is reported to the caller.
+// The positions sit on their own cache lines; before C++17 a new-expression ignores that
+// alignment, so heap instances are allocated through the class's own operator new.
+template<typename T, std::size_t N>
+class BoundedQueue final
+{
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "BoundedQueue: capacity must be a power of two");
+    static_assert(std::is_trivially_copyable<T>::value, "BoundedQueue: T must be trivially copyable");
+
+public:
+    BoundedQueue():
+        m_aSlots{},
+        m_uEnqueuePos{0u},
+        m_uDequeuePos{0u}
+    {
+        for (std::size_t i = 0; i < N; ++i)
+        {
+            m_aSlots[i].m_uSequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    BoundedQueue(BoundedQueue const &) = delete;
+    BoundedQueue &operator=(BoundedQueue const &) = delete;
+
+    static void *operator new(std::size_t uSize)
+    {
+#if defined(_WIN32)
+        if (void *pMemory = _aligned_malloc(uSize, alignof(BoundedQueue)))
+        {
+            return pMemory;
+        }
+#else // ! _WIN32
+        void *pMemory = nullptr;
+        if (posix_memalign(&pMemory, alignof(BoundedQueue), uSize) == 0)
+        {
+            return pMemory;
+        }
+#endif // ! _WIN32
+        throw std::bad_alloc{};
+    }
+
+    static void operator delete(void *pMemory) noexcept
+    {
+#if defined(_WIN32)
+        _aligned_free(pMemory);
+#else // ! _WIN32
+        free(pMemory);
+#endif // ! _WIN32
+    }
+
+    // fills the slot in place through rFill(T &), returns false if the queue is full
+    template<typename Fill>
+    bool TryPush(Fill &&rFill)
+    {
+        auto uPos = m_uEnqueuePos.load(std::memory_order_relaxed);
+        while (true)
+        {
+            auto &rSlot = m_aSlots[uPos & (N - 1)];
+            auto const uSequence = rSlot.m_uSequence.load(std::memory_order_acquire);
+            auto const iDiff = static_cast<std::intptr_t>(uSequence) - static_cast<std::intptr_t>(uPos);
+            if (iDiff == 0)
+            {
+                if (m_uEnqueuePos.compare_exchange_weak(uPos, uPos + 1u, std::memory_order_relaxed))
+                {
+                    rFill(rSlot.m_oData);
+                    rSlot.m_uSequence.store(uPos + 1u, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (iDiff < 0)
+            {
+                return false;
+            }
+            else
+            {
+                uPos = m_uEnqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool TryPop(T &rData)
+    {
+        auto uPos = m_uDequeuePos.load(std::memory_order_relaxed);
+        while (true)
+        {
+            auto &rSlot = m_aSlots[uPos & (N - 1)];
+            auto const uSequence = rSlot.m_uSequence.load(std::memory_order_acquire);
+            auto const iDiff = static_cast<std::intptr_t>(uSequence) - static_cast<std::intptr_t>(uPos + 1u);
+            if (iDiff == 0)
+            {
+                if (m_uDequeuePos.compare_exchange_weak(uPos, uPos + 1u, std::memory_order_relaxed))
+                {
+                    rData = rSlot.m_oData;
+                    rSlot.m_uSequence.store(uPos + N, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (iDiff < 0)
+            {
+                return false;
+            }
+            else
+            {
+                uPos = m_uDequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+private:
+    struct Slot
+    {
+        std::atomic<std::size_t> m_uSequence;
+        T m_oData;
+    };
+
+    std::array<Slot, N> m_aSlots;
+    alignas(64) std::atomic<std::size_t> m_uEnqueuePos;
+    alignas(64) std::atomic<std::size_t> m_uDequeuePos;
+};
+
+} // namespace spvr
+
+#endif // SPVR_BOUNDEDQUEUE_H
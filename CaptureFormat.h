@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2016
+ *  Somebody
+ */
+#ifndef SPVR_CAPTUREFORMAT_H
+#define SPVR_CAPTUREFORMAT_H
+
+#include <atomic>
+#include <cstdint>
+
+namespace spvr
+{
+
+// On-disk layout of a packet capture, see PacketCapture. The file is a CaptureFileHeader
+// followed by m_uCapacity bytes of records. Every record is a CaptureRecordHeader and the
+// datagram as received, padded to 8 bytes. Records are only appended, m_uSize covers the
+// complete ones and is published after each record has been written.
+
+static char const S_aCaptureMagic[8] = {'S', 'P', 'V', 'R', 'C', 'A', 'P', '1'};
+static std::uint32_t const S_uCaptureVersion = 1u;
+
+struct CaptureFileHeader final
+{
+    char m_aMagic[8];
+    std::uint32_t m_uVersion;
+    std::uint32_t m_uReserved;
+    std::uint64_t m_uCapacity;
+    // bytes of complete records
+    alignas(64) std::atomic<std::uint64_t> m_uSize;
+    // datagrams that did not fit anymore
+    std::atomic<std::uint64_t> m_uDropped;
+    char m_aPadding[48];
+};
+
+struct CaptureRecordHeader final
+{
+    std::uint64_t m_uReceiveTimeNs; // steady clock, see Tracer::Now
+    std::uint32_t m_uSize;
+    std::uint32_t m_uReserved;
+};
+
+static_assert(sizeof(CaptureFileHeader) == 128, "CaptureFileHeader: unexpected size");
+static_assert(sizeof(CaptureRecordHeader) == 16, "CaptureRecordHeader: unexpected size");
+
+inline std::uint64_t GetCaptureRecordSize(std::uint32_t uDatagramSize)
+{
+    return sizeof(CaptureRecordHeader) + ((std::uint64_t{uDatagramSize} + 7u) & ~std::uint64_t{7u});
+}
+
+} // namespace spvr
+
+#endif // SPVR_CAPTUREFORMAT_H
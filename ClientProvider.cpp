@@ -6,8 +6,12 @@
 
 #include "Context.h"
 #include "ControlInterface.h"
+#include "DistortionTable.h"
+#include "HiddenAreaMesh.h"
+#include "LensState.h"
 #include "Logger.h"
 
+#include <cstddef>
 #include <cstring>
 #include <fstream>
 #include <memory>
@@ -23,8 +27,18 @@ static char const copyright_valve[] =
 static char const copyright[] =
 "Copyright (c) 2016\n\tSomebody.  All rights reserved.\n\n";
 
+// replaced meshes kept alive for callers still reading them, one per rebuild
+static std::size_t const S_uRetiredHiddenAreaMeshes = 4u;
+
 SmartClient::SmartClient():
-m_pLogger{}
+m_pLogger{},
+m_pDriverLog{},
+m_pControlInterface{},
+m_oDefaultParameters{},
+m_uHiddenAreaMeshGeneration{},
+m_oHiddenAreaMeshParameters{},
+m_vecHiddenAreaMesh{},
+m_deqRetiredHiddenAreaMeshes{}
 {
 
 }
@@ -44,14 +58,18 @@ vr::EVRInitError SmartClient::Init(vr::IDriverLog *pDriverLog, vr::IClientDriver
     Context *pContext = nullptr;
     try
     {
-        pContext = &Context::GetInstance();
+        pContext = &Context::Acquire();
     }
     catch (...)
     {
         return vr::VRInitError_Init_HmdNotFound;
     }
     m_pLogger = &pContext->GetLogger();
-    m_pLogger->AddDriverLog(pDriverLog);
+    if (pDriverLog)
+    {
+        m_pDriverLog = pDriverLog;
+        m_pLogger->AddDriverLog(pDriverLog);
+    }
 
     if (!pchUserDriverConfigDir)
     {
@@ -64,11 +82,51 @@ vr::EVRInitError SmartClient::Init(vr::IDriverLog *pDriverLog, vr::IClientDriver
 
     m_pLogger->Log(copyright_valve);
     m_pLogger->Log(copyright);
-    m_pLogger->Debug(std::string{"SmartClient::Init(\""} +pchUserDriverConfigDir + "\", \"" + pchDriverInstallDir + "\");\n");
-    vr::IVRSettings *pSettings = pDriverHost->GetSettings(vr::IVRSettings_Version);
+    SPVR_LOG_DEBUG(m_pLogger, std::string{"SmartClient::Init(\""} +pchUserDriverConfigDir + "\", \"" + pchDriverInstallDir + "\");\n");
+    try
+    {
+        vr::IVRSettings *pSettings = pDriverHost->GetSettings(vr::IVRSettings_Version);
+
+        m_pControlInterface = &pContext->GetControlInterface();
+        m_oDefaultParameters = ReadDefaultDistortionParameters(pSettings);
+        m_uHiddenAreaMeshGeneration = ReadDistortionParameters(*m_pControlInterface, m_oDefaultParameters, m_oHiddenAreaMeshParameters);
+        m_vecHiddenAreaMesh = BuildHiddenAreaMesh(m_oHiddenAreaMeshParameters);
+    }
+    catch (...)
+    {
+        m_pLogger->Log("Initialization of SmartClient failed!\n");
+        // the module is unloaded right after a failed Init, Cleanup is not called
+        Cleanup();
+        return vr::VRInitError_Init_HmdNotFound;
+    }
+
     return vr::EVRInitError::VRInitError_None;
 }
 
+void SmartClient::RebuildHiddenAreaMesh()
+{
+    // the same parameters the driver's LensStateUpdater publishes, this process has no updater
+    DistortionParameters oParameters{};
+    m_uHiddenAreaMeshGeneration = ReadDistortionParameters(*m_pControlInterface, m_oDefaultParameters, oParameters);
+    if (oParameters == m_oHiddenAreaMeshParameters)
+    {
+        // the generation also moves for parameters the mesh does not depend on
+        return;
+    }
+    m_oHiddenAreaMeshParameters = oParameters;
+    if (!m_vecHiddenAreaMesh.empty())
+    {
+        m_deqRetiredHiddenAreaMeshes.push_back(std::move(m_vecHiddenAreaMesh));
+    }
+    m_vecHiddenAreaMesh = BuildHiddenAreaMesh(oParameters);
+    while (m_deqRetiredHiddenAreaMeshes.size() > S_uRetiredHiddenAreaMeshes)
+    {
+        m_deqRetiredHiddenAreaMeshes.pop_front();
+    }
+    SPVR_LOG_DEBUG(m_pLogger, std::string{"SmartClient::RebuildHiddenAreaMesh() => generation "} + std::to_string(m_uHiddenAreaMeshGeneration)
+        + ", " + std::to_string(m_vecHiddenAreaMesh.size() / 3u) + " triangles\n");
+}
+
 /** cleans up the driver right before it is unloaded */
 void SmartClient::Cleanup()
 {
@@ -76,7 +134,19 @@ void SmartClient::Cleanup()
     {
         m_pLogger->Log("SmartClient::Cleanup()\n");
     }*/
-    //Context::Destroy();
+    m_deqRetiredHiddenAreaMeshes.clear();
+    m_pControlInterface = nullptr;
+    if (m_pLogger)
+    {
+        m_pLogger->Flush();
+        if (m_pDriverLog)
+        {
+            m_pLogger->RemoveDriverLog(m_pDriverLog);
+            m_pDriverLog = nullptr;
+        }
+        m_pLogger = nullptr;
+        Context::Release();
+    }
 }
 
 /** Called when the client needs to inform an application if an HMD is attached that uses
@@ -90,10 +160,7 @@ bool SmartClient::BIsHmdPresent(char const *pchUserConfigDir)
     {
         pchUserConfigDir = "nullptr";
     }
-    if (m_pLogger)
-    {
-        m_pLogger->Debug(std::string{"SmartClient::BIsHmdPresent(\""} +pchUserConfigDir + "\")\n");
-    }
+    SPVR_LOG_DEBUG(m_pLogger, std::string{"SmartClient::BIsHmdPresent(\""} +pchUserConfigDir + "\")\n");
     return false;
 }
 
@@ -104,7 +171,7 @@ vr::EVRInitError SmartClient::SetDisplayId(char const *pchDisplayId)
     {
         pchDisplayId = "nullptr";
     }
-    m_pLogger->Debug(std::string{"SmartClient::SetDisplayId(\""} +pchDisplayId + "\")\n");
+    SPVR_LOG_DEBUG(m_pLogger, std::string{"SmartClient::SetDisplayId(\""} +pchDisplayId + "\")\n");
     return vr::VRInitError_None;
 }
 
@@ -116,15 +183,28 @@ vr::EVRInitError SmartClient::SetDisplayId(char const *pchDisplayId)
 */
 vr::HiddenAreaMesh_t SmartClient::GetHiddenAreaMesh(vr::EVREye eEye)
 {
-    m_pLogger->Debug(std::string{"SmartClient::GetHiddenAreaMesh("} +std::to_string(eEye) + ")\n");
-    return vr::HiddenAreaMesh_t{nullptr, 0u};
+    SPVR_LOG_DEBUG(m_pLogger, std::string{"SmartClient::GetHiddenAreaMesh("} +std::to_string(eEye) + ")\n");
+    if (eEye != vr::Eye_Left && eEye != vr::Eye_Right)
+    {
+        return vr::HiddenAreaMesh_t{nullptr, 0u};
+    }
+    if (m_pControlInterface && m_pControlInterface->GetParameterGeneration() != m_uHiddenAreaMeshGeneration)
+    {
+        RebuildHiddenAreaMesh();
+    }
+    auto const &vecMesh = m_vecHiddenAreaMesh;
+    if (vecMesh.empty())
+    {
+        return vr::HiddenAreaMesh_t{nullptr, 0u};
+    }
+    return vr::HiddenAreaMesh_t{vecMesh.data(), static_cast<std::uint32_t>(vecMesh.size() / 3u)};
 }
 
 /** Get the MC image for the current HMD.
 * Returns the size in bytes of the buffer required to hold the specified resource. */
 uint32_t SmartClient::GetMCImage(std::uint32_t *pImgWidth, std::uint32_t *pImgHeight, std::uint32_t *pChannels, void *pDataBuffer, std::uint32_t unBufferLen)
 {
-    m_pLogger->Debug("SmartClient::GetMCImage(...)\n");
+    SPVR_LOG_DEBUG(m_pLogger, "SmartClient::GetMCImage(...)\n");
     return 0;
 }
 
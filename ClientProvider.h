@@ -5,13 +5,17 @@
 #ifndef SPVR_CLIENTPROVIDER_H
 #define SPVR_CLIENTPROVIDER_H
 
+#include "DistortionTable.h"
 #include "openvr_driver.h"
 
 #include <cstdint>
+#include <deque>
+#include <vector>
 
 namespace spvr
 {
 
+class ControlInterface;
 class Logger;
 
 class SmartClient final : public vr::IClientTrackedDeviceProvider
@@ -55,6 +59,22 @@ public:
     /** Get the MC image for the current HMD.
     * Returns the size in bytes of the buffer required to hold the specified resource. */
     virtual std::uint32_t GetMCImage(std::uint32_t *pImgWidth, std::uint32_t *pImgHeight, std::uint32_t *pChannels, void *pDataBuffer, std::uint32_t unBufferLen) override;
+
+private:
+    // builds the meshes from the current lens parameters unless the meshes already match them
+    void RebuildHiddenAreaMesh();
+
+    // registered with the context's logger from Init to Cleanup
+    vr::IDriverLog *m_pDriverLog;
+    ControlInterface *m_pControlInterface;
+    DistortionParameters m_oDefaultParameters;
+    std::uint32_t m_uHiddenAreaMeshGeneration;
+    DistortionParameters m_oHiddenAreaMeshParameters;
+    // GetHiddenAreaMesh hands out pointers into these; the compositor copies a mesh when it
+    // asks for it, so only the meshes of the last few rebuilds are kept alive for late readers.
+    // The lens model is centered in each eye's viewport, both eyes share one mesh.
+    std::vector<vr::HmdVector2_t> m_vecHiddenAreaMesh;
+    std::deque<std::vector<vr::HmdVector2_t>> m_deqRetiredHiddenAreaMeshes;
 };
 
 } // namespace spvr
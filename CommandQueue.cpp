@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2016
+ *  Somebody
+ */
+#include "CommandQueue.h"
+
+namespace spvr
+{
+
+CommandQueue::CommandQueue():
+    m_uHead{0u},
+    m_uTail{0u},
+    m_aCommands{},
+    m_aResults{}
+{
+    static_assert((S_uCapacity & (S_uCapacity - 1u)) == 0u, "CommandQueue: capacity must be a power of two");
+    static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "CommandQueue: 64 bit atomics must be lock-free to be shared between processes");
+}
+
+std::uint64_t CommandQueue::TryPush(CommandType eType, std::int64_t iArg0, std::int64_t iArg1)
+{
+    auto const uHead = m_uHead.load(std::memory_order_relaxed);
+    if (uHead - m_uTail.load(std::memory_order_acquire) >= S_uCapacity)
+    {
+        return 0u;
+    }
+    auto const uSequence = uHead + 1u;
+    auto &rCommand = m_aCommands[uHead & (S_uCapacity - 1u)];
+    rCommand.m_uSequence = uSequence;
+    rCommand.m_eType = eType;
+    rCommand.m_uReserved = 0u;
+    rCommand.m_aArgs[0] = iArg0;
+    rCommand.m_aArgs[1] = iArg1;
+    m_uHead.store(uHead + 1u, std::memory_order_release);
+    return uSequence;
+}
+
+CommandStatus CommandQueue::GetStatus(std::uint64_t uSequence) const
+{
+    if (uSequence == 0u || uSequence > m_uHead.load(std::memory_order_relaxed))
+    {
+        return CommandStatus::Unknown;
+    }
+    auto const &rResult = m_aResults[(uSequence - 1u) & (S_uCapacity - 1u)];
+    auto const uCompleted = rResult.m_uSequence.load(std::memory_order_acquire);
+    if (uCompleted < uSequence)
+    {
+        return CommandStatus::Pending;
+    }
+    auto const iStatus = rResult.m_iStatus.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (uCompleted != uSequence || rResult.m_uSequence.load(std::memory_order_relaxed) != uSequence)
+    {
+        return CommandStatus::Unknown;
+    }
+    return static_cast<CommandStatus>(iStatus);
+}
+
+bool CommandQueue::TryPop(Command &oCommand)
+{
+    auto const uTail = m_uTail.load(std::memory_order_relaxed);
+    if (uTail == m_uHead.load(std::memory_order_acquire))
+    {
+        return false;
+    }
+    oCommand = m_aCommands[uTail & (S_uCapacity - 1u)];
+    m_uTail.store(uTail + 1u, std::memory_order_release);
+    return true;
+}
+
+void CommandQueue::Complete(std::uint64_t uSequence, CommandStatus eStatus)
+{
+    auto &rResult = m_aResults[(uSequence - 1u) & (S_uCapacity - 1u)];
+    // invalidate, write, publish, GetStatus re-checks the sequence after reading the status
+    rResult.m_uSequence.store(0u, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    rResult.m_iStatus.store(static_cast<std::int32_t>(eStatus), std::memory_order_relaxed);
+    rResult.m_uSequence.store(uSequence, std::memory_order_release);
+}
+
+} // namespace spvr
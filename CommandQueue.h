@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2016
+ *  Somebody
+ */
+#ifndef SPVR_COMMANDQUEUE_H
+#define SPVR_COMMANDQUEUE_H
+
+#include <atomic>
+#include <cstdint>
+
+namespace spvr
+{
+
+enum class CommandType : std::uint32_t
+{
+    None = 0,
+    Recenter = 1,       // makes the current heading the forward direction
+    ResetFilter = 2,    // accepts the next packet regardless of its counter, e.g. after the phone app restarted
+    SetPort = 3,        // args: udp port to receive poses on
+    DumpStats = 4,      // writes the driver's counters to the log
+};
+
+enum class CommandStatus : std::int32_t
+{
+    Pending = 0,
+    Done = 1,
+    Failed = 2,
+    Unsupported = 3,
+    // the command is too old, its result was overwritten
+    Unknown = 4,
+};
+
+struct Command final
+{
+    // assigned on submission, starts at 1
+    std::uint64_t m_uSequence;
+    CommandType m_eType;
+    std::uint32_t m_uReserved;
+    std::int64_t m_aArgs[2];
+};
+
+// Bounded single-producer (control app) single-consumer (driver) ring of fixed-size
+// commands in shared memory. The driver acknowledges every command it took with a
+// status, the control app polls GetStatus with the sequence TryPush returned.
+class CommandQueue final
+{
+public:
+    static std::uint32_t const S_uCapacity = 64u;
+
+    CommandQueue();
+    CommandQueue(CommandQueue const &) = delete;
+    CommandQueue &operator=(CommandQueue const &) = delete;
+
+    // producer side, returns the command's sequence or 0 if the queue is full
+    std::uint64_t TryPush(CommandType eType, std::int64_t iArg0, std::int64_t iArg1);
+    CommandStatus GetStatus(std::uint64_t uSequence) const;
+
+    // consumer side
+    bool TryPop(Command &oCommand);
+    void Complete(std::uint64_t uSequence, CommandStatus eStatus);
+
+private:
+    struct Result
+    {
+        std::atomic<std::uint64_t> m_uSequence;
+        std::atomic<std::int32_t> m_iStatus;
+    };
+
+    // written by the producer only
+    alignas(64) std::atomic<std::uint64_t> m_uHead;
+    // written by the consumer only
+    alignas(64) std::atomic<std::uint64_t> m_uTail;
+    alignas(64) Command m_aCommands[S_uCapacity];
+    Result m_aResults[S_uCapacity];
+};
+
+} // namespace spvr
+
+#endif // SPVR_COMMANDQUEUE_H
@@ -6,7 +6,10 @@
 
 #include "ControlInterface.h"
 #include "Logger.h"
+#include "Tracer.h"
 
+#include <atomic>
+#include <cstdint>
 #include <mutex>
 
 namespace spvr
@@ -14,45 +17,73 @@ namespace spvr
 
 namespace
 {
+// serializes creation and destruction only, see Context::GetInstance
 static std::mutex S_oMutex{};
-static std::unique_ptr<Context> S_pContext{};
+static std::atomic<Context *> S_pContext{nullptr};
+// holders between Acquire and Release, guarded by S_oMutex
+static std::uint32_t S_uHolders = 0u;
 } // unnamed namespace
 
 Context::Context():
 m_pControlInterface{std::make_unique<ControlInterface>()},
-m_pLogger{std::make_unique<Logger>(m_pControlInterface.get())}
+m_pLogger{std::make_unique<Logger>(m_pControlInterface.get())},
+m_pTracer{std::make_unique<Tracer>()}
 {
-    m_pLogger->Debug(std::string{"Context::Context()@"} +std::to_string(reinterpret_cast<long long int>(this)) + '\n');
+    SPVR_LOG_DEBUG(m_pLogger.get(), std::string{"Context::Context()@"} +std::to_string(reinterpret_cast<long long int>(this)) + '\n');
 }
 
 //Context::~Context() = default;
 Context::~Context()
 {
-    if (m_pLogger)
-    {
-        m_pLogger->Debug(std::string{"Context::~Context()@"} +std::to_string(reinterpret_cast<long long int>(this)) + '\n');
-    }
+    SPVR_LOG_DEBUG(m_pLogger.get(), std::string{"Context::~Context()@"} +std::to_string(reinterpret_cast<long long int>(this)) + '\n');
 }
 
 Context &Context::GetInstance()
 {
-    static std::mutex S_oMutexLocal{};
+    auto *pContext = S_pContext.load(std::memory_order_acquire);
+    if (pContext)
+    {
+        return *pContext;
+    }
+
     std::lock_guard<std::mutex> oLock{S_oMutex};
-    if (!S_pContext)
+    pContext = S_pContext.load(std::memory_order_relaxed);
+    if (!pContext)
     {
-        S_pContext.reset(new Context{});
+        pContext = new Context{};
+        S_pContext.store(pContext, std::memory_order_release);
     }
-    return *S_pContext;
+    return *pContext;
 }
 
 void Context::Destroy()
 {
-    static std::mutex S_oMutexLocal{};
     std::lock_guard<std::mutex> oLock{S_oMutex};
-    if (S_pContext)
+    S_uHolders = 0u;
+    delete S_pContext.exchange(nullptr, std::memory_order_acq_rel);
+}
+
+Context &Context::Acquire()
+{
+    std::lock_guard<std::mutex> oLock{S_oMutex};
+    auto *pContext = S_pContext.load(std::memory_order_relaxed);
+    if (!pContext)
     {
-        S_pContext.reset();
+        pContext = new Context{};
+        S_pContext.store(pContext, std::memory_order_release);
     }
+    ++S_uHolders;
+    return *pContext;
+}
+
+void Context::Release()
+{
+    std::lock_guard<std::mutex> oLock{S_oMutex};
+    if (S_uHolders == 0u || --S_uHolders != 0u)
+    {
+        return;
+    }
+    delete S_pContext.exchange(nullptr, std::memory_order_acq_rel);
 }
 
 ControlInterface &Context::GetControlInterface()
@@ -65,4 +96,9 @@ Logger &Context::GetLogger()
     return *m_pLogger;
 }
 
+Tracer &Context::GetTracer()
+{
+    return *m_pTracer;
+}
+
 } // namespace spvr
@@ -14,6 +14,7 @@ namespace spvr
 
 class ControlInterface;
 class Logger;
+class Tracer;
 
 class Context final
 {
@@ -23,15 +24,24 @@ class Context final
 
 public:
     ~Context();
+    // Creates the context on first use, afterwards a single acquire load. References
+    // obtained here must not outlive Destroy, which is only safe once every thread
+    // that uses the context (pose, network, lens threads) has been joined.
     static Context &GetInstance();
     static void Destroy();
+    // The providers hold the context from Init to Cleanup, the server and the client can
+    // share one process. Release destroys the context when the last holder lets go.
+    static Context &Acquire();
+    static void Release();
 
     ControlInterface &GetControlInterface();
     Logger &GetLogger();
+    Tracer &GetTracer();
 
 private:
     std::unique_ptr<ControlInterface> m_pControlInterface;
     std::unique_ptr<Logger> m_pLogger;
+    std::unique_ptr<Tracer> m_pTracer;
 };
 
 } // namespace spvr
@@ -4,13 +4,23 @@
  */
 #include "ControlInterface.h"
 
-#include <boost/interprocess/mapped_region.hpp>
-#include <boost/interprocess/windows_shared_memory.hpp>
+#include "CommandQueue.h"
+#include "PoseHistory.h"
+#include "SharedMemoryLayout.h"
+#include "SharedMemorySegment.h"
+#include "ShmLog.h"
+#include "ShmNotifier.h"
+#include "Telemetry.h"
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
 #include <cstring>
 #include <mutex>
+#include <new>
 #include <string>
+#include <thread>
 
 namespace spvr
 {
@@ -18,8 +28,6 @@ namespace spvr
 namespace
 {
 
-using namespace boost::interprocess;
-
 enum ShmConfig
 {
     DRIVER,
@@ -33,118 +41,354 @@ static ShmConfig const S_eShmMode = ShmConfig::CONTROL;
 #endif // ! SPVR_SHM_DRIVER
 static const char S_aShmName[] = "SmartPhoneVR SHM";
 
-class ShmLog final
+// capacity of the log ring in bytes
+static std::size_t const S_uLogCapacity = 64u * 1024u;
+// pose samples kept for external readers, about 4 s at 1 kHz
+static std::size_t const S_uPoseHistoryCapacity = 4096u;
+// how long an attaching process waits for the creator to finish the layout
+static auto const S_oReadyTimeout = std::chrono::seconds{1};
+// a parameter write takes a few stores, one that is still in progress after this long was
+// abandoned by a crashed writer and is completed by whoever waits for it
+static auto const S_oAbandonedWriteTimeout = std::chrono::milliseconds{100};
+
+// section versions, only bumped on incompatible changes, appending fields is compatible
+static std::uint32_t const S_uControlSectionVersion = 3u;
+static std::uint32_t const S_uLogSectionVersion = 1u;
+static std::uint32_t const S_uPoseHistorySectionVersion = 2u;
+static std::uint32_t const S_uNotifierSectionVersion = 2u;
+static std::uint32_t const S_uCommandSectionVersion = 1u;
+static std::uint32_t const S_uTelemetrySectionVersion = 3u;
+
+// Every region has a single writer and a cache line of its own, so the pose written by
+// the network thread at packet rate never invalidates the line holding the parameters.
+struct ControlSection final
 {
-    static std::size_t const S_iLineLength = 256;
-    static std::size_t const S_iLines = 64;
-public:
-    ShmLog():
-        m_aLogLines{} // important! initialized memory!
-    {
+    // hot, written by the driver's network thread
+    alignas(S_uShmSectionAlignment) glm::quat m_qRotation{1.0f, 0.0f, 0.0f, 0.0f};
 
-    }
+    // cold, written by the control app, read once per frame by the driver
+    // seqlock over the lens parameters below, see ParameterWriteGuard; readers may have to
+    // complete a write abandoned by a crashed writer, see WaitForCompletedWrite
+    alignas(S_uShmSectionAlignment) mutable std::atomic<std::uint32_t> m_uParameterGeneration{0u};
+
+    // radial distortion coefficients Ki for google cardboard v1: 0.441, 0.156
+    float m_fDistortionK0 = 0.441f;
+    float m_fDistortionK1 = 0.156f;
+    float m_fDistortionScale = 1.0f;
+    // not a lens parameter and outside the seqlock, a single float read with every pose
+    float m_fHeight = 1.5f;
+    // S_uWritten* bits of the parameters a writer has set, the others are still the
+    // initial values above and readers substitute their own defaults for them
+    std::uint32_t m_uWrittenParameters = 0u;
+};
 
-    void Log(std::string const &strMsg)
+static std::uint32_t const S_uWrittenCoefficients = 1u;
+static std::uint32_t const S_uWrittenScale = 2u;
+
+static_assert(alignof(ControlSection) <= S_uShmSectionAlignment, "ControlSection: alignment exceeds the section alignment");
+static_assert(alignof(ShmLog) <= S_uShmSectionAlignment, "ShmLog: alignment exceeds the section alignment");
+static_assert(alignof(PoseHistory) <= S_uShmSectionAlignment, "PoseHistory: alignment exceeds the section alignment");
+static_assert(alignof(ShmNotifier) <= S_uShmSectionAlignment, "ShmNotifier: alignment exceeds the section alignment");
+static_assert(alignof(CommandQueue) <= S_uShmSectionAlignment, "CommandQueue: alignment exceeds the section alignment");
+static_assert(alignof(Telemetry) <= S_uShmSectionAlignment, "Telemetry: alignment exceeds the section alignment");
+static_assert(S_uShmMaxSections <= ShmNotifier::S_uChannels, "ShmNotifier: needs one channel per section id");
+
+// Returns the generation once no write is in progress. A write that stays in progress for
+// S_oAbandonedWriteTimeout lost its writer, the generation is completed on its behalf and
+// whatever the writer managed to store stands.
+std::uint32_t WaitForCompletedWrite(std::atomic<std::uint32_t> &rGeneration)
+{
+    auto uGeneration = rGeneration.load(std::memory_order_acquire);
+    if ((uGeneration & 1u) == 0u)
+    {
+        return uGeneration;
+    }
+    auto const oDeadline = std::chrono::steady_clock::now() + S_oAbandonedWriteTimeout;
+    while ((uGeneration & 1u) != 0u)
     {
-        if (m_iLinesUnread >= S_iLines)
+        if (std::chrono::steady_clock::now() < oDeadline)
         {
-            return;
+            std::this_thread::yield();
+            uGeneration = rGeneration.load(std::memory_order_acquire);
+        }
+        else if (rGeneration.compare_exchange_strong(uGeneration, uGeneration + 1u, std::memory_order_acq_rel))
+        {
+            ++uGeneration;
         }
-        auto const iCharsToCopy = std::min(S_iLineLength, strMsg.size());
-        auto itOut = &m_aLogLines[m_iNextWrite * S_iLineLength];
-        m_iNextWrite = (m_iNextWrite + 1) % S_iLines;
-        ++m_iLinesUnread;
-        std::copy(begin(strMsg), begin(strMsg) + iCharsToCopy, itOut);
-        itOut[iCharsToCopy] = '\0';
     }
+    return uGeneration;
+}
 
-    std::string const GetLine(std::size_t iLine) const
+// serializes writers (control app and driver) and makes the generation odd while writing,
+// waiters on the control channel are notified once the write is complete
+class ParameterWriteGuard final
+{
+public:
+    ParameterWriteGuard(std::atomic<std::uint32_t> &rGeneration, ShmNotifier *pNotifier):
+        m_rGeneration(rGeneration),
+        m_pNotifier{pNotifier},
+        m_uGeneration{WaitForCompletedWrite(rGeneration)}
     {
-        return std::string{const_cast<char const *>(&m_aLogLines[iLine * S_iLineLength])};
+        while (!m_rGeneration.compare_exchange_weak(m_uGeneration, m_uGeneration + 1u, std::memory_order_acquire))
+        {
+            m_uGeneration = WaitForCompletedWrite(m_rGeneration);
+        }
+        std::atomic_thread_fence(std::memory_order_release);
     }
 
-    std::string const GetNext()
+    ~ParameterWriteGuard()
     {
-        if (m_iLinesUnread > 0)
+        // fails if a waiter took this write for abandoned and completed it already
+        auto uGeneration = m_uGeneration + 1u;
+        m_rGeneration.compare_exchange_strong(uGeneration, m_uGeneration + 2u, std::memory_order_release, std::memory_order_relaxed);
+        if (m_pNotifier)
         {
-            auto const iLineIndex = m_iNextRead;
-            m_iNextRead = (m_iNextRead + 1) % S_iLines;
-            --m_iLinesUnread;
-            return GetLine(iLineIndex);
+            m_pNotifier->Notify(static_cast<std::uint32_t>(ShmSectionId::Control));
         }
-        return "";
     }
 
+    ParameterWriteGuard(ParameterWriteGuard const &) = delete;
+    ParameterWriteGuard &operator=(ParameterWriteGuard const &) = delete;
+
 private:
-    std::size_t volatile m_iLinesUnread = 0;
-    std::size_t volatile m_iNextRead = 0;
-    std::size_t volatile m_iNextWrite = 0;
-    char volatile m_aLogLines[S_iLineLength * S_iLines];
+    std::atomic<std::uint32_t> &m_rGeneration;
+    ShmNotifier *m_pNotifier;
+    // the even generation this write started from
+    std::uint32_t m_uGeneration;
 };
 
-struct SharedMemoryContent final
+// sections this build creates, in segment order
+class SegmentLayout final
 {
-    SharedMemoryContent() = default;
-    ~SharedMemoryContent() = default;
+public:
+    SegmentLayout():
+        m_aSections{},
+        m_uSectionCount{0u},
+        m_uSize{AlignUp(sizeof(SharedMemoryHeader))}
+    {
+        Add(ShmSectionId::Control, S_uControlSectionVersion, sizeof(ControlSection));
+        Add(ShmSectionId::Log, S_uLogSectionVersion, sizeof(ShmLog));
+        Add(ShmSectionId::LogStorage, S_uLogSectionVersion, ShmLog::GetStorageSize(S_uLogCapacity));
+        Add(ShmSectionId::PoseHistory, S_uPoseHistorySectionVersion, sizeof(PoseHistory));
+        Add(ShmSectionId::PoseHistoryStorage, S_uPoseHistorySectionVersion, PoseHistory::GetStorageSize(S_uPoseHistoryCapacity));
+        Add(ShmSectionId::Notifier, S_uNotifierSectionVersion, sizeof(ShmNotifier));
+        Add(ShmSectionId::Commands, S_uCommandSectionVersion, sizeof(CommandQueue));
+        Add(ShmSectionId::Telemetry, S_uTelemetrySectionVersion, sizeof(Telemetry));
+    }
 
-    ShmLog Log;
-    glm::quat m_qRotation;
+    ShmSectionEntry const *GetSections() const
+    {
+        return m_aSections;
+    }
 
-    // radial distortion coefficients Ki for google cardboard v1: 0.441, 0.156
-    float m_fDistortionK0 = 0.441f;
-    float m_fDistortionK1 = 0.156f;
-    float m_fDistortionScale = 1.0f;
-    float m_fHeight = 1.5f;
+    std::uint32_t GetSectionCount() const
+    {
+        return m_uSectionCount;
+    }
+
+    std::size_t GetSize() const
+    {
+        return m_uSize;
+    }
+
+private:
+    static std::size_t AlignUp(std::size_t uSize)
+    {
+        return (uSize + S_uShmSectionAlignment - 1u) & ~(S_uShmSectionAlignment - 1u);
+    }
+
+    void Add(ShmSectionId eId, std::uint32_t uVersion, std::size_t uSize)
+    {
+        m_aSections[m_uSectionCount++] = ShmSectionEntry{eId, uVersion, m_uSize, uSize};
+        m_uSize += AlignUp(uSize);
+    }
+
+    ShmSectionEntry m_aSections[S_uShmMaxSections];
+    std::uint32_t m_uSectionCount;
+    std::size_t m_uSize;
 };
 
 class SharedMemory final
 {
 public:
     SharedMemory():
-        m_pShmObject{},
-        m_pMappedRegion{},
-        m_pMemoryContent{}
+        m_oLayout{},
+        m_oSegment{S_aShmName, m_oLayout.GetSize()},
+        m_pHeader{static_cast<SharedMemoryHeader *>(m_oSegment.GetAddress())},
+        m_pControl{},
+        m_pLog{},
+        m_pPoseHistory{},
+        m_pNotifier{},
+        m_pCommands{},
+        m_pTelemetry{}
     {
-        try
+        if (m_oSegment.GetIsCreated())
         {
-            m_pShmObject = std::make_unique<windows_shared_memory>(open_only, S_aShmName, read_write);
-            m_pMappedRegion = std::make_unique<mapped_region>(*m_pShmObject, read_write);
-            m_pMemoryContent = static_cast<SharedMemoryContent *>(m_pMappedRegion->get_address());
+            Create();
         }
-        catch (...)
+        else
         {
-            m_pShmObject = std::make_unique<windows_shared_memory>(create_only, S_aShmName, read_write, 2u * sizeof(SharedMemoryContent));
-            m_pMappedRegion = std::make_unique<mapped_region>(*m_pShmObject, read_write);
-            m_pMemoryContent = new (m_pMappedRegion->get_address()) SharedMemoryContent{};
+            Attach();
         }
     }
 
     ~SharedMemory()
     {
-        if (m_pMemoryContent)
+        if (m_pControl)
         {
             if (S_eShmMode == ShmConfig::CONTROL)
             {
-                //m_pMemoryContent->~SharedMemoryContent();
+                //m_pControl->~ControlSection();
             }
-            m_pMemoryContent = nullptr;
+            m_pControl = nullptr;
         }
     }
 
-    SharedMemoryContent *operator->()
+    ControlSection *operator->()
     {
-        return m_pMemoryContent;
+        return m_pControl;
     }
 
-    SharedMemoryContent const *operator->() const
+    ControlSection const *operator->() const
     {
-        return m_pMemoryContent;
+        return m_pControl;
+    }
+
+    // nullptr if the segment was created by a build without a compatible log
+    ShmLog *GetLog() const
+    {
+        return m_pLog;
+    }
+
+    // nullptr if the segment was created by a build without a compatible pose history
+    PoseHistory *GetPoseHistory() const
+    {
+        return m_pPoseHistory;
+    }
+
+    // nullptr if the segment was created by a build without change notification
+    ShmNotifier *GetNotifier() const
+    {
+        return m_pNotifier;
+    }
+
+    // nullptr if the segment was created by a build without a command queue
+    CommandQueue *GetCommands() const
+    {
+        return m_pCommands;
+    }
+
+    // nullptr if the segment was created by a build without telemetry
+    Telemetry *GetTelemetry() const
+    {
+        return m_pTelemetry;
     }
 
 private:
-    std::unique_ptr<windows_shared_memory> m_pShmObject;
-    std::unique_ptr<mapped_region> m_pMappedRegion;
-    SharedMemoryContent *m_pMemoryContent;
+    // the segment is zero-filled, the header becomes valid with the release store of m_uState
+    void Create()
+    {
+        auto *pHeader = new (m_pHeader) SharedMemoryHeader{};
+        std::memcpy(pHeader->m_aMagic, S_aShmMagic, sizeof(S_aShmMagic));
+        pHeader->m_uLayoutVersion = S_uShmLayoutVersion;
+        pHeader->m_uSegmentSize = m_oLayout.GetSize();
+        pHeader->m_uSectionCount = m_oLayout.GetSectionCount();
+        std::copy(m_oLayout.GetSections(), m_oLayout.GetSections() + m_oLayout.GetSectionCount(), pHeader->m_aSections);
+
+        m_pControl = new (GetSectionAddress(ShmSectionId::Control)) ControlSection{};
+        auto *pLogStorage = static_cast<char *>(GetSectionAddress(ShmSectionId::LogStorage));
+        auto *pLog = GetSectionAddress(ShmSectionId::Log);
+        m_pLog = new (pLog) ShmLog{S_uLogCapacity, pLogStorage - static_cast<char *>(pLog)};
+        auto *pPoseHistoryStorage = static_cast<char *>(GetSectionAddress(ShmSectionId::PoseHistoryStorage));
+        auto *pPoseHistory = GetSectionAddress(ShmSectionId::PoseHistory);
+        m_pPoseHistory = new (pPoseHistory) PoseHistory{S_uPoseHistoryCapacity, pPoseHistoryStorage - static_cast<char *>(pPoseHistory)};
+        m_pNotifier = new (GetSectionAddress(ShmSectionId::Notifier)) ShmNotifier{};
+        m_pCommands = new (GetSectionAddress(ShmSectionId::Commands)) CommandQueue{};
+        m_pTelemetry = new (GetSectionAddress(ShmSectionId::Telemetry)) Telemetry{};
+
+        pHeader->m_uState.store(static_cast<std::uint32_t>(ShmState::Ready), std::memory_order_release);
+    }
+
+    // O(1) attach to a segment created by this or any other build with the same header layout
+    void Attach()
+    {
+        if (m_oSegment.GetSize() < sizeof(SharedMemoryHeader))
+        {
+            throw ControlInterface::ControlInterfaceException{"SharedMemory: segment too small for the header"};
+        }
+        auto const oDeadline = std::chrono::steady_clock::now() + S_oReadyTimeout;
+        while (m_pHeader->m_uState.load(std::memory_order_acquire) != static_cast<std::uint32_t>(ShmState::Ready))
+        {
+            if (std::chrono::steady_clock::now() > oDeadline)
+            {
+                throw ControlInterface::ControlInterfaceException{"SharedMemory: segment was never initialized"};
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds{1});
+        }
+        if (std::memcmp(m_pHeader->m_aMagic, S_aShmMagic, sizeof(S_aShmMagic)) != 0)
+        {
+            throw ControlInterface::ControlInterfaceException{"SharedMemory: bad magic"};
+        }
+        if (m_pHeader->m_uLayoutVersion != S_uShmLayoutVersion)
+        {
+            throw ControlInterface::ControlInterfaceException{"SharedMemory: layout version "
+                + std::to_string(m_pHeader->m_uLayoutVersion) + ", expected " + std::to_string(S_uShmLayoutVersion)};
+        }
+        if (m_pHeader->m_uSegmentSize > m_oSegment.GetSize())
+        {
+            throw ControlInterface::ControlInterfaceException{"SharedMemory: segment is smaller than its header claims"};
+        }
+
+        m_pControl = static_cast<ControlSection *>(FindSection(ShmSectionId::Control, S_uControlSectionVersion, sizeof(ControlSection)));
+        if (!m_pControl)
+        {
+            throw ControlInterface::ControlInterfaceException{"SharedMemory: no compatible control section"};
+        }
+        auto *pLog = static_cast<ShmLog *>(FindSection(ShmSectionId::Log, S_uLogSectionVersion, sizeof(ShmLog)));
+        auto const *pLogStorage = m_pHeader->FindSection(ShmSectionId::LogStorage);
+        if (pLog && pLogStorage && pLogStorage->m_uSize >= pLog->GetCapacity())
+        {
+            m_pLog = pLog;
+        }
+        auto *pPoseHistory = static_cast<PoseHistory *>(FindSection(ShmSectionId::PoseHistory, S_uPoseHistorySectionVersion, sizeof(PoseHistory)));
+        auto const *pPoseHistoryStorage = m_pHeader->FindSection(ShmSectionId::PoseHistoryStorage);
+        if (pPoseHistory && pPoseHistoryStorage
+            && pPoseHistoryStorage->m_uSize >= PoseHistory::GetStorageSize(pPoseHistory->GetCapacity()))
+        {
+            m_pPoseHistory = pPoseHistory;
+        }
+        m_pNotifier = static_cast<ShmNotifier *>(FindSection(ShmSectionId::Notifier, S_uNotifierSectionVersion, sizeof(ShmNotifier)));
+        m_pCommands = static_cast<CommandQueue *>(FindSection(ShmSectionId::Commands, S_uCommandSectionVersion, sizeof(CommandQueue)));
+        m_pTelemetry = static_cast<Telemetry *>(FindSection(ShmSectionId::Telemetry, S_uTelemetrySectionVersion, sizeof(Telemetry)));
+    }
+
+    // nullptr if the section is missing, of another version or smaller than uMinSize
+    void *FindSection(ShmSectionId eId, std::uint32_t uVersion, std::size_t uMinSize) const
+    {
+        auto const *pEntry = m_pHeader->FindSection(eId);
+        if (!pEntry || pEntry->m_uVersion != uVersion || pEntry->m_uSize < uMinSize
+            || pEntry->m_uOffset % S_uShmSectionAlignment != 0u
+            || pEntry->m_uOffset + pEntry->m_uSize > m_pHeader->m_uSegmentSize)
+        {
+            return nullptr;
+        }
+        return static_cast<char *>(m_oSegment.GetAddress()) + pEntry->m_uOffset;
+    }
+
+    void *GetSectionAddress(ShmSectionId eId) const
+    {
+        return static_cast<char *>(m_oSegment.GetAddress()) + m_pHeader->FindSection(eId)->m_uOffset;
+    }
+
+    SegmentLayout const m_oLayout;
+    SharedMemorySegment m_oSegment;
+    SharedMemoryHeader *m_pHeader;
+    ControlSection *m_pControl;
+    ShmLog *m_pLog;
+    PoseHistory *m_pPoseHistory;
+    ShmNotifier *m_pNotifier;
+    CommandQueue *m_pCommands;
+    Telemetry *m_pTelemetry;
 };
 
 } // unnamed namespace
@@ -154,17 +398,23 @@ class ControlInterface::ControlInterfaceImpl
 public:
     ControlInterfaceImpl():
         m_oMutex{},
+        m_bLogProducer{false},
         m_oSharedMemory{}
     {
 
     }
 
     void Log(std::string const &strMessage);
-    std::string const PullLog();
+    void SetLogProducer(bool bProducer);
+    bool PullLog(std::string &strMessage);
+    std::uint64_t GetLogDroppedCount() const;
 
     void SetRotation(glm::quat const &qRotation);
     glm::quat const &GetRotation() const;
 
+    void PushPoseSample(PoseSample const &oSample);
+    std::size_t ReadPoseHistory(std::uint64_t &uCursor, PoseSample *pSamples, std::size_t uMaxSamples, std::uint64_t &uLost) const;
+
     void SetDistortionCoefficients(float k0, float k1);
     bool GetDistortionCoefficients(float &k0, float &k1) const;
 
@@ -174,8 +424,31 @@ public:
     void SetHeight(float fHeight);
     float GetHeight() const;
 
+    std::uint32_t GetParameterGeneration() const;
+    std::uint32_t GetDistortionParameters(float &k0, float &k1, float &scale) const;
+
+    std::uint32_t GetChangeGeneration(ShmSectionId eSection) const;
+    bool WaitForChange(ShmSectionId eSection, std::uint32_t uKnownGeneration, std::chrono::microseconds oTimeout) const;
+
+    std::uint64_t SubmitCommand(CommandType eType, std::int64_t iArg0, std::int64_t iArg1);
+    CommandStatus GetCommandStatus(std::uint64_t uSequence) const;
+    bool PopCommand(Command &oCommand);
+    void CompleteCommand(std::uint64_t uSequence, CommandStatus eStatus);
+
+    Telemetry *GetTelemetry() const;
+
 private:
+    void Notify(ShmSectionId eSection)
+    {
+        auto *pNotifier = m_oSharedMemory.GetNotifier();
+        if (pNotifier)
+        {
+            pNotifier->Notify(static_cast<std::uint32_t>(eSection));
+        }
+    }
+
     std::mutex m_oMutex;
+    std::atomic<bool> m_bLogProducer;
     SharedMemory m_oSharedMemory;
 };
 
@@ -195,17 +468,54 @@ void ControlInterface::Log(std::string const &strMessage)
 
 void ControlInterface::ControlInterfaceImpl::Log(std::string const &strMessage)
 {
-    m_oSharedMemory->Log.Log(strMessage);
+    auto *pLog = m_oSharedMemory.GetLog();
+    if (pLog && m_bLogProducer.load(std::memory_order_acquire))
+    {
+        // the ring has a single producer process, the lock serializes the threads in it and is
+        // uncontended as long as only the logger's flusher writes
+        std::lock_guard<std::mutex> oLock{m_oMutex};
+        pLog->Log(strMessage);
+        Notify(ShmSectionId::Log);
+    }
+}
+
+void ControlInterface::SetLogProducer(bool bProducer)
+{
+    m_pImpl->SetLogProducer(bProducer);
+}
+
+void ControlInterface::ControlInterfaceImpl::SetLogProducer(bool bProducer)
+{
+    m_bLogProducer.store(bProducer, std::memory_order_release);
 }
 
 std::string const ControlInterface::PullLog()
 {
-    return m_pImpl->PullLog();
+    std::string strMessage{};
+    m_pImpl->PullLog(strMessage);
+    return strMessage;
+}
+
+bool ControlInterface::PullLog(std::string &strMessage)
+{
+    return m_pImpl->PullLog(strMessage);
+}
+
+bool ControlInterface::ControlInterfaceImpl::PullLog(std::string &strMessage)
+{
+    auto *pLog = m_oSharedMemory.GetLog();
+    return pLog && pLog->GetNext(strMessage);
+}
+
+std::uint64_t ControlInterface::GetLogDroppedCount() const
+{
+    return m_pImpl->GetLogDroppedCount();
 }
 
-std::string const ControlInterface::ControlInterfaceImpl::PullLog()
+std::uint64_t ControlInterface::ControlInterfaceImpl::GetLogDroppedCount() const
 {
-    return m_oSharedMemory->Log.GetNext();
+    auto const *pLog = m_oSharedMemory.GetLog();
+    return pLog ? pLog->GetDroppedCount() : 0u;
 }
 
 void ControlInterface::SetRotation(glm::quat const &qRotation)
@@ -228,6 +538,34 @@ glm::quat const &ControlInterface::ControlInterfaceImpl::GetRotation() const
     return m_oSharedMemory->m_qRotation;
 }
 
+void ControlInterface::PushPoseSample(PoseSample const &oSample)
+{
+    m_pImpl->PushPoseSample(oSample);
+}
+
+void ControlInterface::ControlInterfaceImpl::PushPoseSample(PoseSample const &oSample)
+{
+    auto *pPoseHistory = m_oSharedMemory.GetPoseHistory();
+    if (pPoseHistory)
+    {
+        pPoseHistory->Push(oSample);
+        Notify(ShmSectionId::PoseHistory);
+    }
+}
+
+std::size_t ControlInterface::ReadPoseHistory(std::uint64_t &uCursor, PoseSample *pSamples, std::size_t uMaxSamples, std::uint64_t &uLost) const
+{
+    return m_pImpl->ReadPoseHistory(uCursor, pSamples, uMaxSamples, uLost);
+}
+
+std::size_t ControlInterface::ControlInterfaceImpl::ReadPoseHistory(std::uint64_t &uCursor, PoseSample *pSamples, std::size_t uMaxSamples,
+    std::uint64_t &uLost) const
+{
+    uLost = 0u;
+    auto const *pPoseHistory = m_oSharedMemory.GetPoseHistory();
+    return pPoseHistory ? pPoseHistory->Read(uCursor, pSamples, uMaxSamples, uLost) : 0u;
+}
+
 void ControlInterface::SetDistortionCoefficients(float k0, float k1)
 {
     m_pImpl->SetDistortionCoefficients(k0, k1);
@@ -235,8 +573,10 @@ void ControlInterface::SetDistortionCoefficients(float k0, float k1)
 
 void ControlInterface::ControlInterfaceImpl::SetDistortionCoefficients(float k0, float k1)
 {
+    ParameterWriteGuard oGuard{m_oSharedMemory->m_uParameterGeneration, m_oSharedMemory.GetNotifier()};
     m_oSharedMemory->m_fDistortionK0 = k0;
     m_oSharedMemory->m_fDistortionK1 = k1;
+    m_oSharedMemory->m_uWrittenParameters |= S_uWrittenCoefficients;
 }
 
 bool ControlInterface::GetDistortionCoefficients(float &k0, float &k1) const
@@ -248,7 +588,7 @@ bool ControlInterface::ControlInterfaceImpl::GetDistortionCoefficients(float &k0
 {
     k0 = m_oSharedMemory->m_fDistortionK0;
     k1 = m_oSharedMemory->m_fDistortionK1;
-    return (k0 != 0.0f || k1 != 0.0f);
+    return (m_oSharedMemory->m_uWrittenParameters & S_uWrittenCoefficients) != 0u;
 }
 
 void ControlInterface::SetDistortionScale(float scale)
@@ -258,7 +598,9 @@ void ControlInterface::SetDistortionScale(float scale)
 
 void ControlInterface::ControlInterfaceImpl::SetDistortionScale(float scale)
 {
+    ParameterWriteGuard oGuard{m_oSharedMemory->m_uParameterGeneration, m_oSharedMemory.GetNotifier()};
     m_oSharedMemory->m_fDistortionScale = scale;
+    m_oSharedMemory->m_uWrittenParameters |= S_uWrittenScale;
 }
 
 float ControlInterface::GetDistortionScale() const
@@ -278,6 +620,7 @@ void ControlInterface::SetHeight(float fHeight)
 
 void ControlInterface::ControlInterfaceImpl::SetHeight(float fHeight)
 {
+    // picked up with the next pose, the lens generation stays put
     m_oSharedMemory->m_fHeight = fHeight;
 }
 
@@ -291,4 +634,152 @@ float ControlInterface::ControlInterfaceImpl::GetHeight() const
     return m_oSharedMemory->m_fHeight;
 }
 
+std::uint32_t ControlInterface::GetParameterGeneration() const
+{
+    return m_pImpl->GetParameterGeneration();
+}
+
+std::uint32_t ControlInterface::ControlInterfaceImpl::GetParameterGeneration() const
+{
+    return m_oSharedMemory->m_uParameterGeneration.load(std::memory_order_acquire);
+}
+
+std::uint32_t ControlInterface::GetDistortionParameters(float &k0, float &k1, float &scale) const
+{
+    return m_pImpl->GetDistortionParameters(k0, k1, scale);
+}
+
+std::uint32_t ControlInterface::ControlInterfaceImpl::GetDistortionParameters(float &k0, float &k1, float &scale) const
+{
+    auto &rGeneration = m_oSharedMemory->m_uParameterGeneration;
+    while (true)
+    {
+        auto const uGeneration = WaitForCompletedWrite(rGeneration);
+        auto const uWritten = m_oSharedMemory->m_uWrittenParameters;
+        auto const fK0 = m_oSharedMemory->m_fDistortionK0;
+        auto const fK1 = m_oSharedMemory->m_fDistortionK1;
+        auto const fScale = m_oSharedMemory->m_fDistortionScale;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (rGeneration.load(std::memory_order_relaxed) == uGeneration)
+        {
+            if ((uWritten & S_uWrittenCoefficients) != 0u)
+            {
+                k0 = fK0;
+                k1 = fK1;
+            }
+            if ((uWritten & S_uWrittenScale) != 0u)
+            {
+                scale = fScale;
+            }
+            return uGeneration;
+        }
+    }
+}
+
+std::uint32_t ControlInterface::GetChangeGeneration(ShmSectionId eSection) const
+{
+    return m_pImpl->GetChangeGeneration(eSection);
+}
+
+std::uint32_t ControlInterface::ControlInterfaceImpl::GetChangeGeneration(ShmSectionId eSection) const
+{
+    auto const *pNotifier = m_oSharedMemory.GetNotifier();
+    return pNotifier ? pNotifier->GetGeneration(static_cast<std::uint32_t>(eSection)) : 0u;
+}
+
+bool ControlInterface::WaitForChange(ShmSectionId eSection, std::uint32_t uKnownGeneration, std::chrono::microseconds oTimeout) const
+{
+    return m_pImpl->WaitForChange(eSection, uKnownGeneration, oTimeout);
+}
+
+bool ControlInterface::ControlInterfaceImpl::WaitForChange(ShmSectionId eSection, std::uint32_t uKnownGeneration,
+    std::chrono::microseconds oTimeout) const
+{
+    auto *pNotifier = m_oSharedMemory.GetNotifier();
+    if (!pNotifier)
+    {
+        // no notification in this segment, the caller has to look for itself
+        std::this_thread::sleep_for(std::min(oTimeout, std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::milliseconds{1})));
+        return true;
+    }
+    return pNotifier->Wait(static_cast<std::uint32_t>(eSection), uKnownGeneration, oTimeout);
+}
+
+std::uint64_t ControlInterface::SubmitCommand(CommandType eType, std::int64_t iArg0, std::int64_t iArg1)
+{
+    return m_pImpl->SubmitCommand(eType, iArg0, iArg1);
+}
+
+std::uint64_t ControlInterface::ControlInterfaceImpl::SubmitCommand(CommandType eType, std::int64_t iArg0, std::int64_t iArg1)
+{
+    auto *pCommands = m_oSharedMemory.GetCommands();
+    if (!pCommands)
+    {
+        return 0u;
+    }
+    std::uint64_t uSequence = 0u;
+    {
+        // single producer per process
+        std::lock_guard<std::mutex> oLock{m_oMutex};
+        uSequence = pCommands->TryPush(eType, iArg0, iArg1);
+    }
+    if (uSequence != 0u)
+    {
+        Notify(ShmSectionId::Commands);
+    }
+    return uSequence;
+}
+
+CommandStatus ControlInterface::GetCommandStatus(std::uint64_t uSequence) const
+{
+    return m_pImpl->GetCommandStatus(uSequence);
+}
+
+CommandStatus ControlInterface::ControlInterfaceImpl::GetCommandStatus(std::uint64_t uSequence) const
+{
+    auto const *pCommands = m_oSharedMemory.GetCommands();
+    return pCommands ? pCommands->GetStatus(uSequence) : CommandStatus::Unknown;
+}
+
+bool ControlInterface::PopCommand(Command &oCommand)
+{
+    return m_pImpl->PopCommand(oCommand);
+}
+
+bool ControlInterface::ControlInterfaceImpl::PopCommand(Command &oCommand)
+{
+    auto *pCommands = m_oSharedMemory.GetCommands();
+    return pCommands && pCommands->TryPop(oCommand);
+}
+
+void ControlInterface::CompleteCommand(std::uint64_t uSequence, CommandStatus eStatus)
+{
+    m_pImpl->CompleteCommand(uSequence, eStatus);
+}
+
+void ControlInterface::ControlInterfaceImpl::CompleteCommand(std::uint64_t uSequence, CommandStatus eStatus)
+{
+    auto *pCommands = m_oSharedMemory.GetCommands();
+    if (pCommands)
+    {
+        pCommands->Complete(uSequence, eStatus);
+        Notify(ShmSectionId::Commands);
+    }
+}
+
+Telemetry *ControlInterface::GetTelemetry()
+{
+    return m_pImpl->GetTelemetry();
+}
+
+Telemetry const *ControlInterface::GetTelemetry() const
+{
+    return m_pImpl->GetTelemetry();
+}
+
+Telemetry *ControlInterface::ControlInterfaceImpl::GetTelemetry() const
+{
+    return m_oSharedMemory.GetTelemetry();
+}
+
 } // namespace spvr
@@ -5,8 +5,16 @@
 #ifndef SPVR_CONTROLINTERFACE_H
 #define SPVR_CONTROLINTERFACE_H
 
+#include "CommandQueue.h"
+#include "PoseHistory.h"
+#include "SharedMemoryLayout.h"
+#include "Telemetry.h"
+
 #include "glm/gtc/quaternion.hpp"
 
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <stdexcept>
 #include <string>
@@ -20,23 +28,67 @@ public:
     ControlInterface();
     ~ControlInterface();
 
-    // logging
+    // logging, the driver writes and the control app drains, the oldest unread
+    // lines are overwritten when the control app falls behind; the ring takes a single
+    // producer, so Log drops the line unless this process is the one, see SetLogProducer
     void Log(std::string const &strMessage);
+    // set by the server-side driver from Init to Cleanup, the client-side driver and every
+    // other process that maps the segment keep their lines to their own driver logs
+    void SetLogProducer(bool bProducer);
+    // returns an empty string if there is nothing to read
     std::string const PullLog();
+    // returns false if there is nothing to read
+    bool PullLog(std::string &strMessage);
+    // lines that were overwritten before the control app read them
+    std::uint64_t GetLogDroppedCount() const;
 
     void SetRotation(glm::quat const &qRotation);
     glm::quat const GetRotation() const;
 
+    // pose history, the driver pushes every sample, readers consume them at full rate
+    // without syscalls, see PoseHistory::Read for the cursor semantics
+    void PushPoseSample(PoseSample const &oSample);
+    std::size_t ReadPoseHistory(std::uint64_t &uCursor, PoseSample *pSamples, std::size_t uMaxSamples, std::uint64_t &uLost) const;
+
     void SetDistortionCoefficients(float k0, float k1);
-    // returns true if non-default values
+    // returns true if a writer has set them, k0 and k1 hold the segment's values either way
     bool GetDistortionCoefficients(float &k0, float &k1) const;
 
     void SetDistortionScale(float scale);
     float GetDistortionScale() const;
 
+    // read with every pose, not a lens parameter, so it leaves the parameter generation alone
     void SetHeight(float fHeight);
     float GetHeight() const;
 
+    // incremented on every lens parameter change, odd while a change is in progress; a change
+    // left in progress by a crashed writer is completed after a timeout
+    std::uint32_t GetParameterGeneration() const;
+    // consistent snapshot of all distortion parameters, returns the generation it belongs to;
+    // parameters no writer has set yet keep the values passed in, see ReadDistortionParameters
+    std::uint32_t GetDistortionParameters(float &k0, float &k1, float &scale) const;
+
+    // change notification across processes, the generation of a section is bumped after
+    // every change to it (Control: parameters, Log: new lines, PoseHistory: new samples)
+    std::uint32_t GetChangeGeneration(ShmSectionId eSection) const;
+    // Sleeps until the section's generation differs from uKnownGeneration, returns false
+    // on timeout. May return true spuriously if the segment has no notifier.
+    bool WaitForChange(ShmSectionId eSection, std::uint32_t uKnownGeneration, std::chrono::microseconds oTimeout) const;
+
+    // commands from the control app to the driver, SubmitCommand returns the sequence to
+    // poll GetCommandStatus with or 0 if the queue is full, the Commands section's change
+    // generation moves on submission and completion
+    std::uint64_t SubmitCommand(CommandType eType, std::int64_t iArg0 = 0, std::int64_t iArg1 = 0);
+    CommandStatus GetCommandStatus(std::uint64_t uSequence) const;
+    // driver side, see SmartServer::RunFrame
+    bool PopCommand(Command &oCommand);
+    void CompleteCommand(std::uint64_t uSequence, CommandStatus eStatus);
+
+    // driver telemetry in shared memory, nullptr if the segment has none, each member
+    // has a single writing thread in the driver, see Telemetry.h
+    Telemetry *GetTelemetry();
+    Telemetry const *GetTelemetry() const;
+
     class ControlInterfaceException final : std::runtime_error
     {
     public:
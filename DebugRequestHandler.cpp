@@ -0,0 +1,516 @@
+/*
+ * Copyright (c) 2016
+ *  Somebody
+ */
+#include "DebugRequestHandler.h"
+
+#include "ControlInterface.h"
+#include "DistortionTable.h"
+#include "LensState.h"
+#include "Logger.h"
+#include "PoseUpdater.h"
+#include "ResponseWriter.h"
+#include "Telemetry.h"
+#include "Tracer.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace spvr
+{
+
+namespace
+{
+
+// requests are split in place in a copy of this size
+static std::size_t const S_uMaxRequestLength = 256u;
+static std::size_t const S_uMaxTokens = 4u;
+
+struct NamedCounter final
+{
+    char const *m_pchName;
+    TelemetryCounter Telemetry::*m_pCounter;
+};
+
+// the latency stages are found through FindLatencyStage
+struct NamedHistogram final
+{
+    char const *m_pchName;
+    TelemetryHistogram Telemetry::*m_pHistogram;
+};
+
+static NamedCounter const S_aCounters[] = {
+    {"packets-received", &Telemetry::m_oPacketsReceived},
+    {"packets-rejected", &Telemetry::m_oPacketsRejected},
+    {"socket-errors", &Telemetry::m_oSocketErrors},
+    {"poses-published", &Telemetry::m_oPosesPublished},
+    {"run-frames", &Telemetry::m_oRunFrames},
+    {"commands-executed", &Telemetry::m_oCommandsExecuted}
+};
+
+static NamedHistogram const S_aHistograms[] = {
+    {"inter-arrival", &Telemetry::m_oPacketInterArrival},
+    {"processing", &Telemetry::m_oPacketProcessing},
+    {"transit", &Telemetry::m_oPacketTransit},
+    {"sample-age", &Telemetry::m_oSampleAge},
+    {"send-to-publish", &Telemetry::m_oSendToPublish},
+    {"run-frame-interval", &Telemetry::m_oRunFrameInterval}
+};
+
+static std::size_t const S_uCounters = sizeof(S_aCounters) / sizeof(S_aCounters[0]);
+static std::size_t const S_uStages = static_cast<std::size_t>(LatencyStage::Count);
+static std::size_t const S_uHistograms = sizeof(S_aHistograms) / sizeof(S_aHistograms[0]);
+
+static char const *const S_aLogLevelNames[] = {"debug", "info", "warning", "error"};
+static std::size_t const S_uLogLevels = sizeof(S_aLogLevelNames) / sizeof(S_aLogLevelNames[0]);
+
+// height of the headset above the floor in meters
+static float const S_fMinHeight = 0.0f;
+static float const S_fMaxHeight = 3.0f;
+
+double ToUs(std::uint64_t uNanoseconds)
+{
+    return static_cast<double>(uNanoseconds) / 1e3;
+}
+
+// plain decimal numbers only, strtof would also take nan, inf and hex floats
+bool ParseFloat(char const *pchText, float &fValue)
+{
+    if (pchText[std::strspn(pchText, "+-.0123456789eE")] != '\0')
+    {
+        return false;
+    }
+    char *pchEnd = nullptr;
+    errno = 0;
+    auto const f = std::strtof(pchText, &pchEnd);
+    if (pchEnd == pchText || *pchEnd != '\0' || errno != 0)
+    {
+        return false;
+    }
+    fValue = f;
+    return true;
+}
+
+bool ParseLong(char const *pchText, long &iValue)
+{
+    char *pchEnd = nullptr;
+    errno = 0;
+    auto const i = std::strtol(pchText, &pchEnd, 10);
+    if (pchEnd == pchText || *pchEnd != '\0' || errno != 0)
+    {
+        return false;
+    }
+    iValue = i;
+    return true;
+}
+
+void WriteSummary(ResponseWriter &rWriter, char const *pchName, TelemetryHistogramSnapshot const &rHistogram)
+{
+    rWriter.Format("%-18s p50 %9.1f  p99 %9.1f  p99.9 %9.1f  max %9.1f us  n %llu\n", pchName,
+        ToUs(rHistogram.GetPercentile(0.5)),
+        ToUs(rHistogram.GetPercentile(0.99)),
+        ToUs(rHistogram.GetPercentile(0.999)),
+        ToUs(rHistogram.GetMax()),
+        static_cast<unsigned long long>(rHistogram.GetCount()));
+}
+
+} // unnamed namespace
+
+class DebugRequestHandler::DebugRequestHandlerImpl
+{
+public:
+    DebugRequestHandlerImpl(ControlInterface &rControlInterface, Tracer &rTracer, PoseUpdater &rPoseUpdater, Logger *pLogger,
+        DistortionParameters const &oDefaultParameters, std::string const &strTraceFile, std::uint64_t uTraceCapacity):
+        m_rControlInterface(rControlInterface),
+        m_rTracer(rTracer),
+        m_rPoseUpdater(rPoseUpdater),
+        m_pLogger{pLogger},
+        m_pTelemetry{rControlInterface.GetTelemetry()},
+        m_oDefaultParameters(oDefaultParameters),
+        m_strTraceFile{strTraceFile},
+        m_uTraceCapacity{uTraceCapacity},
+        m_oMutex{},
+        m_uBaselineTime{0u},
+        m_aCounterBaseline{},
+        m_vecStageBaseline(S_uStages),
+        m_vecHistogramBaseline(S_uHistograms)
+    {
+        // everything since the driver started until the first reset
+        m_uBaselineTime = Tracer::Now();
+    }
+
+    void Handle(char const *pchRequest, char *pchResponseBuffer, std::uint32_t uResponseBufferSize)
+    {
+        ResponseWriter oWriter{pchResponseBuffer, uResponseBufferSize};
+        if (!pchRequest)
+        {
+            return;
+        }
+        char aRequest[S_uMaxRequestLength];
+        auto const uLength = std::strlen(pchRequest);
+        if (uLength >= sizeof(aRequest))
+        {
+            oWriter.Append("error: request too long\n");
+            return;
+        }
+        std::memcpy(aRequest, pchRequest, uLength + 1u);
+        char const *apTokens[S_uMaxTokens] = {};
+        auto const uTokens = Split(aRequest, apTokens);
+
+        std::lock_guard<std::mutex> oLock{m_oMutex};
+        if (uTokens == 0u || std::strcmp(apTokens[0], "help") == 0)
+        {
+            WriteHelp(oWriter);
+        }
+        else if (std::strcmp(apTokens[0], "stats") == 0 && uTokens == 1u)
+        {
+            WriteStats(oWriter);
+        }
+        else if (std::strcmp(apTokens[0], "latency") == 0 && uTokens == 1u)
+        {
+            WriteLatency(oWriter);
+        }
+        else if (std::strcmp(apTokens[0], "histo") == 0 && uTokens == 2u)
+        {
+            WriteHistogram(oWriter, apTokens[1]);
+        }
+        else if (std::strcmp(apTokens[0], "reset") == 0 && uTokens == 1u)
+        {
+            Reset();
+            oWriter.Append("ok: statistics reset\n");
+        }
+        else if (std::strcmp(apTokens[0], "set") == 0 && uTokens == 3u)
+        {
+            Set(oWriter, apTokens[1], apTokens[2]);
+        }
+        else if (std::strcmp(apTokens[0], "trace") == 0 && uTokens <= 2u)
+        {
+            Trace(oWriter, uTokens == 2u ? apTokens[1] : nullptr);
+        }
+        else
+        {
+            oWriter.Format("error: unknown request \"%s\", try help\n", pchRequest);
+        }
+    }
+
+private:
+    // splits at white space in place, returns the number of tokens, S_uMaxTokens + 1 if there are more
+    static std::size_t Split(char *pchRequest, char const *(&apTokens)[S_uMaxTokens])
+    {
+        std::size_t uTokens = 0u;
+        auto *pch = pchRequest;
+        for (;;)
+        {
+            while (*pch != '\0' && std::isspace(static_cast<unsigned char>(*pch)))
+            {
+                ++pch;
+            }
+            if (*pch == '\0')
+            {
+                return uTokens;
+            }
+            if (uTokens == S_uMaxTokens)
+            {
+                return uTokens + 1u;
+            }
+            apTokens[uTokens++] = pch;
+            while (*pch != '\0' && !std::isspace(static_cast<unsigned char>(*pch)))
+            {
+                ++pch;
+            }
+            if (*pch != '\0')
+            {
+                *pch++ = '\0';
+            }
+        }
+    }
+
+    static void WriteHelp(ResponseWriter &rWriter)
+    {
+        rWriter.Append(
+            "stats                  counters and rates since the last reset\n"
+            "latency                latency stages since the last reset\n"
+            "histo <name>           one histogram since the last reset\n"
+            "reset                  starts a new baseline for stats, latency and histo\n"
+            "set <param> <value>    port, distortion-k0, distortion-k1, distortion-scale, height, log-level\n"
+            "trace [on|off]         switches the trace file on or off\n");
+    }
+
+    void WriteStats(ResponseWriter &rWriter) const
+    {
+        auto const fSeconds = static_cast<double>(Tracer::Now() - m_uBaselineTime) / 1e9;
+        rWriter.Format("port %u, trace %s, log level %s\n", static_cast<unsigned>(m_rPoseUpdater.GetPort()),
+            m_rTracer.GetIsEnabled() ? "on" : "off", GetLogLevelName());
+        if (!m_pTelemetry)
+        {
+            rWriter.Format("no telemetry, since start: packets-received %llu, packets-rejected %llu\n",
+                static_cast<unsigned long long>(m_rPoseUpdater.GetReceivedCount()),
+                static_cast<unsigned long long>(m_rPoseUpdater.GetRejectedCount()));
+            return;
+        }
+        rWriter.Format("since reset %.3f s\n", fSeconds);
+        for (std::size_t i = 0; i < S_uCounters; ++i)
+        {
+            auto const uCount = (m_pTelemetry->*S_aCounters[i].m_pCounter).Get() - m_aCounterBaseline[i];
+            rWriter.Format("%-18s %12llu  %10.1f /s\n", S_aCounters[i].m_pchName, static_cast<unsigned long long>(uCount),
+                fSeconds > 0.0 ? static_cast<double>(uCount) / fSeconds : 0.0);
+        }
+        auto const eEndToEnd = LatencyStage::EndToEnd;
+        WriteSummary(rWriter, GetLatencyStageName(eEndToEnd), GetStageSince(eEndToEnd));
+    }
+
+    void WriteLatency(ResponseWriter &rWriter) const
+    {
+        if (!m_pTelemetry)
+        {
+            rWriter.Append("error: the driver has no telemetry\n");
+            return;
+        }
+        for (std::size_t i = 0; i < S_uStages; ++i)
+        {
+            auto const eStage = static_cast<LatencyStage>(i);
+            WriteSummary(rWriter, GetLatencyStageName(eStage), GetStageSince(eStage));
+        }
+    }
+
+    void WriteHistogram(ResponseWriter &rWriter, char const *pchName) const
+    {
+        if (!m_pTelemetry)
+        {
+            rWriter.Append("error: the driver has no telemetry\n");
+            return;
+        }
+        TelemetryHistogramSnapshot oHistogram{};
+        auto const eStage = FindLatencyStage(pchName);
+        if (eStage != LatencyStage::Count)
+        {
+            oHistogram = GetStageSince(eStage);
+        }
+        else
+        {
+            auto const pEnd = std::end(S_aHistograms);
+            auto const pFound = std::find_if(std::begin(S_aHistograms), pEnd, [pchName](NamedHistogram const &rHistogram)
+            {
+                return std::strcmp(rHistogram.m_pchName, pchName) == 0;
+            });
+            if (pFound == pEnd)
+            {
+                rWriter.Format("error: unknown histogram \"%s\", one of:", pchName);
+                for (std::size_t i = 0; i < S_uStages; ++i)
+                {
+                    rWriter.Format(" %s", GetLatencyStageName(static_cast<LatencyStage>(i)));
+                }
+                for (auto const &rHistogram : S_aHistograms)
+                {
+                    rWriter.Format(" %s", rHistogram.m_pchName);
+                }
+                rWriter.Append("\n");
+                return;
+            }
+            auto const uIndex = static_cast<std::size_t>(pFound - std::begin(S_aHistograms));
+            oHistogram = TelemetryHistogramSnapshot{m_pTelemetry->*pFound->m_pHistogram}.Since(m_vecHistogramBaseline[uIndex]);
+        }
+        WriteSummary(rWriter, pchName, oHistogram);
+        if (oHistogram.GetCount() != 0u)
+        {
+            rWriter.Format("mean %.1f us, p90 %.1f us\n", ToUs(oHistogram.GetSum()) / static_cast<double>(oHistogram.GetCount()),
+                ToUs(oHistogram.GetPercentile(0.9)));
+        }
+        for (std::uint32_t i = 0; i < TelemetryHistogram::S_uBuckets; ++i)
+        {
+            if (oHistogram.GetBucket(i) != 0u)
+            {
+                rWriter.Format("[%12.3f, %12.3f) us %12llu\n", ToUs(TelemetryHistogram::GetBucketLowerBound(i)),
+                    i + 1u < TelemetryHistogram::S_uBuckets ? ToUs(TelemetryHistogram::GetBucketLowerBound(i + 1u)) : ToUs(~std::uint64_t{0u}),
+                    static_cast<unsigned long long>(oHistogram.GetBucket(i)));
+            }
+        }
+    }
+
+    void Reset()
+    {
+        m_uBaselineTime = Tracer::Now();
+        if (!m_pTelemetry)
+        {
+            return;
+        }
+        for (std::size_t i = 0; i < S_uCounters; ++i)
+        {
+            m_aCounterBaseline[i] = (m_pTelemetry->*S_aCounters[i].m_pCounter).Get();
+        }
+        for (std::size_t i = 0; i < S_uStages; ++i)
+        {
+            m_vecStageBaseline[i] = TelemetryHistogramSnapshot{m_pTelemetry->GetLatencyStage(static_cast<LatencyStage>(i))};
+        }
+        for (std::size_t i = 0; i < S_uHistograms; ++i)
+        {
+            m_vecHistogramBaseline[i] = TelemetryHistogramSnapshot{m_pTelemetry->*S_aHistograms[i].m_pHistogram};
+        }
+    }
+
+    void Set(ResponseWriter &rWriter, char const *pchParameter, char const *pchValue)
+    {
+        long iValue = 0;
+        float fValue = 0.0f;
+        if (std::strcmp(pchParameter, "port") == 0)
+        {
+            if (!ParseLong(pchValue, iValue) || iValue <= 0 || iValue > 65535
+                || !m_rPoseUpdater.SetPort(static_cast<std::uint16_t>(iValue)))
+            {
+                rWriter.Format("error: invalid port \"%s\"\n", pchValue);
+                return;
+            }
+        }
+        else if (std::strcmp(pchParameter, "distortion-k0") == 0 || std::strcmp(pchParameter, "distortion-k1") == 0
+            || std::strcmp(pchParameter, "distortion-scale") == 0 || std::strcmp(pchParameter, "height") == 0)
+        {
+            if (!ParseFloat(pchValue, fValue))
+            {
+                rWriter.Format("error: invalid value \"%s\"\n", pchValue);
+                return;
+            }
+            if (std::strcmp(pchParameter, "height") == 0)
+            {
+                if (!(fValue >= S_fMinHeight && fValue <= S_fMaxHeight))
+                {
+                    rWriter.Format("error: height %s out of range [%g, %g]\n", pchValue,
+                        static_cast<double>(S_fMinHeight), static_cast<double>(S_fMaxHeight));
+                    return;
+                }
+                m_rControlInterface.SetHeight(fValue);
+            }
+            else
+            {
+                // the other values keep what the lens is rendered with
+                DistortionParameters oParameters{};
+                ReadDistortionParameters(m_rControlInterface, m_oDefaultParameters, oParameters);
+                if (std::strcmp(pchParameter, "distortion-k0") == 0)
+                {
+                    oParameters.m_fK0 = fValue;
+                }
+                else if (std::strcmp(pchParameter, "distortion-k1") == 0)
+                {
+                    oParameters.m_fK1 = fValue;
+                }
+                else
+                {
+                    oParameters.m_fScale = fValue;
+                }
+                if (!IsValidDistortion(oParameters))
+                {
+                    rWriter.Format("error: k0 %g, k1 %g, scale %g is not a valid lens\n", static_cast<double>(oParameters.m_fK0),
+                        static_cast<double>(oParameters.m_fK1), static_cast<double>(oParameters.m_fScale));
+                    return;
+                }
+                if (std::strcmp(pchParameter, "distortion-scale") == 0)
+                {
+                    m_rControlInterface.SetDistortionScale(fValue);
+                }
+                else
+                {
+                    m_rControlInterface.SetDistortionCoefficients(oParameters.m_fK0, oParameters.m_fK1);
+                }
+            }
+        }
+        else if (std::strcmp(pchParameter, "log-level") == 0)
+        {
+            auto const pEnd = std::end(S_aLogLevelNames);
+            auto const pFound = std::find_if(std::begin(S_aLogLevelNames), pEnd, [pchValue](char const *pchLevel)
+            {
+                return std::strcmp(pchLevel, pchValue) == 0;
+            });
+            if (!m_pLogger || pFound == pEnd)
+            {
+                rWriter.Format("error: invalid log level \"%s\", one of: debug info warning error\n", pchValue);
+                return;
+            }
+            m_pLogger->SetLevel(static_cast<LogLevel>(pFound - std::begin(S_aLogLevelNames)));
+        }
+        else
+        {
+            rWriter.Format("error: unknown parameter \"%s\", one of: port distortion-k0 distortion-k1 distortion-scale height log-level\n",
+                pchParameter);
+            return;
+        }
+        rWriter.Format("ok: %s %s\n", pchParameter, pchValue);
+    }
+
+    void Trace(ResponseWriter &rWriter, char const *pchSwitch)
+    {
+        if (pchSwitch && std::strcmp(pchSwitch, "on") == 0)
+        {
+            if (!m_rTracer.GetIsOpen() && (m_strTraceFile.empty() || !m_rTracer.Open(m_strTraceFile, m_uTraceCapacity)))
+            {
+                rWriter.Append("error: could not open the trace file\n");
+                return;
+            }
+            m_rTracer.SetEnabled(true);
+        }
+        else if (pchSwitch && std::strcmp(pchSwitch, "off") == 0)
+        {
+            m_rTracer.SetEnabled(false);
+        }
+        else if (pchSwitch)
+        {
+            rWriter.Format("error: trace takes on or off, not \"%s\"\n", pchSwitch);
+            return;
+        }
+        rWriter.Format("trace %s\n", m_rTracer.GetIsEnabled() ? "on" : "off");
+    }
+
+    TelemetryHistogramSnapshot GetStageSince(LatencyStage eStage) const
+    {
+        return TelemetryHistogramSnapshot{m_pTelemetry->GetLatencyStage(eStage)}.Since(m_vecStageBaseline[static_cast<std::size_t>(eStage)]);
+    }
+
+    char const *GetLogLevelName() const
+    {
+        for (std::size_t i = 0; m_pLogger && i < S_uLogLevels; ++i)
+        {
+            if (m_pLogger->IsEnabled(static_cast<LogLevel>(i)))
+            {
+                return S_aLogLevelNames[i];
+            }
+        }
+        return "none";
+    }
+
+    ControlInterface &m_rControlInterface;
+    Tracer &m_rTracer;
+    PoseUpdater &m_rPoseUpdater;
+    Logger *m_pLogger;
+    Telemetry *m_pTelemetry;
+    DistortionParameters const m_oDefaultParameters;
+    std::string const m_strTraceFile;
+    std::uint64_t const m_uTraceCapacity;
+    std::mutex m_oMutex;
+    // reset takes a snapshot, the live telemetry only has one writer
+    std::uint64_t m_uBaselineTime;
+    std::uint64_t m_aCounterBaseline[S_uCounters];
+    std::vector<TelemetryHistogramSnapshot> m_vecStageBaseline;
+    std::vector<TelemetryHistogramSnapshot> m_vecHistogramBaseline;
+};
+
+DebugRequestHandler::DebugRequestHandler(ControlInterface &rControlInterface, Tracer &rTracer, PoseUpdater &rPoseUpdater, Logger *pLogger,
+    DistortionParameters const &oDefaultParameters, std::string const &strTraceFile, std::uint64_t uTraceCapacity):
+    m_pImpl{std::make_unique<DebugRequestHandlerImpl>(rControlInterface, rTracer, rPoseUpdater, pLogger, oDefaultParameters,
+        strTraceFile, uTraceCapacity)}
+{
+
+}
+
+DebugRequestHandler::~DebugRequestHandler() = default;
+
+void DebugRequestHandler::Handle(char const *pchRequest, char *pchResponseBuffer, std::uint32_t uResponseBufferSize)
+{
+    m_pImpl->Handle(pchRequest, pchResponseBuffer, uResponseBufferSize);
+}
+
+} // namespace spvr
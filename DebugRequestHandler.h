@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) 2016
+ *  Somebody
+ */
+#ifndef SPVR_DEBUGREQUESTHANDLER_H
+#define SPVR_DEBUGREQUESTHANDLER_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace spvr
+{
+
+class ControlInterface;
+class Logger;
+class PoseUpdater;
+class Tracer;
+struct DistortionParameters;
+
+// The commands SteamVR tools can send through HmdDriver::DebugRequest:
+//   stats                  counters and rates since the last reset
+//   latency                p50/p99/p99.9/max of every latency stage since the last reset
+//   histo <name>           one histogram since the last reset, with its buckets
+//   reset                  starts a new baseline for stats, latency and histo
+//   set <param> <value>    port, distortion-k0, distortion-k1, distortion-scale, height, log-level
+//   trace [on|off]         opens the trace file on first use, see Tracer
+//   help
+// Responses are written straight into the caller's buffer and cut at its end.
+class DebugRequestHandler final
+{
+public:
+    // oDefaultParameters are the coefficients in effect while the control interface holds none,
+    // strTraceFile may be empty if there is nowhere to trace to
+    DebugRequestHandler(ControlInterface &rControlInterface, Tracer &rTracer, PoseUpdater &rPoseUpdater, Logger *pLogger,
+        DistortionParameters const &oDefaultParameters, std::string const &strTraceFile, std::uint64_t uTraceCapacity);
+    ~DebugRequestHandler();
+
+    // thread safe, requests are handled one at a time
+    void Handle(char const *pchRequest, char *pchResponseBuffer, std::uint32_t uResponseBufferSize);
+
+private:
+    class DebugRequestHandlerImpl;
+    std::unique_ptr<DebugRequestHandlerImpl> m_pImpl;
+};
+
+} // namespace spvr
+
+#endif // SPVR_DEBUGREQUESTHANDLER_H
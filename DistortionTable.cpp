@@ -0,0 +1,515 @@
+/*
+ * Copyright (c) 2016
+ *  Somebody
+ */
+#include "DistortionTable.h"
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif // WIN32_LEAN_AND_MEAN
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif // NOMINMAX
+#include <windows.h>
+#else // ! _WIN32
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utime.h>
+#endif // ! _WIN32
+
+namespace spvr
+{
+
+namespace
+{
+
+using namespace boost::interprocess;
+
+static char const S_aModelName[] = "spvr radial k0/k1 v1";
+static char const S_aCacheMagic[8] = {'S', 'P', 'V', 'R', 'D', 'I', 'S', 'T'};
+static std::uint32_t const S_uCacheVersion = 1u;
+static char const S_aCachePrefix[] = "spvr-distortion-";
+static char const S_aCacheSuffix[] = ".bin";
+static std::size_t const S_uCacheKeyDigits = 16u;
+static std::atomic<std::uint32_t> S_uTempFileCounter{0u};
+// outside these the image is a few pixels or many times the render target
+static float const S_fMaxCoefficient = 4.0f;
+static float const S_fMinScale = 0.1f;
+static float const S_fMaxScale = 4.0f;
+// r^2 in the corners of the viewport
+static float const S_fMaxRadius2 = 0.5f;
+
+struct CacheFileHeader final
+{
+    char m_aMagic[8];
+    std::uint32_t m_uVersion;
+    std::uint32_t m_uResolution;
+    std::uint64_t m_uKey;
+};
+
+class Fnv1a final
+{
+public:
+    void Add(void const *pData, std::size_t uSize)
+    {
+        auto const *pBytes = static_cast<unsigned char const *>(pData);
+        for (std::size_t i = 0; i < uSize; ++i)
+        {
+            m_uHash ^= pBytes[i];
+            m_uHash *= 1099511628211ull;
+        }
+    }
+
+    std::uint64_t Get() const
+    {
+        return m_uHash;
+    }
+
+private:
+    std::uint64_t m_uHash = 14695981039346656037ull;
+};
+
+std::uint64_t ComputeCacheKey(DistortionParameters const &oParameters, std::uint32_t uResolution)
+{
+    Fnv1a oHash{};
+    oHash.Add(S_aModelName, sizeof(S_aModelName));
+    oHash.Add(&oParameters.m_fK0, sizeof(oParameters.m_fK0));
+    oHash.Add(&oParameters.m_fK1, sizeof(oParameters.m_fK1));
+    oHash.Add(&oParameters.m_fScale, sizeof(oParameters.m_fScale));
+    oHash.Add(&uResolution, sizeof(uResolution));
+    return oHash.Get();
+}
+
+std::string GetCacheFileName(std::string const &strCacheDirectory, std::uint64_t uKey)
+{
+    char aKey[S_uCacheKeyDigits + 1u]{};
+    std::snprintf(aKey, sizeof(aKey), "%016llx", static_cast<unsigned long long>(uKey));
+    return strCacheDirectory + "/" + S_aCachePrefix + aKey + S_aCacheSuffix;
+}
+
+std::string GetTempFileName(std::string const &strFileName)
+{
+    // unique per process and per writer, so that concurrent builds of the same key
+    // (server and client provider) never write into each other's file
+#if defined(_WIN32)
+    auto const uProcessId = static_cast<unsigned long>(GetCurrentProcessId());
+#else // ! _WIN32
+    auto const uProcessId = static_cast<unsigned long>(getpid());
+#endif // ! _WIN32
+    return strFileName + "." + std::to_string(uProcessId) + "." + std::to_string(S_uTempFileCounter++) + ".tmp";
+}
+
+bool IsCacheFileName(std::string const &strName)
+{
+    auto const uPrefixLength = sizeof(S_aCachePrefix) - 1u;
+    auto const uSuffixLength = sizeof(S_aCacheSuffix) - 1u;
+    if (strName.size() != uPrefixLength + S_uCacheKeyDigits + uSuffixLength
+        || strName.compare(0, uPrefixLength, S_aCachePrefix) != 0
+        || strName.compare(uPrefixLength + S_uCacheKeyDigits, uSuffixLength, S_aCacheSuffix) != 0)
+    {
+        return false;
+    }
+    return std::all_of(strName.begin() + static_cast<std::ptrdiff_t>(uPrefixLength),
+        strName.begin() + static_cast<std::ptrdiff_t>(uPrefixLength + S_uCacheKeyDigits),
+        [](char c) { return std::isxdigit(static_cast<unsigned char>(c)) != 0; });
+}
+
+struct CacheFile final
+{
+    std::string m_strFileName;
+    // modification time, bumped on every use, see TouchCacheFile
+    std::uint64_t m_uLastUse;
+};
+
+std::vector<CacheFile> ListCacheFiles(std::string const &strCacheDirectory)
+{
+    std::vector<CacheFile> vecFiles{};
+#if defined(_WIN32)
+    WIN32_FIND_DATAA oFindData{};
+    auto const strPattern = strCacheDirectory + "/" + S_aCachePrefix + "*" + S_aCacheSuffix;
+    auto const hFind = FindFirstFileA(strPattern.c_str(), &oFindData);
+    if (hFind == INVALID_HANDLE_VALUE)
+    {
+        return vecFiles;
+    }
+    do
+    {
+        if (IsCacheFileName(oFindData.cFileName))
+        {
+            auto const uLastUse = (static_cast<std::uint64_t>(oFindData.ftLastWriteTime.dwHighDateTime) << 32u)
+                | oFindData.ftLastWriteTime.dwLowDateTime;
+            vecFiles.push_back(CacheFile{strCacheDirectory + "/" + oFindData.cFileName, uLastUse});
+        }
+    }
+    while (FindNextFileA(hFind, &oFindData));
+    FindClose(hFind);
+#else // ! _WIN32
+    auto *pDirectory = opendir(strCacheDirectory.c_str());
+    if (pDirectory == nullptr)
+    {
+        return vecFiles;
+    }
+    while (auto const *pEntry = readdir(pDirectory))
+    {
+        struct stat oStat{};
+        auto strFileName = strCacheDirectory + "/" + pEntry->d_name;
+        if (IsCacheFileName(pEntry->d_name) && stat(strFileName.c_str(), &oStat) == 0)
+        {
+            vecFiles.push_back(CacheFile{std::move(strFileName), static_cast<std::uint64_t>(oStat.st_mtime)});
+        }
+    }
+    closedir(pDirectory);
+#endif // ! _WIN32
+    return vecFiles;
+}
+
+// marks the table as used now, RemoveStaleCacheFiles keeps the most recently used ones
+void TouchCacheFile(std::string const &strFileName)
+{
+#if defined(_WIN32)
+    auto const hFile = CreateFileA(strFileName.c_str(), FILE_WRITE_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (hFile != INVALID_HANDLE_VALUE)
+    {
+        FILETIME oNow{};
+        GetSystemTimeAsFileTime(&oNow);
+        SetFileTime(hFile, nullptr, nullptr, &oNow);
+        CloseHandle(hFile);
+    }
+#else // ! _WIN32
+    utime(strFileName.c_str(), nullptr);
+#endif // ! _WIN32
+}
+
+void RemoveStaleCacheFiles(std::string const &strCacheDirectory, std::string const &strCurrentFileName)
+{
+    // keeps the current table and the most recently used others, every parameter change would
+    // otherwise leave a table behind; a file another process still maps is unlinked (POSIX)
+    // or left for a later pass (Windows)
+    auto vecFiles = ListCacheFiles(strCacheDirectory);
+    std::sort(begin(vecFiles), end(vecFiles), [](CacheFile const &lhs, CacheFile const &rhs)
+    {
+        return lhs.m_uLastUse > rhs.m_uLastUse;
+    });
+    std::size_t uKept = 1u;
+    for (auto const &oFile : vecFiles)
+    {
+        if (oFile.m_strFileName == strCurrentFileName)
+        {
+            continue;
+        }
+        if (uKept < DistortionTable::S_uCachedTables)
+        {
+            ++uKept;
+            continue;
+        }
+        std::remove(oFile.m_strFileName.c_str());
+    }
+}
+
+vr::DistortionCoordinates_t Lerp(vr::DistortionCoordinates_t const &a, vr::DistortionCoordinates_t const &b, float t)
+{
+    vr::DistortionCoordinates_t oResult{};
+    for (int i = 0; i < 2; ++i)
+    {
+        oResult.rfRed[i] = a.rfRed[i] + (b.rfRed[i] - a.rfRed[i]) * t;
+        oResult.rfGreen[i] = a.rfGreen[i] + (b.rfGreen[i] - a.rfGreen[i]) * t;
+        oResult.rfBlue[i] = a.rfBlue[i] + (b.rfBlue[i] - a.rfBlue[i]) * t;
+    }
+    return oResult;
+}
+
+} // unnamed namespace
+
+bool operator==(DistortionParameters const &lhs, DistortionParameters const &rhs)
+{
+    return lhs.m_fK0 == rhs.m_fK0 && lhs.m_fK1 == rhs.m_fK1 && lhs.m_fScale == rhs.m_fScale;
+}
+
+bool IsValidDistortion(DistortionParameters const &oParameters)
+{
+    // written so that NaN fails every comparison
+    if (!(oParameters.m_fK0 >= -S_fMaxCoefficient && oParameters.m_fK0 <= S_fMaxCoefficient)
+        || !(oParameters.m_fK1 >= -S_fMaxCoefficient && oParameters.m_fK1 <= S_fMaxCoefficient)
+        || !(oParameters.m_fScale >= S_fMinScale && oParameters.m_fScale <= S_fMaxScale))
+    {
+        return false;
+    }
+    // the radius of the image grows with r as long as 1 + 3 k0 r^2 + 5 k1 r^4 > 0, the
+    // quadratic in r^2 is smallest at either end of [0, S_fMaxRadius2] or at its vertex
+    auto const Slope = [&oParameters](float r2)
+    {
+        return 1.0f + 3.0f * oParameters.m_fK0 * r2 + 5.0f * oParameters.m_fK1 * r2 * r2;
+    };
+    auto fMinSlope = std::min(Slope(0.0f), Slope(S_fMaxRadius2));
+    if (oParameters.m_fK1 > 0.0f)
+    {
+        auto const fVertex = -3.0f * oParameters.m_fK0 / (10.0f * oParameters.m_fK1);
+        if (fVertex > 0.0f && fVertex < S_fMaxRadius2)
+        {
+            fMinSlope = std::min(fMinSlope, Slope(fVertex));
+        }
+    }
+    return fMinSlope > 0.0f;
+}
+
+vr::DistortionCoordinates_t ComputeRadialDistortion(DistortionParameters const &oParameters, float fU, float fV)
+{
+    auto const r2 = (fU - 0.5f) * (fU - 0.5f) + (fV - 0.5f) * (fV - 0.5f);
+    auto const r4 = r2 * r2;
+    auto const dist = (1.0f + oParameters.m_fK0 * r2 + oParameters.m_fK1 * r4);
+    fU = (((fU * 2.0f - 1.0f) * dist) * oParameters.m_fScale + 1.0f) * 0.5f;
+    fV = (((fV * 2.0f - 1.0f) * dist) * oParameters.m_fScale + 1.0f) * 0.5f;
+
+    vr::DistortionCoordinates_t oDistortion{};
+    oDistortion.rfBlue[0] = fU;
+    oDistortion.rfBlue[1] = fV;
+    oDistortion.rfGreen[0] = fU;
+    oDistortion.rfGreen[1] = fV;
+    oDistortion.rfRed[0] = fU;
+    oDistortion.rfRed[1] = fV;
+    return oDistortion;
+}
+
+SampledBounds ComputeSampledBounds(DistortionParameters const &oParameters)
+{
+    // the radial model is monotonic along rays from the lens center, so the image
+    // of the viewport's border bounds the image of the whole viewport
+    static std::uint32_t const S_uSamplesPerEdge = 64u;
+    SampledBounds oBounds{1.0f, 0.0f, 1.0f, 0.0f};
+    auto const Extend = [&oBounds, &oParameters](float fU, float fV)
+    {
+        auto const oDistortion = ComputeRadialDistortion(oParameters, fU, fV);
+        for (auto const *pChannel : {oDistortion.rfRed, oDistortion.rfGreen, oDistortion.rfBlue})
+        {
+            oBounds.m_fUMin = std::min(oBounds.m_fUMin, pChannel[0]);
+            oBounds.m_fUMax = std::max(oBounds.m_fUMax, pChannel[0]);
+            oBounds.m_fVMin = std::min(oBounds.m_fVMin, pChannel[1]);
+            oBounds.m_fVMax = std::max(oBounds.m_fVMax, pChannel[1]);
+        }
+    };
+    for (std::uint32_t i = 0; i <= S_uSamplesPerEdge; ++i)
+    {
+        auto const fT = static_cast<float>(i) / static_cast<float>(S_uSamplesPerEdge);
+        Extend(fT, 0.0f);
+        Extend(fT, 1.0f);
+        Extend(0.0f, fT);
+        Extend(1.0f, fT);
+    }
+    // never render more than the nominal frustum, and never an empty one
+    oBounds.m_fUMin = std::min(std::max(oBounds.m_fUMin, 0.0f), 0.5f - 1e-3f);
+    oBounds.m_fUMax = std::max(std::min(oBounds.m_fUMax, 1.0f), 0.5f + 1e-3f);
+    oBounds.m_fVMin = std::min(std::max(oBounds.m_fVMin, 0.0f), 0.5f - 1e-3f);
+    oBounds.m_fVMax = std::max(std::min(oBounds.m_fVMax, 1.0f), 0.5f + 1e-3f);
+    return oBounds;
+}
+
+class DistortionTable::DistortionTableImpl
+{
+public:
+    DistortionTableImpl(DistortionParameters const &oParameters, std::uint32_t uResolution, std::string const &strCacheDirectory):
+        m_oParameters(oParameters),
+        m_uResolution{std::min(std::max(uResolution, 2u), DistortionTable::S_uMaxResolution)},
+        m_uKey{ComputeCacheKey(oParameters, m_uResolution)},
+        m_pFileMapping{},
+        m_pMappedRegion{},
+        m_vecEntries{},
+        m_pEntries{}
+    {
+        if (strCacheDirectory.empty())
+        {
+            Compute();
+            return;
+        }
+        auto const strFileName = GetCacheFileName(strCacheDirectory, m_uKey);
+        if (MapCacheFile(strFileName))
+        {
+            TouchCacheFile(strFileName);
+        }
+        else
+        {
+            Compute();
+            if (WriteCacheFile(strFileName))
+            {
+                RemoveStaleCacheFiles(strCacheDirectory, strFileName);
+                if (MapCacheFile(strFileName))
+                {
+                    m_vecEntries.clear();
+                    m_vecEntries.shrink_to_fit();
+                }
+            }
+        }
+    }
+
+    vr::DistortionCoordinates_t Sample(float fU, float fV) const
+    {
+        auto const fMax = static_cast<float>(m_uResolution - 1u);
+        auto const fX = std::min(std::max(fU, 0.0f), 1.0f) * fMax;
+        auto const fY = std::min(std::max(fV, 0.0f), 1.0f) * fMax;
+        auto const uX = std::min(static_cast<std::uint32_t>(fX), m_uResolution - 2u);
+        auto const uY = std::min(static_cast<std::uint32_t>(fY), m_uResolution - 2u);
+        auto const fTx = fX - static_cast<float>(uX);
+        auto const fTy = fY - static_cast<float>(uY);
+
+        auto const *pRow0 = &m_pEntries[static_cast<std::size_t>(uY) * m_uResolution];
+        auto const *pRow1 = pRow0 + m_uResolution;
+        return Lerp(Lerp(pRow0[uX], pRow0[uX + 1u], fTx), Lerp(pRow1[uX], pRow1[uX + 1u], fTx), fTy);
+    }
+
+    DistortionParameters const &GetParameters() const
+    {
+        return m_oParameters;
+    }
+
+    std::uint32_t GetResolution() const
+    {
+        return m_uResolution;
+    }
+
+    bool GetIsMapped() const
+    {
+        return m_pMappedRegion != nullptr;
+    }
+
+private:
+    std::size_t GetEntryCount() const
+    {
+        return static_cast<std::size_t>(m_uResolution) * m_uResolution;
+    }
+
+    void Compute()
+    {
+        auto const fMax = static_cast<float>(m_uResolution - 1u);
+        m_vecEntries.resize(GetEntryCount());
+        for (std::uint32_t uY = 0; uY < m_uResolution; ++uY)
+        {
+            for (std::uint32_t uX = 0; uX < m_uResolution; ++uX)
+            {
+                m_vecEntries[static_cast<std::size_t>(uY) * m_uResolution + uX] = ComputeRadialDistortion(
+                    m_oParameters, static_cast<float>(uX) / fMax, static_cast<float>(uY) / fMax);
+            }
+        }
+        m_pEntries = m_vecEntries.data();
+    }
+
+    bool MapCacheFile(std::string const &strFileName)
+    {
+        try
+        {
+            auto pFileMapping = std::make_unique<file_mapping>(strFileName.c_str(), read_only);
+            auto pMappedRegion = std::make_unique<mapped_region>(*pFileMapping, read_only);
+            auto const uExpectedSize = sizeof(CacheFileHeader) + GetEntryCount() * sizeof(vr::DistortionCoordinates_t);
+            if (pMappedRegion->get_size() != uExpectedSize)
+            {
+                return false;
+            }
+            auto const *pHeader = static_cast<CacheFileHeader const *>(pMappedRegion->get_address());
+            if (std::memcmp(pHeader->m_aMagic, S_aCacheMagic, sizeof(S_aCacheMagic)) != 0
+                || pHeader->m_uVersion != S_uCacheVersion
+                || pHeader->m_uResolution != m_uResolution
+                || pHeader->m_uKey != m_uKey)
+            {
+                return false;
+            }
+            m_pEntries = reinterpret_cast<vr::DistortionCoordinates_t const *>(pHeader + 1);
+            m_pFileMapping = std::move(pFileMapping);
+            m_pMappedRegion = std::move(pMappedRegion);
+            return true;
+        }
+        catch (...)
+        {
+            return false;
+        }
+    }
+
+    bool WriteCacheFile(std::string const &strFileName) const
+    {
+        // write to a temporary file first, readers must never map a partially written table
+        auto const strTempFileName = GetTempFileName(strFileName);
+        {
+            std::ofstream oFile{strTempFileName, std::ios::binary | std::ios::trunc};
+            if (!oFile)
+            {
+                return false;
+            }
+            CacheFileHeader oHeader{};
+            std::memcpy(oHeader.m_aMagic, S_aCacheMagic, sizeof(S_aCacheMagic));
+            oHeader.m_uVersion = S_uCacheVersion;
+            oHeader.m_uResolution = m_uResolution;
+            oHeader.m_uKey = m_uKey;
+            oFile.write(reinterpret_cast<char const *>(&oHeader), sizeof(oHeader));
+            oFile.write(reinterpret_cast<char const *>(m_vecEntries.data()),
+                static_cast<std::streamsize>(m_vecEntries.size() * sizeof(vr::DistortionCoordinates_t)));
+            if (!oFile)
+            {
+                oFile.close();
+                std::remove(strTempFileName.c_str());
+                return false;
+            }
+        }
+        std::remove(strFileName.c_str());
+        if (std::rename(strTempFileName.c_str(), strFileName.c_str()) != 0)
+        {
+            std::remove(strTempFileName.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    DistortionParameters const m_oParameters;
+    std::uint32_t const m_uResolution;
+    std::uint64_t const m_uKey;
+    std::unique_ptr<file_mapping> m_pFileMapping;
+    std::unique_ptr<mapped_region> m_pMappedRegion;
+    std::vector<vr::DistortionCoordinates_t> m_vecEntries;
+    vr::DistortionCoordinates_t const *m_pEntries;
+};
+
+std::uint32_t const DistortionTable::S_uMaxResolution;
+std::size_t const DistortionTable::S_uCachedTables;
+
+DistortionTable::DistortionTable(DistortionParameters const &oParameters, std::uint32_t uResolution, std::string const &strCacheDirectory):
+    m_pImpl{std::make_unique<DistortionTableImpl>(oParameters, uResolution, strCacheDirectory)}
+{
+
+}
+
+DistortionTable::~DistortionTable() = default;
+
+vr::DistortionCoordinates_t DistortionTable::Sample(float fU, float fV) const
+{
+    return m_pImpl->Sample(fU, fV);
+}
+
+DistortionParameters const &DistortionTable::GetParameters() const
+{
+    return m_pImpl->GetParameters();
+}
+
+std::uint32_t DistortionTable::GetResolution() const
+{
+    return m_pImpl->GetResolution();
+}
+
+bool DistortionTable::GetIsMapped() const
+{
+    return m_pImpl->GetIsMapped();
+}
+
+} // namespace spvr
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2016
+ *  Somebody
+ */
+#ifndef SPVR_DISTORTIONTABLE_H
+#define SPVR_DISTORTIONTABLE_H
+
+#include "openvr_driver.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace spvr
+{
+
+struct DistortionParameters final
+{
+    // radial distortion coefficients Ki for google cardboard v1: 0.441, 0.156
+    float m_fK0 = 0.441f;
+    float m_fK1 = 0.156f;
+    float m_fScale = 1.0f;
+};
+
+bool operator==(DistortionParameters const &lhs, DistortionParameters const &rhs);
+
+// true if the coefficients and the scale are finite and in range, and the model grows
+// monotonically along rays from the lens center, which ComputeSampledBounds relies on
+bool IsValidDistortion(DistortionParameters const &oParameters);
+
+// evaluates the radial distortion model directly, (fU, fV) in [0, 1] of the eye's viewport
+vr::DistortionCoordinates_t ComputeRadialDistortion(DistortionParameters const &oParameters, float fU, float fV);
+
+// Part of the nominal [0, 1] render target uv range that the distortion actually samples
+// when an eye's viewport is drawn, i.e. the bounding box of the viewport's image. The lens
+// model is centered in each eye's viewport, so the bounds are symmetric and the same for
+// both eyes; they only get tighter than [0, 1] where the model shrinks the image.
+struct SampledBounds final
+{
+    float m_fUMin = 0.0f;
+    float m_fUMax = 1.0f;
+    float m_fVMin = 0.0f;
+    float m_fVMax = 1.0f;
+};
+
+SampledBounds ComputeSampledBounds(DistortionParameters const &oParameters);
+
+// Precomputed (uResolution x uResolution) grid of the distortion model. The grid is
+// persisted in strCacheDirectory, keyed by a hash of model, coefficients and resolution,
+// and mapped read-only on the next start instead of being recomputed. The directory keeps
+// the S_uCachedTables most recently used tables, switching between a few lenses never
+// rebuilds one.
+class DistortionTable final
+{
+public:
+    // uResolution is clamped to [2, S_uMaxResolution], the largest table takes about 25 MB
+    static std::uint32_t const S_uMaxResolution = 1025u;
+    static std::size_t const S_uCachedTables = 4u;
+
+    DistortionTable(DistortionParameters const &oParameters, std::uint32_t uResolution, std::string const &strCacheDirectory);
+    ~DistortionTable();
+
+    // bilinear lookup, (fU, fV) are clamped to [0, 1]
+    vr::DistortionCoordinates_t Sample(float fU, float fV) const;
+
+    DistortionParameters const &GetParameters() const;
+    std::uint32_t GetResolution() const;
+    // true if the table is backed by the memory-mapped cache file
+    bool GetIsMapped() const;
+
+private:
+    class DistortionTableImpl;
+    std::unique_ptr<DistortionTableImpl> m_pImpl;
+};
+
+} // namespace spvr
+
+#endif // SPVR_DISTORTIONTABLE_H
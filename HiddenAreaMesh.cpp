@@ -0,0 +1,173 @@
+/*
+ * Copyright (c) 2016
+ *  Somebody
+ */
+#include "HiddenAreaMesh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+namespace spvr
+{
+
+namespace
+{
+
+vr::HmdVector2_t MakeVector(float fU, float fV)
+{
+    vr::HmdVector2_t oVector{};
+    oVector.v[0] = fU;
+    oVector.v[1] = fV;
+    return oVector;
+}
+
+float GetLength(float fU, float fV)
+{
+    return std::sqrt(fU * fU + fV * fV);
+}
+
+// walks the border of the unit square counter-clockwise, fT in [0, 4)
+vr::HmdVector2_t GetBorderPoint(float fT)
+{
+    if (fT < 1.0f)
+    {
+        return MakeVector(fT, 0.0f);
+    }
+    if (fT < 2.0f)
+    {
+        return MakeVector(1.0f, fT - 1.0f);
+    }
+    if (fT < 3.0f)
+    {
+        return MakeVector(3.0f - fT, 1.0f);
+    }
+    return MakeVector(0.0f, 4.0f - fT);
+}
+
+// The render target covers the sampled bounds, the lens center is at oCenter in its uv.
+// A ray from the center through a render target point is the image of a ray from the
+// viewport's center, so the visible region is star-shaped around oCenter.
+class RenderTargetRays final
+{
+public:
+    RenderTargetRays(DistortionParameters const &oParameters, SampledBounds const &oBounds):
+        m_oParameters(oParameters),
+        m_fExtentU{oBounds.m_fUMax - oBounds.m_fUMin},
+        m_fExtentV{oBounds.m_fVMax - oBounds.m_fVMin},
+        m_oCenter{MakeVector((0.5f - oBounds.m_fUMin) / m_fExtentU, (0.5f - oBounds.m_fVMin) / m_fExtentV)}
+    {
+
+    }
+
+    vr::HmdVector2_t const &GetCenter() const
+    {
+        return m_oCenter;
+    }
+
+    // fraction of the way from the center to oPoint at which the visible region ends,
+    // >= 1 if the ray is visible up to oPoint
+    float GetVisibleFraction(vr::HmdVector2_t const &oPoint) const
+    {
+        // the same ray in the lens model's uv, the viewport ends where the preimage's
+        // larger coordinate offset reaches 0.5
+        auto const fU = (oPoint.v[0] - m_oCenter.v[0]) * m_fExtentU;
+        auto const fV = (oPoint.v[1] - m_oCenter.v[1]) * m_fExtentV;
+        auto const fLength = GetLength(fU, fV);
+        if (fLength <= 0.0f)
+        {
+            return 1.0f;
+        }
+        auto const fScale = 0.5f / std::max(std::fabs(fU), std::fabs(fV));
+        auto const oDistortion = ComputeRadialDistortion(m_oParameters, 0.5f + fU * fScale, 0.5f + fV * fScale);
+        return GetLength(oDistortion.rfGreen[0] - 0.5f, oDistortion.rfGreen[1] - 0.5f) / fLength;
+    }
+
+private:
+    DistortionParameters const m_oParameters;
+    float const m_fExtentU;
+    float const m_fExtentV;
+    vr::HmdVector2_t const m_oCenter;
+};
+
+// rays per segment the visible border is sampled with to place the segment's inner edge
+static std::uint32_t const S_uSamplesPerSegment = 8u;
+// a border point whose ray is visible to within this fraction of the way counts as visible,
+// so rounding in the lens model, e.g. under -ffast-math, never leaves slivers along the border
+static float const S_fVisibleTolerance = 1e-4f;
+
+vr::HmdVector2_t Interpolate(vr::HmdVector2_t const &a, vr::HmdVector2_t const &b, float t)
+{
+    return MakeVector(a.v[0] + (b.v[0] - a.v[0]) * t, a.v[1] + (b.v[1] - a.v[1]) * t);
+}
+
+// Appends the part of the wedge (oCenter, p0, p1) beyond the line through oCenter + fT0 * (p0 - oCenter)
+// and oCenter + fT1 * (p1 - oCenter) as a triangle fan, at most two triangles.
+void AppendHiddenPart(std::vector<vr::HmdVector2_t> &vecTriangles, vr::HmdVector2_t const &oCenter,
+    vr::HmdVector2_t const &p0, vr::HmdVector2_t const &p1, float fT0, float fT1)
+{
+    // in wedge coordinates x = oCenter + l * (p0 - oCenter) + m * (p1 - oCenter) the line is
+    // l / fT0 + m / fT1 = 1, so the signed distance is affine and known at the three corners;
+    // the line is moved out by the tolerance, which only ever uncovers texels
+    vr::HmdVector2_t const aCorners[3] = {oCenter, p0, p1};
+    float const aDistance[3] = {-1.0f - S_fVisibleTolerance, 1.0f / fT0 - 1.0f - S_fVisibleTolerance,
+        1.0f / fT1 - 1.0f - S_fVisibleTolerance};
+    vr::HmdVector2_t aPolygon[4]{};
+    std::size_t uVertices = 0u;
+    for (std::size_t i = 0; i < 3u; ++i)
+    {
+        auto const j = (i + 1u) % 3u;
+        if (aDistance[i] > 0.0f)
+        {
+            aPolygon[uVertices++] = aCorners[i];
+        }
+        if ((aDistance[i] > 0.0f) != (aDistance[j] > 0.0f))
+        {
+            aPolygon[uVertices++] = Interpolate(aCorners[i], aCorners[j], aDistance[i] / (aDistance[i] - aDistance[j]));
+        }
+    }
+    for (std::size_t i = 2u; i < uVertices; ++i)
+    {
+        vecTriangles.insert(end(vecTriangles), {aPolygon[0], aPolygon[i - 1u], aPolygon[i]});
+    }
+}
+
+} // unnamed namespace
+
+std::vector<vr::HmdVector2_t> BuildHiddenAreaMesh(DistortionParameters const &oParameters, std::uint32_t uSegmentsPerEdge)
+{
+    // The render target's border is walked in segments that never span one of its corners.
+    // Along the ray from the lens center through a border point the visible region ends at
+    // a fraction of the way that follows from the lens model exactly; beyond it nothing is
+    // sampled. Between two rays the visible border is curved, so a segment's inner edge is
+    // pushed out until it clears the border sampled at S_uSamplesPerSegment rays in between.
+    RenderTargetRays const oRays{oParameters, ComputeSampledBounds(oParameters)};
+    auto const &oCenter = oRays.GetCenter();
+    auto const uSegments = 4u * std::max(uSegmentsPerEdge, 1u);
+    auto const GetSegmentStart = [uSegments](std::uint32_t i)
+    {
+        return GetBorderPoint(4.0f * static_cast<float>(i % uSegments) / static_cast<float>(uSegments));
+    };
+
+    std::vector<vr::HmdVector2_t> vecTriangles{};
+    for (std::uint32_t i = 0; i < uSegments; ++i)
+    {
+        auto const p0 = GetSegmentStart(i);
+        auto const p1 = GetSegmentStart(i + 1u);
+        auto const fT0 = std::max(oRays.GetVisibleFraction(p0), 1e-3f);
+        auto const fT1 = std::max(oRays.GetVisibleFraction(p1), 1e-3f);
+        // the sample at w lies on the line scaled by fScale around the center, see AppendHiddenPart
+        auto fScale = 1.0f;
+        for (std::uint32_t j = 1; j < S_uSamplesPerSegment; ++j)
+        {
+            auto const fW = static_cast<float>(j) / static_cast<float>(S_uSamplesPerSegment);
+            auto const fT = oRays.GetVisibleFraction(Interpolate(p0, p1, fW));
+            fScale = std::max(fScale, fT * ((1.0f - fW) / fT0 + fW / fT1));
+        }
+        AppendHiddenPart(vecTriangles, oCenter, p0, p1, fT0 * fScale, fT1 * fScale);
+    }
+    return vecTriangles;
+}
+
+} // namespace spvr
@@ -0,0 +1,28 @@
+/*
+ * Copyright (c) 2016
+ *  Somebody
+ */
+#ifndef SPVR_HIDDENAREAMESH_H
+#define SPVR_HIDDENAREAMESH_H
+
+#include "DistortionTable.h"
+#include "openvr_driver.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace spvr
+{
+
+// Triangle list (three vertices per triangle, UVs of an eye's render target) covering
+// every render target pixel that the distortion never samples, i.e. the render target
+// minus the image of the eye's output viewport under the lens model. The render target
+// is assumed to cover the sampled bounds, like the projection the driver reports; the
+// lens model is centered in each eye's viewport, so both eyes use the same mesh.
+// The mesh never covers a visible pixel, uSegmentsPerEdge controls how closely it follows
+// the visible region's border, at most two triangles per segment.
+std::vector<vr::HmdVector2_t> BuildHiddenAreaMesh(DistortionParameters const &oParameters, std::uint32_t uSegmentsPerEdge = 32u);
+
+} // namespace spvr
+
+#endif // SPVR_HIDDENAREAMESH_H
@@ -4,10 +4,14 @@
  */
 #include "HmdDriver.h"
 
+#include "CommandQueue.h"
 #include "Context.h"
 #include "ControlInterface.h"
+#include "DebugRequestHandler.h"
+#include "LensState.h"
 #include "Logger.h"
 #include "PoseUpdater.h"
+#include "Tracer.h"
 
 #include "glm/glm.hpp"
 #include "glm/gtc/matrix_transform.hpp"
@@ -16,7 +20,9 @@
 #include <boost/array.hpp>
 #include <boost/asio.hpp>
 
+#include <algorithm>
 #include <chrono>
+#include <cmath>
 #include <cstring>
 #include <fstream>
 #include <memory>
@@ -25,10 +31,12 @@
 namespace spvr
 {
 
-HmdDriver::HmdDriver(vr::IServerDriverHost *pServerDriverHost, Logger *pDriverLog):
+HmdDriver::HmdDriver(vr::IServerDriverHost *pServerDriverHost, Logger *pDriverLog, std::string const &strUserDriverConfigDir):
     m_pServerDriverHost{pServerDriverHost},
     m_pDriverLog{pDriverLog},
-    m_pPoseUpdater{std::make_unique<PoseUpdater>(*pDriverLog, *this)},
+    m_rControlInterface(Context::GetInstance().GetControlInterface()),
+    m_rTracer(Context::GetInstance().GetTracer()),
+    m_pPoseUpdater{},
     m_uObjectId{vr::k_unTrackedDeviceIndexInvalid},
     m_sSerialNumber("SPVR0815"),
     m_sModelNumber("SmartPhoneVR Driver 0x0000"),
@@ -39,29 +47,62 @@ HmdDriver::HmdDriver(vr::IServerDriverHost *pServerDriverHost, Logger *pDriverLo
     m_iWindowY{},
     m_iWindowWidth{1280},
     m_iWindowHeight{720},
-    m_iRenderWidth{640},
-    m_iRenderHeight{360},
     m_oPoseUpdateThread{},
-    m_fDistortionK0{0.441f},
-    m_fDistortionK1{0.156f},
-    m_fDistortionScale{1.0f}
+    m_pLensStateUpdater{},
+    m_pLensState{},
+    m_uNotifiedLensGeneration{},
+    m_fRecenterYaw{0.0f},
+    m_pDebugRequestHandler{}
 {
     auto pSettings = pServerDriverHost->GetSettings(vr::IVRSettings_Version);
     m_fIPD = pSettings->GetFloat(vr::k_pch_SteamVR_Section, vr::k_pch_SteamVR_IPD_Float, 0.063f);
-    m_fDistortionK0 = pSettings->GetFloat("spvr", "distortion-k0", m_fDistortionK0);
-    m_fDistortionK1 = pSettings->GetFloat("spvr", "distortion-k1", m_fDistortionK1);
-
-    auto &rControlInterface = Context::GetInstance().GetControlInterface();
-    rControlInterface.GetDistortionCoefficients(m_fDistortionK0, m_fDistortionK1);
-    m_fDistortionScale = rControlInterface.GetDistortionScale();
-
-    /*m_iWindowWidth = 2160;
-    m_iWindowHeight = 1200;*/
-    m_iRenderWidth = 1512;
-    m_iRenderHeight = 1680;
+    auto const oDefaultParameters = ReadDefaultDistortionParameters(pSettings);
+    auto const iDistortionGrid = pSettings->GetInt32("spvr", "distortion-grid", 129);
+
+
+    m_iWindowWidth = pSettings->GetInt32("spvr", "window-width", m_iWindowWidth);
+    m_iWindowHeight = pSettings->GetInt32("spvr", "window-height", m_iWindowHeight);
+    DisplayConfiguration oDisplay{};
+    oDisplay.m_iWindowWidth = m_iWindowWidth;
+    oDisplay.m_iWindowHeight = m_iWindowHeight;
+    oDisplay.m_fRenderQuality = pSettings->GetFloat("spvr", "render-quality", oDisplay.m_fRenderQuality);
+    oDisplay.m_fPixelsPerDegree = pSettings->GetFloat("spvr", "pixels-per-degree", oDisplay.m_fPixelsPerDegree);
+
+    m_pLensStateUpdater = std::make_unique<LensStateUpdater>(m_rControlInterface, m_pDriverLog, oDisplay,
+        oDefaultParameters, static_cast<std::uint32_t>(std::min(std::max(iDistortionGrid, 2), static_cast<std::int32_t>(DistortionTable::S_uMaxResolution))),
+        strUserDriverConfigDir);
+    m_pLensState = m_pLensStateUpdater->GetLensState();
+    m_uNotifiedLensGeneration = m_pLensState->GetGeneration();
+
+    PoseUpdaterConfiguration oPoseUpdater{};
+    if (pSettings->GetBool("spvr", "capture", false) && !strUserDriverConfigDir.empty())
+    {
+        oPoseUpdater.m_strCaptureFile = strUserDriverConfigDir + "/spvr-capture.bin";
+        oPoseUpdater.m_uCaptureSize = static_cast<std::uint64_t>(std::max(pSettings->GetInt32("spvr", "capture-mb", 64), 1)) << 20;
+    }
+    char aReplayFile[1024] = {};
+    pSettings->GetString("spvr", "replay-file", aReplayFile, sizeof(aReplayFile), "");
+    oPoseUpdater.m_strReplayFile = aReplayFile;
+    char aReplayTiming[32] = {};
+    pSettings->GetString("spvr", "replay-timing", aReplayTiming, sizeof(aReplayTiming), "original");
+    if (std::strcmp(aReplayTiming, "fast") == 0)
+    {
+        oPoseUpdater.m_eReplayTiming = ReplayTiming::Fast;
+    }
+    m_pPoseUpdater = std::make_unique<PoseUpdater>(*pDriverLog, *this, oPoseUpdater);
+
+    // "trace on" opens the same file SmartServer::Init would
+    auto const iTraceRecords = pSettings->GetInt32("spvr", "trace-records", static_cast<std::int32_t>(Tracer::S_uDefaultCapacity));
+    m_pDebugRequestHandler = std::make_unique<DebugRequestHandler>(m_rControlInterface, m_rTracer, *m_pPoseUpdater, m_pDriverLog,
+        oDefaultParameters, strUserDriverConfigDir.empty() ? std::string{} : strUserDriverConfigDir + "/spvr-trace.bin",
+        static_cast<std::uint64_t>(std::max(iTraceRecords, 1)));
 }
 
-HmdDriver::~HmdDriver() = default;
+HmdDriver::~HmdDriver()
+{
+    // the pose thread reads the members below, join it before they go
+    Deactivate();
+}
 
 char const *HmdDriver::GetSerialNumber() const
 {
@@ -75,21 +116,51 @@ char const *HmdDriver::GetModelNumber() const
 
 vr::EVRInitError HmdDriver::Activate(std::uint32_t uObjectId)
 {
-    if (m_pDriverLog)
-    {
-        m_pDriverLog->Debug(std::string{"HmdDriver::Activate("} +std::to_string(uObjectId) + ")\n");
-    }
+    SPVR_LOG_DEBUG(m_pDriverLog, std::string{"HmdDriver::Activate("} +std::to_string(uObjectId) + ")\n");
     m_uObjectId = uObjectId;
     m_oPoseUpdateThread = std::thread{
         [this]()
         {
             volatile auto uObjectId = m_uObjectId;
             vr::DriverPose_t pose;
+            std::uint64_t uPublishedSendTime = 0u;
+            std::uint64_t uPublishedSampleTime = 0u;
+            auto const pTelemetry = m_rControlInterface.GetTelemetry();
             while (uObjectId != vr::k_unTrackedDeviceIndexInvalid)
             {
                 std::this_thread::sleep_for(std::chrono::milliseconds{1});
+                // before the pose, which then holds this sample or a newer one
+                auto const uSampleTime = m_pPoseUpdater->GetLastSampleTime();
+                auto const uHandOffTime = m_pPoseUpdater->GetLastHandOffTime();
+                auto const uPickup = pTelemetry ? Tracer::Now() : 0u;
                 pose = GetPose();
                 m_pServerDriverHost->TrackedDevicePoseUpdated(uObjectId, pose);
+                auto const uNow = Tracer::Now();
+                m_rTracer.Record(TraceEvent::PosePublished, uObjectId,
+                    uSampleTime != 0u ? static_cast<std::int64_t>(uNow - uSampleTime) : 0);
+                if (pTelemetry)
+                {
+                    pTelemetry->m_oPosesPublished.Add();
+                    if (uSampleTime != 0u)
+                    {
+                        pTelemetry->m_oSampleAge.Record(uNow - uSampleTime);
+                    }
+                    // the stages once per sample, like the send time below
+                    if (uSampleTime != uPublishedSampleTime && uSampleTime != 0u)
+                    {
+                        uPublishedSampleTime = uSampleTime;
+                        pTelemetry->m_oStagePickup.Record(uPickup - std::min(uHandOffTime, uPickup));
+                        pTelemetry->m_oStagePublish.Record(uNow - uPickup);
+                        pTelemetry->m_oStageEndToEnd.Record(uNow - uSampleTime);
+                    }
+                    // once per sample, it is published again until the next one arrives
+                    auto const uSendTime = m_pPoseUpdater->GetLastSendTime();
+                    if (uSendTime != uPublishedSendTime && uSendTime != 0u && uSendTime <= uNow)
+                    {
+                        uPublishedSendTime = uSendTime;
+                        pTelemetry->m_oSendToPublish.Record(uNow - uSendTime);
+                    }
+                }
                 uObjectId = m_uObjectId;
             }
         }
@@ -99,10 +170,7 @@ vr::EVRInitError HmdDriver::Activate(std::uint32_t uObjectId)
 
 void HmdDriver::Deactivate()
 {
-    if (m_pDriverLog)
-    {
-        m_pDriverLog->Debug("HmdDriver::Deactivate()\n");
-    }
+    SPVR_LOG_DEBUG(m_pDriverLog, "HmdDriver::Deactivate()\n");
     m_uObjectId = vr::k_unTrackedDeviceIndexInvalid;
     if (m_oPoseUpdateThread.joinable())
     {
@@ -121,10 +189,7 @@ void *HmdDriver::GetComponent(char const *pchComponentNameAndVersion)
     {
         return nullptr;
     }
-    if (m_pDriverLog)
-    {
-        m_pDriverLog->Debug(std::string{"HmdDriver::GetComponent("} +pchComponentNameAndVersion + ")\n");
-    }
+    SPVR_LOG_DEBUG(m_pDriverLog, std::string{"HmdDriver::GetComponent("} +pchComponentNameAndVersion + ")\n");
     if (std::string{pchComponentNameAndVersion} == vr::IVRDisplayComponent_Version)
     {
         return static_cast<vr::IVRDisplayComponent *>(this);
@@ -135,10 +200,7 @@ void *HmdDriver::GetComponent(char const *pchComponentNameAndVersion)
 
 void HmdDriver::DebugRequest(char const *pchRequest, char *pchResponseBuffer, std::uint32_t uResponseBufferSize)
 {
-    if (uResponseBufferSize >= 1)
-    {
-        pchResponseBuffer[0] = 0;
-    }
+    m_pDebugRequestHandler->Handle(pchRequest, pchResponseBuffer, uResponseBufferSize);
 }
 
 vr::DriverPose_t HmdDriver::GetPose()
@@ -152,19 +214,21 @@ vr::DriverPose_t HmdDriver::GetPose()
 
     pose.qWorldFromDriverRotation = vr::HmdQuaternion_t{1.0, 0.0, 0.0, 0.0};
     pose.qDriverFromHeadRotation = vr::HmdQuaternion_t{1.0, 0.0, 0.0, 0.0};
-    pose.vecPosition[1] = Context::GetInstance().GetControlInterface().GetHeight();
+    pose.vecPosition[1] = m_rControlInterface.GetHeight();
 
-    glm::quat const qRotation = Context::GetInstance().GetControlInterface().GetRotation();
+    auto const fRecenterYaw = m_fRecenterYaw.load(std::memory_order_relaxed);
+    glm::quat qRotation = m_rControlInterface.GetRotation();
+    if (fRecenterYaw != 0.0f)
+    {
+        qRotation = glm::angleAxis(-fRecenterYaw, glm::vec3{0.0f, 1.0f, 0.0f}) * qRotation;
+    }
 
     pose.qRotation.w = qRotation.w;
     pose.qRotation.x = qRotation.x;
     pose.qRotation.y = qRotation.y;
     pose.qRotation.z = qRotation.z;
 
-    if (m_pDriverLog)
-    {
-        m_pDriverLog->Debug("HmdDriver::GetPose()\n");
-    }
+    SPVR_LOG_DEBUG(m_pDriverLog, "HmdDriver::GetPose()\n");
 
     return pose;
 }
@@ -194,10 +258,7 @@ bool HmdDriver::GetBoolTrackedDeviceProperty(vr::ETrackedDeviceProperty prop, vr
         *pError = error;
     }
 
-    if (m_pDriverLog)
-    {
-        m_pDriverLog->Debug(std::string{"HmdDriver::GetBoolTrackedDeviceProperty("} +std::to_string(prop) + ", ...) => false\n");
-    }
+    SPVR_LOG_DEBUG(m_pDriverLog, std::string{"HmdDriver::GetBoolTrackedDeviceProperty("} +std::to_string(prop) + ", ...) => false\n");
 
     return bRetVal;
 }
@@ -238,10 +299,7 @@ float HmdDriver::GetFloatTrackedDeviceProperty(vr::ETrackedDeviceProperty prop,
         *pError = error;
     }
 
-    if (m_pDriverLog)
-    {
-        m_pDriverLog->Debug(std::string{"HmdDriver::GetFloatTrackedDeviceProperty("} +std::to_string(prop) + ", ...) => " + std::to_string(fRetVal) + "\n");
-    }
+    SPVR_LOG_DEBUG(m_pDriverLog, std::string{"HmdDriver::GetFloatTrackedDeviceProperty("} +std::to_string(prop) + ", ...) => " + std::to_string(fRetVal) + "\n");
 
     return fRetVal;
 }
@@ -269,10 +327,7 @@ std::int32_t HmdDriver::GetInt32TrackedDeviceProperty(vr::ETrackedDeviceProperty
         *pError = error;
     }
 
-    if (m_pDriverLog)
-    {
-        m_pDriverLog->Debug(std::string{"HmdDriver::GetInt32TrackedDeviceProperty("} +std::to_string(prop) + ", ...) => " + std::to_string(iRetVal) + "\n");
-    }
+    SPVR_LOG_DEBUG(m_pDriverLog, std::string{"HmdDriver::GetInt32TrackedDeviceProperty("} +std::to_string(prop) + ", ...) => " + std::to_string(iRetVal) + "\n");
 
     return iRetVal;
 }
@@ -294,20 +349,14 @@ std::uint64_t HmdDriver::GetUint64TrackedDeviceProperty(vr::ETrackedDeviceProper
     }
     }
 
-    if (m_pDriverLog)
-    {
-        m_pDriverLog->Debug("HmdDriver::GetUint64TrackedDeviceProperty(...)\n");
-    }
+    SPVR_LOG_DEBUG(m_pDriverLog, "HmdDriver::GetUint64TrackedDeviceProperty(...)\n");
 
     return 0;
 }
 
 vr::HmdMatrix34_t HmdDriver::GetMatrix34TrackedDeviceProperty(vr::ETrackedDeviceProperty prop, vr::ETrackedPropertyError *pError)
 {
-    if (m_pDriverLog)
-    {
-        m_pDriverLog->Debug(std::string{"HmdDriver::GetMatrix34TrackedDeviceProperty("} +std::to_string(prop) + ")\n");
-    }
+    SPVR_LOG_DEBUG(m_pDriverLog, std::string{"HmdDriver::GetMatrix34TrackedDeviceProperty("} +std::to_string(prop) + ")\n");
     *pError = vr::TrackedProp_ValueNotProvidedByDevice;
     vr::HmdMatrix34_t matIdentity{};
 
@@ -376,10 +425,7 @@ std::string HmdDriver::GetStringTrackedDeviceProperty(vr::ETrackedDeviceProperty
     }
     }
 
-    if (m_pDriverLog)
-    {
-        m_pDriverLog->Debug(std::string{"HmdDriver::GetStringTrackedDeviceProperty("} +std::to_string(prop) + ", ...) => \"" + strRetVal + "\"\n");
-    }
+    SPVR_LOG_DEBUG(m_pDriverLog, std::string{"HmdDriver::GetStringTrackedDeviceProperty("} +std::to_string(prop) + ", ...) => \"" + strRetVal + "\"\n");
 
     return strRetVal;
 }
@@ -390,25 +436,68 @@ void HmdDriver::RunFrame()
     // In a real driver, this should happen from some pose tracking thread.
     // The RunFrame interval is unspecified and can be very irregular if some other
     // driver blocks it for some periodic task.
+    if (m_pLensStateUpdater->GetPublishedGeneration() != m_pLensState->GetGeneration())
+    {
+        m_pLensState = m_pLensStateUpdater->GetLensState();
+    }
     if (m_uObjectId != vr::k_unTrackedDeviceIndexInvalid)
     {
+        auto const uLensGeneration = m_pLensState->GetGeneration();
+        if (uLensGeneration != m_uNotifiedLensGeneration)
+        {
+            m_uNotifiedLensGeneration = uLensGeneration;
+            m_rTracer.Record(TraceEvent::LensRebuilt, uLensGeneration);
+            m_pServerDriverHost->TrackedDevicePropertiesChanged(m_uObjectId);
+        }
         m_pServerDriverHost->TrackedDevicePoseUpdated(m_uObjectId, GetPose());
     }
     else
     {
+        SPVR_LOG_DEBUG(m_pDriverLog, "HmdDriver::RunFrame(), but m_uObjectId is invalid!\n");
+    }
+}
+
+CommandStatus HmdDriver::ExecuteCommand(Command const &oCommand)
+{
+    switch (oCommand.m_eType)
+    {
+    case CommandType::Recenter:
+    {
+        // heading of the raw rotation around the y (up) axis
+        auto const q = m_rControlInterface.GetRotation();
+        m_fRecenterYaw.store(std::atan2(2.0f * (q.w * q.y + q.x * q.z), 1.0f - 2.0f * (q.x * q.x + q.y * q.y)),
+            std::memory_order_relaxed);
+        return CommandStatus::Done;
+    }
+    case CommandType::ResetFilter:
+        m_pPoseUpdater->ResetFilter();
+        return CommandStatus::Done;
+    case CommandType::SetPort:
+        if (oCommand.m_aArgs[0] <= 0 || oCommand.m_aArgs[0] > 65535)
+        {
+            return CommandStatus::Failed;
+        }
+        return m_pPoseUpdater->SetPort(static_cast<std::uint16_t>(oCommand.m_aArgs[0])) ? CommandStatus::Done : CommandStatus::Failed;
+    case CommandType::DumpStats:
         if (m_pDriverLog)
         {
-            m_pDriverLog->Debug("HmdDriver::RunFrame(), but m_uObjectId is invalid!\n");
+            m_pDriverLog->Log(LogLevel::Info, std::string{"HmdDriver stats: port "} + std::to_string(m_pPoseUpdater->GetPort())
+                + ", packets received " + std::to_string(m_pPoseUpdater->GetReceivedCount())
+                + ", rejected " + std::to_string(m_pPoseUpdater->GetRejectedCount())
+                + ", log lines dropped " + std::to_string(m_pDriverLog->GetDroppedCount())
+                + ", shm log lines dropped " + std::to_string(m_rControlInterface.GetLogDroppedCount())
+                + ", lens generation " + std::to_string(m_pLensStateUpdater->GetPublishedGeneration()) + "\n");
         }
+        return CommandStatus::Done;
+    case CommandType::None:
+    default:
+        return CommandStatus::Unsupported;
     }
 }
 
 void HmdDriver::GetWindowBounds(std::int32_t *piX, std::int32_t *piY, std::uint32_t *puWidth, std::uint32_t *puHeight)
 {
-    if (m_pDriverLog)
-    {
-        m_pDriverLog->Debug("HmdDriver::GetWindowBounds()\n");
-    }
+    SPVR_LOG_DEBUG(m_pDriverLog, "HmdDriver::GetWindowBounds()\n");
     *piX = m_iWindowX;
     *piY = m_iWindowY;
     *puWidth = static_cast<std::uint32_t>(m_iWindowWidth);
@@ -417,38 +506,25 @@ void HmdDriver::GetWindowBounds(std::int32_t *piX, std::int32_t *piY, std::uint3
 
 bool HmdDriver::IsDisplayOnDesktop()
 {
-    if (m_pDriverLog)
-    {
-        m_pDriverLog->Debug("HmdDriver::IsDisplayOnDesktop()\n");
-    }
+    SPVR_LOG_DEBUG(m_pDriverLog, "HmdDriver::IsDisplayOnDesktop()\n");
     return true;
 }
 
 bool HmdDriver::IsDisplayRealDisplay()
 {
-    if (m_pDriverLog)
-    {
-        m_pDriverLog->Debug("HmdDriver::IsDisplayRealDisplay()\n");
-    }
+    SPVR_LOG_DEBUG(m_pDriverLog, "HmdDriver::IsDisplayRealDisplay()\n");
     return false;
 }
 
 void HmdDriver::GetRecommendedRenderTargetSize(std::uint32_t *puWidth, std::uint32_t *puHeight)
 {
-    if (m_pDriverLog)
-    {
-        m_pDriverLog->Debug("HmdDriver::GetRecommendedRenderTargetSize(...)\n");
-    }
-    *puWidth = m_iRenderWidth;
-    *puHeight = m_iRenderHeight;
+    SPVR_LOG_DEBUG(m_pDriverLog, "HmdDriver::GetRecommendedRenderTargetSize(...)\n");
+    m_pLensState->GetRecommendedRenderTargetSize(*puWidth, *puHeight);
 }
 
 void HmdDriver::GetEyeOutputViewport(vr::EVREye eEye, std::uint32_t *puX, std::uint32_t *puY, std::uint32_t *puWidth, std::uint32_t *puHeight)
 {
-    if (m_pDriverLog)
-    {
-        m_pDriverLog->Debug("HmdDriver::GetEyeOutputViewport(...)\n");
-    }
+    SPVR_LOG_DEBUG(m_pDriverLog, "HmdDriver::GetEyeOutputViewport(...)\n");
     *puY = 0;
     *puWidth = m_iWindowWidth / 2;
     *puHeight = m_iWindowHeight;
@@ -465,78 +541,41 @@ void HmdDriver::GetEyeOutputViewport(vr::EVREye eEye, std::uint32_t *puX, std::u
 
 void HmdDriver::GetProjectionRaw(vr::EVREye eEye, float *pfLeft, float *pfRight, float *pfTop, float *pfBottom)
 {
-    if (m_pDriverLog)
-    {
-        m_pDriverLog->Debug("HmdDriver::GetProjectionRaw(...)\n");
-    }
-    *pfLeft = -1.0;
-    *pfRight = 1.0;
-    *pfTop = -1.0;
-    *pfBottom = 1.0;
+    SPVR_LOG_DEBUG(m_pDriverLog, "HmdDriver::GetProjectionRaw(...)\n");
+    m_pLensState->GetProjectionRaw(eEye, *pfLeft, *pfRight, *pfTop, *pfBottom);
 }
 
 vr::DistortionCoordinates_t HmdDriver::ComputeDistortion(vr::EVREye eEye, float fU, float fV)
 {
-    if (m_pDriverLog)
-    {
-        m_pDriverLog->Debug(std::string{"HmdDriver::ComputeDistortion("} +std::to_string(eEye) + ", "
-                          + std::to_string(fU) + ", " + std::to_string(fV) + ")\n");
-    }
-
-    auto const r2 = (fU - 0.5f) * (fU - 0.5f) + (fV - 0.5f) * (fV - 0.5f);
-    auto const r4 = r2 * r2;
-    auto const dist = (1.0f + m_fDistortionK0 * r2 + m_fDistortionK1 * r4);
-    fU = (((fU * 2.0f - 1.0f) * dist) * m_fDistortionScale + 1.0f) * 0.5f;
-    fV = (((fV * 2.0f - 1.0f) * dist) * m_fDistortionScale + 1.0f) * 0.5f;
+    SPVR_LOG_DEBUG(m_pDriverLog, std::string{"HmdDriver::ComputeDistortion("} +std::to_string(eEye) + ", "
+                      + std::to_string(fU) + ", " + std::to_string(fV) + ")\n");
 
-    vr::DistortionCoordinates_t oDistortion{};
-    oDistortion.rfBlue[0] = fU;
-    oDistortion.rfBlue[1] = fV;
-    oDistortion.rfGreen[0] = fU;
-    oDistortion.rfGreen[1] = fV;
-    oDistortion.rfRed[0] = fU;
-    oDistortion.rfRed[1] = fV;
-    return oDistortion;
+    return m_pLensState->ComputeDistortion(eEye, fU, fV);
 }
 
 void HmdDriver::CreateSwapTextureSet(std::uint32_t unPid, std::uint32_t unFormat, std::uint32_t unWidth, std::uint32_t unHeight, void *(*pSharedTextureHandles)[2])
 {
-    if (m_pDriverLog)
-    {
-        m_pDriverLog->Debug("HmdDriver::CreateSwapTextureSet(...)\n");
-    }
+    SPVR_LOG_DEBUG(m_pDriverLog, "HmdDriver::CreateSwapTextureSet(...)\n");
 }
 
 void HmdDriver::DestroySwapTextureSet(void *pSharedTextureHandle)
 {
-    if (m_pDriverLog)
-    {
-        m_pDriverLog->Debug("HmdDriver::DestroySwapTextureSet(...)\n");
-    }
+    SPVR_LOG_DEBUG(m_pDriverLog, "HmdDriver::DestroySwapTextureSet(...)\n");
 }
 
 void HmdDriver::DestroyAllSwapTextureSets(std::uint32_t unPid)
 {
-    if (m_pDriverLog)
-    {
-        m_pDriverLog->Debug("HmdDriver::DestroyAllSwapTextureSets(...)\n");
-    }
+    SPVR_LOG_DEBUG(m_pDriverLog, "HmdDriver::DestroyAllSwapTextureSets(...)\n");
 }
 
 void HmdDriver::SubmitLayer(void *pSharedTextureHandles[2], vr::VRTextureBounds_t const (&bounds)[2], vr::HmdMatrix34_t const *pPose)
 {
-    if (m_pDriverLog)
-    {
-        m_pDriverLog->Debug("HmdDriver::SubmitLayer(...)\n");
-    }
+    SPVR_LOG_DEBUG(m_pDriverLog, "HmdDriver::SubmitLayer(...)\n");
 }
 
 void HmdDriver::Present(void *hSyncTexture)
 {
-    if (m_pDriverLog)
-    {
-        m_pDriverLog->Debug("HmdDriver::Present(...)\n");
-    }
+    SPVR_LOG_DEBUG(m_pDriverLog, "HmdDriver::Present(...)\n");
 }
 
 } // namespace spvr
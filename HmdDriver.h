@@ -7,23 +7,34 @@
 
 #include "openvr_driver.h"
 
+#include <atomic>
 #include <cstdint>
+#include <memory>
 #include <string>
 #include <thread>
 
 namespace spvr
 {
 
+class ControlInterface;
+class DebugRequestHandler;
+class LensState;
+class LensStateUpdater;
 class Logger;
 class PoseUpdater;
+class Tracer;
+struct Command;
+enum class CommandStatus : std::int32_t;
 
 class HmdDriver final : public vr::ITrackedDeviceServerDriver, public vr::IVRDisplayComponent
 {
 public:
-    explicit HmdDriver(vr::IServerDriverHost *pServerDriverHost, Logger *pDriverLog = nullptr);
+    explicit HmdDriver(vr::IServerDriverHost *pServerDriverHost, Logger *pDriverLog = nullptr, std::string const &strUserDriverConfigDir = "");
     ~HmdDriver();
 
     void RunFrame();
+    // executes a command from the control app, see SmartServer::RunFrame
+    CommandStatus ExecuteCommand(Command const &oCommand);
 
     char const *GetSerialNumber() const;
     char const *GetModelNumber() const;
@@ -34,6 +45,8 @@ private:
 
     vr::IServerDriverHost *m_pServerDriverHost;
     Logger *m_pDriverLog;
+    ControlInterface &m_rControlInterface;
+    Tracer &m_rTracer;
     std::unique_ptr<PoseUpdater> m_pPoseUpdater;
     std::uint32_t m_uObjectId;
 
@@ -48,14 +61,19 @@ private:
     std::int32_t m_iWindowY;
     std::int32_t m_iWindowWidth;
     std::int32_t m_iWindowHeight;
-    std::int32_t m_iRenderWidth;
-    std::int32_t m_iRenderHeight;
 
     std::thread m_oPoseUpdateThread;
 
-    float m_fDistortionK0;
-    float m_fDistortionK1;
-    float m_fDistortionScale;
+    std::unique_ptr<LensStateUpdater> m_pLensStateUpdater;
+    // snapshot the display component reads, swapped only in RunFrame: vrserver calls RunFrame
+    // and the display component from its main thread, and ComputeDistortion runs per vertex
+    std::shared_ptr<LensState const> m_pLensState;
+    std::uint32_t m_uNotifiedLensGeneration;
+
+    // heading subtracted from every pose, set by the Recenter command
+    std::atomic<float> m_fRecenterYaw;
+
+    std::unique_ptr<DebugRequestHandler> m_pDebugRequestHandler;
 
     // ITrackedDeviceServerDriver
 public:
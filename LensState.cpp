@@ -0,0 +1,276 @@
+/*
+ * Copyright (c) 2016
+ *  Somebody
+ */
+#include "LensState.h"
+
+#include "ControlInterface.h"
+#include "Logger.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace spvr
+{
+
+namespace
+{
+
+// size of a panel pixel in render target pixels at the lens center, per axis
+void ComputeCenterMagnification(DistortionParameters const &oParameters, float &fU, float &fV)
+{
+    auto const fStep = 1.0f / 1024.0f;
+    auto const oLeft = ComputeRadialDistortion(oParameters, 0.5f - fStep, 0.5f);
+    auto const oRight = ComputeRadialDistortion(oParameters, 0.5f + fStep, 0.5f);
+    auto const oTop = ComputeRadialDistortion(oParameters, 0.5f, 0.5f - fStep);
+    auto const oBottom = ComputeRadialDistortion(oParameters, 0.5f, 0.5f + fStep);
+    fU = std::fabs(oRight.rfGreen[0] - oLeft.rfGreen[0]) / (2.0f * fStep);
+    fV = std::fabs(oBottom.rfGreen[1] - oTop.rfGreen[1]) / (2.0f * fStep);
+}
+
+// the nominal frustum spans tangents [-1, 1] over uv [0, 1], at the center one radian of
+// field of view is one unit of tangent
+static float const S_fDegreesPerTangent = 57.2957795f;
+
+// upper bound for how long the worker takes to notice the shutdown
+static auto const S_oWaitTimeout = std::chrono::milliseconds{100};
+
+std::uint32_t ToRenderTargetPixels(float fPixels)
+{
+    return static_cast<std::uint32_t>(std::max(std::ceil(fPixels), 1.0f));
+}
+
+} // unnamed namespace
+
+DistortionParameters ReadDefaultDistortionParameters(vr::IVRSettings *pSettings)
+{
+    DistortionParameters oParameters{};
+    if (pSettings)
+    {
+        oParameters.m_fK0 = pSettings->GetFloat("spvr", "distortion-k0", oParameters.m_fK0);
+        oParameters.m_fK1 = pSettings->GetFloat("spvr", "distortion-k1", oParameters.m_fK1);
+    }
+    return oParameters;
+}
+
+std::uint32_t ReadDistortionParameters(ControlInterface const &rControlInterface, DistortionParameters const &oDefaults,
+    DistortionParameters &oParameters)
+{
+    oParameters = oDefaults;
+    return rControlInterface.GetDistortionParameters(oParameters.m_fK0, oParameters.m_fK1, oParameters.m_fScale);
+}
+
+void ComputeCenterPixelsPerDegree(DistortionParameters const &oParameters, DisplayConfiguration const &oDisplay,
+    float &fU, float &fV)
+{
+    float fMagnificationU = 1.0f;
+    float fMagnificationV = 1.0f;
+    ComputeCenterMagnification(oParameters, fMagnificationU, fMagnificationV);
+    // the eye's panel pixels span the viewport [0, 1] uv, which the lens magnifies onto
+    // fMagnification times the nominal frustum's 2 units of tangent at the center
+    auto const fEyeWidth = static_cast<float>(std::max(oDisplay.m_iWindowWidth / 2, 1));
+    auto const fEyeHeight = static_cast<float>(std::max(oDisplay.m_iWindowHeight, 1));
+    fU = fEyeWidth / (2.0f * std::max(fMagnificationU, 1e-3f) * S_fDegreesPerTangent);
+    fV = fEyeHeight / (2.0f * std::max(fMagnificationV, 1e-3f) * S_fDegreesPerTangent);
+}
+
+void ComputeRecommendedRenderTargetSize(DistortionParameters const &oParameters, DisplayConfiguration const &oDisplay,
+    std::uint32_t &uWidth, std::uint32_t &uHeight)
+{
+    auto fPixelsPerDegreeU = oDisplay.m_fPixelsPerDegree;
+    auto fPixelsPerDegreeV = oDisplay.m_fPixelsPerDegree;
+    if (fPixelsPerDegreeU <= 0.0f)
+    {
+        ComputeCenterPixelsPerDegree(oParameters, oDisplay, fPixelsPerDegreeU, fPixelsPerDegreeV);
+        fPixelsPerDegreeU *= oDisplay.m_fRenderQuality;
+        fPixelsPerDegreeV *= oDisplay.m_fRenderQuality;
+    }
+    // the projection spans 2 * (bounds extent) units of tangent, see LensState::GetProjectionRaw
+    auto const oBounds = ComputeSampledBounds(oParameters);
+    auto const fDegreesU = 2.0f * (oBounds.m_fUMax - oBounds.m_fUMin) * S_fDegreesPerTangent;
+    auto const fDegreesV = 2.0f * (oBounds.m_fVMax - oBounds.m_fVMin) * S_fDegreesPerTangent;
+    uWidth = ToRenderTargetPixels(fPixelsPerDegreeU * fDegreesU);
+    uHeight = ToRenderTargetPixels(fPixelsPerDegreeV * fDegreesV);
+}
+
+LensState::LensState(std::uint32_t uGeneration, std::shared_ptr<DistortionTable const> pDistortionTable, DisplayConfiguration const &oDisplay):
+    m_uGeneration{uGeneration},
+    m_pDistortionTable{std::move(pDistortionTable)},
+    m_uRenderWidth{},
+    m_uRenderHeight{},
+    m_oSampledBounds{ComputeSampledBounds(m_pDistortionTable->GetParameters())}
+{
+    ComputeRecommendedRenderTargetSize(m_pDistortionTable->GetParameters(), oDisplay, m_uRenderWidth, m_uRenderHeight);
+}
+
+std::uint32_t LensState::GetGeneration() const
+{
+    return m_uGeneration;
+}
+
+DistortionParameters const &LensState::GetParameters() const
+{
+    return m_pDistortionTable->GetParameters();
+}
+
+std::shared_ptr<DistortionTable const> const &LensState::GetDistortionTable() const
+{
+    return m_pDistortionTable;
+}
+
+vr::DistortionCoordinates_t LensState::ComputeDistortion(vr::EVREye, float fU, float fV) const
+{
+    auto const &rBounds = m_oSampledBounds;
+    auto const fScaleU = 1.0f / (rBounds.m_fUMax - rBounds.m_fUMin);
+    auto const fScaleV = 1.0f / (rBounds.m_fVMax - rBounds.m_fVMin);
+    auto oDistortion = m_pDistortionTable->Sample(fU, fV);
+    for (auto *pChannel : {oDistortion.rfRed, oDistortion.rfGreen, oDistortion.rfBlue})
+    {
+        pChannel[0] = (pChannel[0] - rBounds.m_fUMin) * fScaleU;
+        pChannel[1] = (pChannel[1] - rBounds.m_fVMin) * fScaleV;
+    }
+    return oDistortion;
+}
+
+void LensState::GetRecommendedRenderTargetSize(std::uint32_t &uWidth, std::uint32_t &uHeight) const
+{
+    uWidth = m_uRenderWidth;
+    uHeight = m_uRenderHeight;
+}
+
+void LensState::GetProjectionRaw(vr::EVREye, float &fLeft, float &fRight, float &fTop, float &fBottom) const
+{
+    // the nominal frustum spans tangents [-1, 1] over uv [0, 1]
+    auto const &rBounds = m_oSampledBounds;
+    fLeft = 2.0f * rBounds.m_fUMin - 1.0f;
+    fRight = 2.0f * rBounds.m_fUMax - 1.0f;
+    fTop = 2.0f * rBounds.m_fVMin - 1.0f;
+    fBottom = 2.0f * rBounds.m_fVMax - 1.0f;
+}
+
+class LensStateUpdater::LensStateUpdaterImpl
+{
+public:
+    LensStateUpdaterImpl(ControlInterface &rControlInterface, Logger *pLogger, DisplayConfiguration const &oDisplay,
+        DistortionParameters const &oDefaultParameters, std::uint32_t uGridResolution, std::string const &strCacheDirectory):
+        m_rControlInterface(rControlInterface),
+        m_pLogger{pLogger},
+        m_oDisplay(oDisplay),
+        m_oDefaultParameters(oDefaultParameters),
+        m_uGridResolution{uGridResolution},
+        m_strCacheDirectory{strCacheDirectory},
+        m_pLensState{},
+        m_uPublishedGeneration{},
+        m_bActive{true},
+        m_oWorkerThread{}
+    {
+        // the first state is built synchronously, the driver must never see an empty one
+        auto const uChangeGeneration = m_rControlInterface.GetChangeGeneration(ShmSectionId::Control);
+        auto const uKnownGeneration = Rebuild();
+        m_oWorkerThread = std::thread{
+            std::bind(&LensStateUpdaterImpl::Work, this, uChangeGeneration, uKnownGeneration)
+        };
+    }
+
+    ~LensStateUpdaterImpl()
+    {
+        m_bActive = false;
+        if (m_oWorkerThread.joinable())
+        {
+            m_oWorkerThread.join();
+        }
+    }
+
+    std::shared_ptr<LensState const> GetLensState() const
+    {
+        return std::atomic_load(&m_pLensState);
+    }
+
+    std::uint32_t GetPublishedGeneration() const
+    {
+        return m_uPublishedGeneration.load(std::memory_order_acquire);
+    }
+
+private:
+    // sleeps on the control interface's change notification, the timeout only bounds shutdown
+    void Work(std::uint32_t uChangeGeneration, std::uint32_t uKnownGeneration)
+    {
+        while (m_bActive)
+        {
+            if (!m_rControlInterface.WaitForChange(ShmSectionId::Control, uChangeGeneration, S_oWaitTimeout))
+            {
+                continue;
+            }
+            uChangeGeneration = m_rControlInterface.GetChangeGeneration(ShmSectionId::Control);
+            if (m_rControlInterface.GetParameterGeneration() != uKnownGeneration)
+            {
+                uKnownGeneration = Rebuild();
+            }
+        }
+    }
+
+    std::uint32_t Rebuild()
+    {
+        DistortionParameters oParameters{};
+        auto const uGeneration = ReadDistortionParameters(m_rControlInterface, m_oDefaultParameters, oParameters);
+
+        // only rebuild what actually depends on a changed parameter
+        auto const pCurrent = GetLensState();
+        std::shared_ptr<DistortionTable const> pDistortionTable{};
+        if (pCurrent && pCurrent->GetParameters() == oParameters)
+        {
+            pDistortionTable = pCurrent->GetDistortionTable();
+        }
+        else
+        {
+            pDistortionTable = std::make_shared<DistortionTable const>(oParameters, m_uGridResolution, m_strCacheDirectory);
+            SPVR_LOG_DEBUG(m_pLogger, std::string{"LensStateUpdater::Rebuild() => generation "} + std::to_string(uGeneration)
+                + ", k0 = " + std::to_string(oParameters.m_fK0) + ", k1 = " + std::to_string(oParameters.m_fK1)
+                + ", scale = " + std::to_string(oParameters.m_fScale) + "\n");
+        }
+
+        std::atomic_store(&m_pLensState, std::make_shared<LensState const>(uGeneration, std::move(pDistortionTable), m_oDisplay));
+        m_uPublishedGeneration.store(uGeneration, std::memory_order_release);
+        return uGeneration;
+    }
+
+    ControlInterface &m_rControlInterface;
+    Logger *m_pLogger;
+    DisplayConfiguration const m_oDisplay;
+    DistortionParameters const m_oDefaultParameters;
+    std::uint32_t const m_uGridResolution;
+    std::string const m_strCacheDirectory;
+
+    std::shared_ptr<LensState const> m_pLensState;
+    std::atomic<std::uint32_t> m_uPublishedGeneration;
+
+    std::atomic<bool> m_bActive;
+    std::thread m_oWorkerThread;
+};
+
+LensStateUpdater::LensStateUpdater(ControlInterface &rControlInterface, Logger *pLogger, DisplayConfiguration const &oDisplay,
+    DistortionParameters const &oDefaultParameters, std::uint32_t uGridResolution, std::string const &strCacheDirectory):
+    m_pImpl{std::make_unique<LensStateUpdaterImpl>(rControlInterface, pLogger, oDisplay, oDefaultParameters, uGridResolution, strCacheDirectory)}
+{
+
+}
+
+LensStateUpdater::~LensStateUpdater() = default;
+
+std::shared_ptr<LensState const> LensStateUpdater::GetLensState() const
+{
+    return m_pImpl->GetLensState();
+}
+
+std::uint32_t LensStateUpdater::GetPublishedGeneration() const
+{
+    return m_pImpl->GetPublishedGeneration();
+}
+
+} // namespace spvr
@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2016
+ *  Somebody
+ */
+#ifndef SPVR_LENSSTATE_H
+#define SPVR_LENSSTATE_H
+
+#include "DistortionTable.h"
+#include "openvr_driver.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace spvr
+{
+
+class ControlInterface;
+class Logger;
+
+struct DisplayConfiguration final
+{
+    // panel resolution, both eyes side by side
+    std::int32_t m_iWindowWidth = 1280;
+    std::int32_t m_iWindowHeight = 720;
+    // multiplier on the render target size needed for 1:1 sampling at the lens center
+    float m_fRenderQuality = 1.0f;
+    // render target pixels per degree at the lens center, 0 for the panel's times m_fRenderQuality
+    float m_fPixelsPerDegree = 0.0f;
+};
+
+// Lens parameters from the driver settings, in effect until the control app writes its own.
+DistortionParameters ReadDefaultDistortionParameters(vr::IVRSettings *pSettings);
+
+// The parameters the lens is rendered with: the control app's where it has written them,
+// oDefaults everywhere else. Returns the parameter generation they belong to.
+std::uint32_t ReadDistortionParameters(ControlInterface const &rControlInterface, DistortionParameters const &oDefaults,
+    DistortionParameters &oParameters);
+
+// Panel pixels per degree of the eye's field of view at the lens center, where the distortion
+// magnifies the most, per axis.
+void ComputeCenterPixelsPerDegree(DistortionParameters const &oParameters, DisplayConfiguration const &oDisplay,
+    float &fU, float &fV);
+
+// Render target size per eye that has the target pixels per degree at the lens center over the
+// projection GetProjectionRaw reports, i.e. the sampled bounds, see ComputeSampledBounds. The
+// target is m_fPixelsPerDegree if set, else the panel's, so that one render target pixel maps
+// onto one panel pixel at the center, times the quality multiplier.
+void ComputeRecommendedRenderTargetSize(DistortionParameters const &oParameters, DisplayConfiguration const &oDisplay,
+    std::uint32_t &uWidth, std::uint32_t &uHeight);
+
+// Immutable snapshot of everything derived from the lens parameters.
+class LensState final
+{
+public:
+    LensState(std::uint32_t uGeneration, std::shared_ptr<DistortionTable const> pDistortionTable, DisplayConfiguration const &oDisplay);
+
+    std::uint32_t GetGeneration() const;
+    DistortionParameters const &GetParameters() const;
+    std::shared_ptr<DistortionTable const> const &GetDistortionTable() const;
+
+    // distortion into the render target that covers only the sampled bounds, the same for both eyes
+    vr::DistortionCoordinates_t ComputeDistortion(vr::EVREye eEye, float fU, float fV) const;
+    void GetRecommendedRenderTargetSize(std::uint32_t &uWidth, std::uint32_t &uHeight) const;
+    void GetProjectionRaw(vr::EVREye eEye, float &fLeft, float &fRight, float &fTop, float &fBottom) const;
+
+private:
+    std::uint32_t m_uGeneration;
+    std::shared_ptr<DistortionTable const> m_pDistortionTable;
+    std::uint32_t m_uRenderWidth;
+    std::uint32_t m_uRenderHeight;
+    SampledBounds m_oSampledBounds;
+};
+
+// Sleeps on the control interface's change notification and rebuilds the LensState
+// on a background thread whenever the parameter generation changes.
+class LensStateUpdater final
+{
+public:
+    LensStateUpdater(ControlInterface &rControlInterface, Logger *pLogger, DisplayConfiguration const &oDisplay,
+        DistortionParameters const &oDefaultParameters, std::uint32_t uGridResolution, std::string const &strCacheDirectory);
+    ~LensStateUpdater();
+
+    // the most recently published state, never nullptr; an atomic shared_ptr load, so hot
+    // paths keep the result and only reload when GetPublishedGeneration moves
+    std::shared_ptr<LensState const> GetLensState() const;
+    // generation of the most recently published state
+    std::uint32_t GetPublishedGeneration() const;
+
+private:
+    class LensStateUpdaterImpl;
+    std::unique_ptr<LensStateUpdaterImpl> m_pImpl;
+};
+
+} // namespace spvr
+
+#endif // SPVR_LENSSTATE_H
@@ -4,81 +4,466 @@
 */
 #include "Logger.h"
 
+#include "BoundedQueue.h"
 #include "ControlInterface.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
 #include <cstring>
-#include <fstream>
+#include <limits>
 #include <memory>
+#include <mutex>
 #include <sstream>
 #include <string>
 #include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif // WIN32_LEAN_AND_MEAN
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif // NOMINMAX
+#include <windows.h>
+#else // ! _WIN32
+#include <pthread.h>
+#include <sched.h>
+#endif // ! _WIN32
 
 namespace spvr
 {
 
-Logger::Logger(ControlInterface *pControlInterface):
-    m_pControlInterface{pControlInterface},
-    m_vecDriverLogs{}
+namespace
 {
-    std::ostringstream ss{};
-    ss << std::this_thread::get_id() << ": ";
-    m_strDebugLinePrefix = ss.str();
-}
 
-Logger::~Logger()
+struct LogRecord final
 {
-    m_pControlInterface = nullptr;
-}
+    // longer messages are cut and end in S_aTruncationMark
+    static std::size_t const S_iMaxLength = 1023;
 
-void Logger::AddDriverLog(vr::IDriverLog *pDriverLog)
+    std::uint32_t m_uLength;
+    char m_aMessage[S_iMaxLength + 1];
+};
+
+static char const S_aTruncationMark[] = "...";
+static std::size_t const S_iQueueCapacity = 1024;
+static auto const S_oFlushInterval = std::chrono::milliseconds{5};
+// how often the flusher looks for repeats left behind by a burst that ended
+static auto const S_oSuppressedReportInterval = std::chrono::seconds{1};
+
+// every LogRateLimiter alive, limiters are call site statics and register on first use
+class LogRateLimiterRegistry final
 {
-    if (std::find(begin(m_vecDriverLogs), end(m_vecDriverLogs), pDriverLog) == std::end(m_vecDriverLogs))
+public:
+    LogRateLimiterRegistry():
+        m_oMutex{},
+        m_vecLimiters{}
     {
-        m_vecDriverLogs.push_back(pDriverLog);
+
     }
-}
 
-void Logger::RemoveDriverLog(vr::IDriverLog *pDriverLog)
-{
-    auto it = std::find(begin(m_vecDriverLogs), end(m_vecDriverLogs), pDriverLog);
-    if (it != std::end(m_vecDriverLogs))
+    void Add(LogRateLimiter *pLimiter)
+    {
+        std::lock_guard<std::mutex> oLock{m_oMutex};
+        m_vecLimiters.push_back(pLimiter);
+    }
+
+    void Remove(LogRateLimiter *pLimiter)
+    {
+        std::lock_guard<std::mutex> oLock{m_oMutex};
+        m_vecLimiters.erase(std::remove(begin(m_vecLimiters), end(m_vecLimiters), pLimiter), end(m_vecLimiters));
+    }
+
+    template<typename Visit>
+    void ForEach(Visit &&rVisit)
     {
-        m_vecDriverLogs.erase(it);
+        std::lock_guard<std::mutex> oLock{m_oMutex};
+        for (auto *pLimiter : m_vecLimiters)
+        {
+            rVisit(*pLimiter);
+        }
     }
+
+private:
+    std::mutex m_oMutex;
+    std::vector<LogRateLimiter *> m_vecLimiters;
+};
+
+// constructed by the first limiter, so it outlives all of them
+LogRateLimiterRegistry &GetLogRateLimiterRegistry()
+{
+    static LogRateLimiterRegistry S_oRegistry{};
+    return S_oRegistry;
 }
 
-void Logger::Log(const char *pchLogMessage)
+void LowerThreadPriority(std::thread &rThread)
 {
-    if (m_pControlInterface)
+#if defined(_WIN32)
+    SetThreadPriority(rThread.native_handle(), THREAD_PRIORITY_BELOW_NORMAL);
+#elif defined(SCHED_IDLE)
+    sched_param oParam{};
+    pthread_setschedparam(rThread.native_handle(), SCHED_IDLE, &oParam);
+#else
+    (void)rThread;
+#endif
+}
+
+} // unnamed namespace
+
+class Logger::LoggerImpl
+{
+public:
+    explicit LoggerImpl(ControlInterface *pControlInterface):
+        m_pControlInterface{pControlInterface},
+        m_oDriverLogMutex{},
+        m_vecDriverLogs{},
+        m_strDebugLinePrefix{},
+        m_pQueue{std::make_unique<BoundedQueue<LogRecord, S_iQueueCapacity>>()},
+        m_uDropped{0u},
+        m_uDroppedReported{0u},
+        m_uEnqueued{0u},
+        m_uWritten{0u},
+        m_bFlusherActive{true},
+        m_oFlusherThread{}
+    {
+        std::ostringstream ss{};
+        ss << std::this_thread::get_id() << ": ";
+        m_strDebugLinePrefix = ss.str();
+        m_oFlusherThread = std::thread{
+            [this]()
+            {
+                Flusher();
+            }
+        };
+        LowerThreadPriority(m_oFlusherThread);
+    }
+
+    ~LoggerImpl()
+    {
+        m_bFlusherActive = false;
+        if (m_oFlusherThread.joinable())
+        {
+            m_oFlusherThread.join();
+        }
+        m_pControlInterface = nullptr;
+    }
+
+    void AddDriverLog(vr::IDriverLog *pDriverLog)
+    {
+        std::lock_guard<std::mutex> oLock{m_oDriverLogMutex};
+        if (std::find(begin(m_vecDriverLogs), end(m_vecDriverLogs), pDriverLog) == std::end(m_vecDriverLogs))
+        {
+            m_vecDriverLogs.push_back(pDriverLog);
+        }
+    }
+
+    void RemoveDriverLog(vr::IDriverLog *pDriverLog)
+    {
+        std::lock_guard<std::mutex> oLock{m_oDriverLogMutex};
+        auto it = std::find(begin(m_vecDriverLogs), end(m_vecDriverLogs), pDriverLog);
+        if (it != std::end(m_vecDriverLogs))
+        {
+            m_vecDriverLogs.erase(it);
+        }
+    }
+
+    void Enqueue(char const *pchPrefix, std::size_t iPrefixLength, char const *pchMessage, std::size_t iMessageLength)
+    {
+        auto const bPushed = m_pQueue->TryPush(
+            [=](LogRecord &rRecord)
+            {
+                // sizeof counts the terminator, the mark and a line break always fit after the prefix
+                auto const iPrefix = std::min(iPrefixLength, LogRecord::S_iMaxLength - sizeof(S_aTruncationMark));
+                auto iMessage = std::min(iMessageLength, LogRecord::S_iMaxLength - iPrefix);
+                std::memcpy(rRecord.m_aMessage, pchPrefix, iPrefix);
+                std::memcpy(rRecord.m_aMessage + iPrefix, pchMessage, iMessage);
+                if (iMessage < iMessageLength)
+                {
+                    // mark the cut, keep the line break the sinks rely on
+                    auto const bNewline = pchMessage[iMessageLength - 1u] == '\n';
+                    auto const iMark = sizeof(S_aTruncationMark) - 1u + (bNewline ? 1u : 0u);
+                    iMessage = std::max(iMessage, iMark) - iMark;
+                    std::memcpy(rRecord.m_aMessage + iPrefix + iMessage, S_aTruncationMark, sizeof(S_aTruncationMark) - 1u);
+                    iMessage += sizeof(S_aTruncationMark) - 1u;
+                    if (bNewline)
+                    {
+                        rRecord.m_aMessage[iPrefix + iMessage++] = '\n';
+                    }
+                }
+                rRecord.m_aMessage[iPrefix + iMessage] = '\0';
+                rRecord.m_uLength = static_cast<std::uint32_t>(iPrefix + iMessage);
+            });
+        if (bPushed)
+        {
+            m_uEnqueued.fetch_add(1u, std::memory_order_relaxed);
+        }
+        else
+        {
+            m_uDropped.fetch_add(1u, std::memory_order_relaxed);
+        }
+    }
+
+    std::string const &GetDebugLinePrefix() const
+    {
+        return m_strDebugLinePrefix;
+    }
+
+    std::uint64_t GetDroppedCount() const
+    {
+        return m_uDropped.load(std::memory_order_relaxed);
+    }
+
+    // with bEndedOnly only the repeats of bursts that are over, see LogRateLimiter::TakeSuppressed
+    void ReportSuppressed(bool bEndedOnly)
+    {
+        GetLogRateLimiterRegistry().ForEach([this, bEndedOnly](LogRateLimiter &rLimiter)
+            {
+                auto const uSuppressed = rLimiter.TakeSuppressed(bEndedOnly);
+                if (uSuppressed == 0u)
+                {
+                    return;
+                }
+                // the file name without its directories
+                auto const *pchFile = rLimiter.GetFile();
+                auto const *pchSlash = std::strrchr(pchFile, '/');
+                auto const *pchBackslash = std::strrchr(pchFile, '\\');
+                auto const *pchName = std::max(pchSlash ? pchSlash + 1 : pchFile, pchBackslash ? pchBackslash + 1 : pchFile);
+                char aMessage[128];
+                auto const iLength = std::snprintf(aMessage, sizeof(aMessage), "  ... %u repeats suppressed (%s:%d)\n",
+                    uSuppressed, pchName, rLimiter.GetLine());
+                Enqueue("", 0, aMessage, std::min(static_cast<std::size_t>(std::max(iLength, 0)), sizeof(aMessage) - 1u));
+            });
+    }
+
+    void Flush()
     {
-        m_pControlInterface->Log(pchLogMessage);
+        ReportSuppressed(false);
+        auto const uTarget = m_uEnqueued.load(std::memory_order_acquire);
+        while (m_bFlusherActive && m_uWritten.load(std::memory_order_acquire) < uTarget)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds{1});
+        }
     }
-    for (auto pDriverLog : m_vecDriverLogs)
+
+private:
+    void Flusher()
     {
-        pDriverLog->Log(pchLogMessage);
+        auto oNextReport = std::chrono::steady_clock::now() + S_oSuppressedReportInterval;
+        while (m_bFlusherActive)
+        {
+            if (std::chrono::steady_clock::now() >= oNextReport)
+            {
+                ReportSuppressed(true);
+                oNextReport += S_oSuppressedReportInterval;
+            }
+            if (!Drain())
+            {
+                std::this_thread::sleep_for(S_oFlushInterval);
+            }
+        }
+        ReportSuppressed(false);
+        Drain();
     }
+
+    // returns false if there was nothing to write
+    bool Drain()
+    {
+        bool bWrote = false;
+        LogRecord oRecord;
+        while (m_pQueue->TryPop(oRecord))
+        {
+            Write(oRecord.m_aMessage);
+            m_uWritten.fetch_add(1u, std::memory_order_release);
+            bWrote = true;
+        }
+
+        auto const uDropped = m_uDropped.load(std::memory_order_relaxed);
+        if (uDropped != m_uDroppedReported)
+        {
+            auto const strReport = "Logger: queue overflow, " + std::to_string(uDropped - m_uDroppedReported) + " messages dropped\n";
+            m_uDroppedReported = uDropped;
+            Write(strReport.c_str());
+            bWrote = true;
+        }
+        return bWrote;
+    }
+
+    void Write(char const *pchMessage)
+    {
+        if (m_pControlInterface)
+        {
+            m_pControlInterface->Log(pchMessage);
+        }
+        std::lock_guard<std::mutex> oLock{m_oDriverLogMutex};
+        for (auto pDriverLog : m_vecDriverLogs)
+        {
+            pDriverLog->Log(pchMessage);
+        }
+    }
+
+    ControlInterface *m_pControlInterface;
+    std::mutex m_oDriverLogMutex;
+    std::vector<vr::IDriverLog *> m_vecDriverLogs;
+    std::string m_strDebugLinePrefix;
+
+    // on the heap through BoundedQueue::operator new, which honors its cache line alignment
+    std::unique_ptr<BoundedQueue<LogRecord, S_iQueueCapacity>> m_pQueue;
+    std::atomic<std::uint64_t> m_uDropped;
+    // only touched by the flusher thread
+    std::uint64_t m_uDroppedReported;
+    std::atomic<std::uint64_t> m_uEnqueued;
+    std::atomic<std::uint64_t> m_uWritten;
+
+    std::atomic<bool> m_bFlusherActive;
+    std::thread m_oFlusherThread;
+};
+
+Logger::Logger(ControlInterface *pControlInterface):
+#ifdef _DEBUG
+    m_iLevel{static_cast<std::int32_t>(LogLevel::Debug)},
+#else // ! _DEBUG
+    m_iLevel{static_cast<std::int32_t>(LogLevel::Info)},
+#endif // ! _DEBUG
+    m_pImpl{std::make_unique<LoggerImpl>(pControlInterface)}
+{
+    // std::make_unique does not honor an extended alignment before C++17
+    static_assert(alignof(LoggerImpl) <= alignof(std::max_align_t), "LoggerImpl: over-aligned members must live on the heap");
+}
+
+Logger::~Logger() = default;
+
+void Logger::AddDriverLog(vr::IDriverLog *pDriverLog)
+{
+    m_pImpl->AddDriverLog(pDriverLog);
+}
+
+void Logger::RemoveDriverLog(vr::IDriverLog *pDriverLog)
+{
+    m_pImpl->RemoveDriverLog(pDriverLog);
+}
+
+void Logger::Log(const char *pchLogMessage)
+{
+    Log(LogLevel::Info, pchLogMessage);
 }
 
 void Logger::Log(std::string const &strLogMessage)
 {
-    if (m_pControlInterface)
+    Log(LogLevel::Info, strLogMessage.c_str());
+}
+
+void Logger::Debug(std::string const &strLogMessage)
+{
+#ifdef _DEBUG
+    Log(LogLevel::Debug, strLogMessage);
+#else // ! _DEBUG
+    (void)strLogMessage;
+#endif // ! _DEBUG
+}
+
+void Logger::Log(LogLevel eLevel, char const *pchLogMessage)
+{
+    if (!IsEnabled(eLevel))
+    {
+        return;
+    }
+    if (eLevel == LogLevel::Debug)
     {
-        m_pControlInterface->Log(strLogMessage);
+        auto const &strPrefix = m_pImpl->GetDebugLinePrefix();
+        m_pImpl->Enqueue(strPrefix.c_str(), strPrefix.size(), pchLogMessage, std::strlen(pchLogMessage));
     }
-    for (auto pDriverLog : m_vecDriverLogs)
+    else
     {
-        pDriverLog->Log(strLogMessage.c_str());
+        m_pImpl->Enqueue("", 0, pchLogMessage, std::strlen(pchLogMessage));
     }
 }
 
-void Logger::Debug(std::string const &strLogMessage)
+void Logger::Log(LogLevel eLevel, std::string const &strLogMessage)
 {
-#ifdef _DEBUG
-    if (m_pControlInterface)
+    Log(eLevel, strLogMessage.c_str());
+}
+
+void Logger::LogSuppressed(LogLevel eLevel, std::uint32_t uRepeats)
+{
+    char aMessage[64];
+    std::snprintf(aMessage, sizeof(aMessage), "  ... %u repeats suppressed\n", uRepeats);
+    Log(eLevel, aMessage);
+}
+
+void Logger::SetLevel(LogLevel eLevel)
+{
+    m_iLevel.store(static_cast<std::int32_t>(eLevel), std::memory_order_relaxed);
+}
+
+std::uint64_t Logger::GetDroppedCount() const
+{
+    return m_pImpl->GetDroppedCount();
+}
+
+void Logger::Flush()
+{
+    m_pImpl->Flush();
+}
+
+LogRateLimiter::LogRateLimiter(char const *pchFile, std::int32_t iLine, std::uint32_t uBurst,
+    std::chrono::milliseconds oInterval):
+    m_pchFile{pchFile},
+    m_iLine{iLine},
+    m_iInterval{std::chrono::duration_cast<std::chrono::steady_clock::duration>(oInterval).count()},
+    m_iBurstTolerance{m_iInterval * static_cast<std::int64_t>(std::max(uBurst, 1u) - 1u)},
+    m_iNextArrival{std::numeric_limits<std::int64_t>::min() / 2},
+    m_uSuppressed{0u}
+{
+    GetLogRateLimiterRegistry().Add(this);
+}
+
+LogRateLimiter::~LogRateLimiter()
+{
+    GetLogRateLimiterRegistry().Remove(this);
+}
+
+bool LogRateLimiter::Acquire(std::uint32_t &uSuppressed)
+{
+    // generic cell rate algorithm, the bucket is full once m_iNextArrival lies in the past
+    auto const iNow = std::chrono::steady_clock::now().time_since_epoch().count();
+    auto iNextArrival = m_iNextArrival.load(std::memory_order_relaxed);
+    do
     {
-        m_pControlInterface->Log(m_strDebugLinePrefix + strLogMessage);
+        if (iNextArrival - m_iBurstTolerance > iNow)
+        {
+            m_uSuppressed.fetch_add(1u, std::memory_order_relaxed);
+            return false;
+        }
+    } while (!m_iNextArrival.compare_exchange_weak(iNextArrival, std::max(iNextArrival, iNow) + m_iInterval, std::memory_order_relaxed));
+    uSuppressed = m_uSuppressed.exchange(0u, std::memory_order_relaxed);
+    return true;
+}
+
+std::uint32_t LogRateLimiter::TakeSuppressed(bool bEndedOnly)
+{
+    if (bEndedOnly)
+    {
+        auto const iNow = std::chrono::steady_clock::now().time_since_epoch().count();
+        if (m_iNextArrival.load(std::memory_order_relaxed) - m_iBurstTolerance > iNow)
+        {
+            return 0u;
+        }
     }
-#endif // _DEBUG
+    return m_uSuppressed.exchange(0u, std::memory_order_relaxed);
+}
+
+char const *LogRateLimiter::GetFile() const
+{
+    return m_pchFile;
+}
+
+std::int32_t LogRateLimiter::GetLine() const
+{
+    return m_iLine;
 }
 
 } // namespace spvr
@@ -7,7 +7,10 @@
 
 #include "openvr_driver.h"
 
+#include <atomic>
+#include <chrono>
 #include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -16,6 +19,17 @@ namespace spvr
 
 class ControlInterface;
 
+enum class LogLevel : std::int32_t
+{
+    Debug = 0,
+    Info = 1,
+    Warning = 2,
+    Error = 3
+};
+
+// Log calls only enqueue the message, a background thread fans it out to the
+// control interface and the registered driver logs. Logging never blocks, if
+// the queue is full the message is dropped and counted.
 class Logger final : public vr::IDriverLog
 {
 public:
@@ -27,14 +41,117 @@ public:
 
     /** Writes a log message to the log file prefixed with the driver name */
     virtual void Log(const char *pchLogMessage) override;
+    // untagged messages are logged at LogLevel::Info, messages longer than a queue slot
+    // (1023 bytes with the prefix) are cut and marked with a trailing "..."
     void Log(std::string const &strLogMessage);
     void Debug(std::string const &strLogMessage);
+    void Log(LogLevel eLevel, char const *pchLogMessage);
+    void Log(LogLevel eLevel, std::string const &strLogMessage);
+    // summary line for messages held back by a LogRateLimiter
+    void LogSuppressed(LogLevel eLevel, std::uint32_t uRepeats);
+
+    // cheap enough to guard the construction of every message, see SPVR_LOG
+    bool IsEnabled(LogLevel eLevel) const
+    {
+        return static_cast<std::int32_t>(eLevel) >= m_iLevel.load(std::memory_order_relaxed);
+    }
+    void SetLevel(LogLevel eLevel);
+
+    // number of messages dropped because the queue was full
+    std::uint64_t GetDroppedCount() const;
+    // blocks until everything enqueued so far has been written, including the pending
+    // repeat counts of every LogRateLimiter
+    void Flush();
+
+private:
+    std::atomic<std::int32_t> m_iLevel;
+    class LoggerImpl;
+    std::unique_ptr<LoggerImpl> m_pImpl;
+};
+
+// Token bucket for a single log call site, see SPVR_LOG_RATE_LIMITED. Allows a burst
+// of uBurst messages and one more per oInterval after that, everything else is only
+// counted. Lock-free, a suppressed message costs a clock read and an atomic increment.
+// Every limiter is known to the Logger's flusher, which reports the repeats of a burst
+// that ended without another message getting through, see TakeSuppressed.
+class LogRateLimiter final
+{
+public:
+    // pchFile and iLine name the call site in the flusher's report
+    LogRateLimiter(char const *pchFile, std::int32_t iLine, std::uint32_t uBurst = 3u,
+        std::chrono::milliseconds oInterval = std::chrono::seconds{1});
+    ~LogRateLimiter();
+
+    LogRateLimiter(LogRateLimiter const &) = delete;
+    LogRateLimiter &operator=(LogRateLimiter const &) = delete;
+
+    // returns true if the message may be written, uSuppressed receives the number
+    // of messages suppressed since the last one that was written
+    bool Acquire(std::uint32_t &uSuppressed);
+    // Takes the suppressed count for a report of its own; with bEndedOnly only once the
+    // burst is over, i.e. when the next message would be written again.
+    std::uint32_t TakeSuppressed(bool bEndedOnly);
+
+    char const *GetFile() const;
+    std::int32_t GetLine() const;
+
 private:
-    ControlInterface *m_pControlInterface;
-    std::vector<vr::IDriverLog *> m_vecDriverLogs;
-    std::string m_strDebugLinePrefix;
+    char const *const m_pchFile;
+    std::int32_t const m_iLine;
+    std::int64_t const m_iInterval;
+    std::int64_t const m_iBurstTolerance;
+    // theoretical arrival time of the next message in steady clock ticks
+    std::atomic<std::int64_t> m_iNextArrival;
+    std::atomic<std::uint32_t> m_uSuppressed;
 };
 
 } // namespace spvr
 
+// The message expression is only evaluated if pLogger is set and the level is enabled,
+// so a disabled message costs one relaxed load and no allocations.
+#define SPVR_LOG(pLogger, eLevel, ...) \
+    do \
+    { \
+        ::spvr::Logger *pSpvrLogger_ = (pLogger); \
+        if (pSpvrLogger_ && pSpvrLogger_->IsEnabled(eLevel)) \
+        { \
+            pSpvrLogger_->Log(eLevel, __VA_ARGS__); \
+        } \
+    } while (false)
+
+// Repeats of the same call site are limited by a per call site LogRateLimiter, the
+// message expression is not evaluated for suppressed repeats. The next message that
+// passes reports how many were suppressed in between; if none does, the logger's
+// flusher reports them once the burst is over, and Flush reports them right away.
+#define SPVR_LOG_RATE_LIMITED(pLogger, eLevel, ...) \
+    do \
+    { \
+        static ::spvr::LogRateLimiter s_oSpvrLimiter_{__FILE__, __LINE__}; \
+        ::spvr::Logger *pSpvrLogger_ = (pLogger); \
+        std::uint32_t uSpvrSuppressed_ = 0u; \
+        if (pSpvrLogger_ && pSpvrLogger_->IsEnabled(eLevel) && s_oSpvrLimiter_.Acquire(uSpvrSuppressed_)) \
+        { \
+            pSpvrLogger_->Log(eLevel, __VA_ARGS__); \
+            if (uSpvrSuppressed_ != 0u) \
+            { \
+                pSpvrLogger_->LogSuppressed(eLevel, uSpvrSuppressed_); \
+            } \
+        } \
+    } while (false)
+
+// Debug messages are compiled out unless _DEBUG is defined, the dead branch
+// keeps the arguments referenced so release builds stay warning free.
+#ifdef _DEBUG
+#define SPVR_LOG_DEBUG(pLogger, ...) SPVR_LOG(pLogger, ::spvr::LogLevel::Debug, __VA_ARGS__)
+#else // ! _DEBUG
+#define SPVR_LOG_DEBUG(pLogger, ...) \
+    do \
+    { \
+        if (false) \
+        { \
+            SPVR_LOG(pLogger, ::spvr::LogLevel::Debug, __VA_ARGS__); \
+        } \
+    } while (false)
+#endif // ! _DEBUG
+
 #endif // SPVR_LOGGER_H
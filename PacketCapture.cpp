@@ -0,0 +1,279 @@
+/*
+ * Copyright (c) 2016
+ *  Somebody
+ */
+#include "PacketCapture.h"
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+
+namespace spvr
+{
+
+namespace
+{
+
+using namespace boost::interprocess;
+
+// earlier captures kept next to the current one, as name.1.ext (the previous) up to name.N.ext
+static std::uint32_t const S_uKeptCaptures = 3u;
+
+std::string GetRotatedFileName(std::string const &strFileName, std::uint32_t uIndex)
+{
+    auto const uSeparator = strFileName.find_last_of("/\\");
+    auto uDot = strFileName.rfind('.');
+    if (uDot == std::string::npos || (uSeparator != std::string::npos && uDot < uSeparator))
+    {
+        uDot = strFileName.size();
+    }
+    return strFileName.substr(0, uDot) + "." + std::to_string(uIndex) + strFileName.substr(uDot);
+}
+
+// shifts name.ext to name.1.ext, name.1.ext to name.2.ext and so on, the oldest is removed;
+// rename does not replace existing files everywhere, so every target is removed first
+void RotateCaptureFiles(std::string const &strFileName)
+{
+    std::remove(GetRotatedFileName(strFileName, S_uKeptCaptures).c_str());
+    for (auto uIndex = S_uKeptCaptures - 1u; uIndex > 0u; --uIndex)
+    {
+        std::rename(GetRotatedFileName(strFileName, uIndex).c_str(), GetRotatedFileName(strFileName, uIndex + 1u).c_str());
+    }
+    std::rename(strFileName.c_str(), GetRotatedFileName(strFileName, 1u).c_str());
+}
+
+bool CreateFileOfSize(std::string const &strFileName, std::uint64_t uSize)
+{
+    std::ofstream oFile{strFileName, std::ios::binary | std::ios::trunc};
+    if (!oFile || uSize == 0u)
+    {
+        return false;
+    }
+    oFile.seekp(static_cast<std::streamoff>(uSize - 1u));
+    oFile.put('\0');
+    return static_cast<bool>(oFile);
+}
+
+} // unnamed namespace
+
+class PacketCapture::PacketCaptureImpl
+{
+public:
+    PacketCaptureImpl():
+        m_oMutex{},
+        m_pFileMapping{},
+        m_pMappedRegion{}
+    {
+
+    }
+
+    CaptureFileHeader *Open(std::string const &strFileName, std::uint64_t uCapacity)
+    {
+        std::lock_guard<std::mutex> oLock{m_oMutex};
+        if (m_pMappedRegion || uCapacity == 0u)
+        {
+            return nullptr;
+        }
+        try
+        {
+            RotateCaptureFiles(strFileName);
+            if (!CreateFileOfSize(strFileName, sizeof(CaptureFileHeader) + uCapacity))
+            {
+                return nullptr;
+            }
+            m_pFileMapping = std::make_unique<file_mapping>(strFileName.c_str(), read_write);
+            m_pMappedRegion = std::make_unique<mapped_region>(*m_pFileMapping, read_write);
+            auto *pHeader = new (m_pMappedRegion->get_address()) CaptureFileHeader{};
+            std::memcpy(pHeader->m_aMagic, S_aCaptureMagic, sizeof(S_aCaptureMagic));
+            pHeader->m_uVersion = S_uCaptureVersion;
+            pHeader->m_uCapacity = uCapacity;
+            pHeader->m_uDropped.store(0u, std::memory_order_relaxed);
+            pHeader->m_uSize.store(0u, std::memory_order_release);
+            return pHeader;
+        }
+        catch (...)
+        {
+            m_pMappedRegion.reset();
+            m_pFileMapping.reset();
+            return nullptr;
+        }
+    }
+
+private:
+    std::mutex m_oMutex;
+    std::unique_ptr<file_mapping> m_pFileMapping;
+    std::unique_ptr<mapped_region> m_pMappedRegion;
+};
+
+PacketCapture::PacketCapture():
+    m_pImpl{std::make_unique<PacketCaptureImpl>()},
+    m_pHeader{nullptr},
+    m_pRecords{nullptr}
+{
+
+}
+
+PacketCapture::~PacketCapture() = default;
+
+bool PacketCapture::Open(std::string const &strFileName, std::uint64_t uCapacity)
+{
+    auto *pHeader = m_pImpl->Open(strFileName, uCapacity);
+    if (!pHeader)
+    {
+        return false;
+    }
+    m_pRecords = reinterpret_cast<char *>(pHeader + 1);
+    m_pHeader.store(pHeader, std::memory_order_release);
+    return true;
+}
+
+bool PacketCapture::GetIsOpen() const
+{
+    return m_pHeader.load(std::memory_order_acquire) != nullptr;
+}
+
+void PacketCapture::Append(char const *pchData, std::size_t uSize, std::uint64_t uReceiveTimeNs)
+{
+    auto *pHeader = m_pHeader.load(std::memory_order_acquire);
+    if (!pHeader)
+    {
+        return;
+    }
+    // only this thread moves m_uSize
+    auto const uUsed = pHeader->m_uSize.load(std::memory_order_relaxed);
+    if (uSize > std::numeric_limits<std::uint32_t>::max()
+        || GetCaptureRecordSize(static_cast<std::uint32_t>(uSize)) > pHeader->m_uCapacity - uUsed)
+    {
+        pHeader->m_uDropped.fetch_add(1u, std::memory_order_relaxed);
+        return;
+    }
+    CaptureRecordHeader oRecord{};
+    oRecord.m_uReceiveTimeNs = uReceiveTimeNs;
+    oRecord.m_uSize = static_cast<std::uint32_t>(uSize);
+    // the padding is still zero from creating the file
+    std::memcpy(m_pRecords + uUsed, &oRecord, sizeof(oRecord));
+    std::memcpy(m_pRecords + uUsed + sizeof(oRecord), pchData, uSize);
+    pHeader->m_uSize.store(uUsed + GetCaptureRecordSize(oRecord.m_uSize), std::memory_order_release);
+}
+
+std::uint64_t PacketCapture::GetDroppedCount() const
+{
+    auto const *pHeader = m_pHeader.load(std::memory_order_acquire);
+    return pHeader ? pHeader->m_uDropped.load(std::memory_order_relaxed) : 0u;
+}
+
+class PacketCaptureReader::PacketCaptureReaderImpl
+{
+public:
+    PacketCaptureReaderImpl():
+        m_pFileMapping{},
+        m_pMappedRegion{}
+    {
+
+    }
+
+    // returns the header of a valid capture, nullptr otherwise
+    CaptureFileHeader const *Open(std::string const &strFileName)
+    {
+        try
+        {
+            m_pMappedRegion.reset();
+            m_pFileMapping = std::make_unique<file_mapping>(strFileName.c_str(), read_only);
+            m_pMappedRegion = std::make_unique<mapped_region>(*m_pFileMapping, read_only);
+            if (m_pMappedRegion->get_size() < sizeof(CaptureFileHeader))
+            {
+                return nullptr;
+            }
+            auto const *pHeader = static_cast<CaptureFileHeader const *>(m_pMappedRegion->get_address());
+            if (std::memcmp(pHeader->m_aMagic, S_aCaptureMagic, sizeof(S_aCaptureMagic)) != 0
+                || pHeader->m_uVersion != S_uCaptureVersion
+                || pHeader->m_uCapacity > m_pMappedRegion->get_size() - sizeof(CaptureFileHeader))
+            {
+                return nullptr;
+            }
+            return pHeader;
+        }
+        catch (...)
+        {
+            m_pMappedRegion.reset();
+            m_pFileMapping.reset();
+            return nullptr;
+        }
+    }
+
+private:
+    std::unique_ptr<file_mapping> m_pFileMapping;
+    std::unique_ptr<mapped_region> m_pMappedRegion;
+};
+
+PacketCaptureReader::PacketCaptureReader():
+    m_pImpl{std::make_unique<PacketCaptureReaderImpl>()},
+    m_pRecords{nullptr},
+    m_uSize{0u},
+    m_uOffset{0u},
+    m_uDropped{0u}
+{
+
+}
+
+PacketCaptureReader::~PacketCaptureReader() = default;
+
+bool PacketCaptureReader::Open(std::string const &strFileName)
+{
+    m_pRecords = nullptr;
+    m_uSize = 0u;
+    m_uOffset = 0u;
+    m_uDropped = 0u;
+    auto const *pHeader = m_pImpl->Open(strFileName);
+    if (!pHeader)
+    {
+        return false;
+    }
+    m_pRecords = reinterpret_cast<char const *>(pHeader + 1);
+    m_uSize = std::min(pHeader->m_uSize.load(std::memory_order_acquire), pHeader->m_uCapacity);
+    m_uDropped = pHeader->m_uDropped.load(std::memory_order_relaxed);
+    return true;
+}
+
+bool PacketCaptureReader::Next(std::uint64_t &uReceiveTimeNs, char const *&pchData, std::size_t &uSize)
+{
+    if (m_uSize - m_uOffset < sizeof(CaptureRecordHeader))
+    {
+        return false;
+    }
+    CaptureRecordHeader oRecord{};
+    std::memcpy(&oRecord, m_pRecords + m_uOffset, sizeof(oRecord));
+    auto const uRecordSize = GetCaptureRecordSize(oRecord.m_uSize);
+    if (uRecordSize > m_uSize - m_uOffset)
+    {
+        // truncated, treat it as the end
+        m_uOffset = m_uSize;
+        return false;
+    }
+    uReceiveTimeNs = oRecord.m_uReceiveTimeNs;
+    pchData = m_pRecords + m_uOffset + sizeof(oRecord);
+    uSize = oRecord.m_uSize;
+    m_uOffset += uRecordSize;
+    return true;
+}
+
+void PacketCaptureReader::Rewind()
+{
+    m_uOffset = 0u;
+}
+
+std::uint64_t PacketCaptureReader::GetDroppedCount() const
+{
+    return m_uDropped;
+}
+
+} // namespace spvr
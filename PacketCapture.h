@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2016
+ *  Somebody
+ */
+#ifndef SPVR_PACKETCAPTURE_H
+#define SPVR_PACKETCAPTURE_H
+
+#include "CaptureFormat.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace spvr
+{
+
+// Appends received datagrams with their receive time to a memory-mapped capture file, see
+// CaptureFormat.h. There must only be one appending thread. Append is two copies and one
+// release store, once the file is full further datagrams are only counted.
+class PacketCapture final
+{
+public:
+    PacketCapture();
+    ~PacketCapture();
+
+    // maps (and creates) the capture file with room for uCapacity bytes of records, can only
+    // be done once; an existing capture is moved aside to name.1.ext, and the last few of
+    // those are kept, so restarting the driver does not lose the previous session
+    bool Open(std::string const &strFileName, std::uint64_t uCapacity);
+    bool GetIsOpen() const;
+
+    // a no-op until Open succeeded
+    void Append(char const *pchData, std::size_t uSize, std::uint64_t uReceiveTimeNs);
+
+    // datagrams that did not fit into the file
+    std::uint64_t GetDroppedCount() const;
+
+private:
+    class PacketCaptureImpl;
+    std::unique_ptr<PacketCaptureImpl> m_pImpl;
+    std::atomic<CaptureFileHeader *> m_pHeader;
+    char *m_pRecords;
+};
+
+// Reads the records of a capture file in the order they were received. The file may still
+// be written to, only the records complete at Open are read.
+class PacketCaptureReader final
+{
+public:
+    PacketCaptureReader();
+    ~PacketCaptureReader();
+
+    // maps the file read only, returns false if it is missing or no capture
+    bool Open(std::string const &strFileName);
+
+    // returns false after the last record, pchData points into the mapping and stays
+    // valid as long as the reader
+    bool Next(std::uint64_t &uReceiveTimeNs, char const *&pchData, std::size_t &uSize);
+    // starts over at the first record
+    void Rewind();
+
+    // datagrams the capturing driver could not store anymore
+    std::uint64_t GetDroppedCount() const;
+
+private:
+    class PacketCaptureReaderImpl;
+    std::unique_ptr<PacketCaptureReaderImpl> m_pImpl;
+    char const *m_pRecords;
+    std::uint64_t m_uSize;
+    std::uint64_t m_uOffset;
+    std::uint64_t m_uDropped;
+};
+
+} // namespace spvr
+
+#endif // SPVR_PACKETCAPTURE_H
@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2016
+ *  Somebody
+ */
+#include "PoseHistory.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace spvr
+{
+
+namespace
+{
+
+std::size_t RoundUpToPowerOfTwo(std::size_t uSize)
+{
+    std::size_t uPowerOfTwo = 2u;
+    while (uPowerOfTwo < uSize)
+    {
+        uPowerOfTwo <<= 1u;
+    }
+    return uPowerOfTwo;
+}
+
+} // unnamed namespace
+
+PoseHistory::PoseHistory(std::size_t uCapacity, std::ptrdiff_t iStorageOffset):
+    m_uCapacity{RoundUpToPowerOfTwo(uCapacity)},
+    m_iStorageOffset{iStorageOffset},
+    m_uNextIndex{0u}
+{
+    static_assert(sizeof(Slot) == 64, "PoseHistory: a slot should fill exactly one cache line");
+    // the storage is zero-filled shared memory, sequence 0 means never written
+}
+
+std::size_t PoseHistory::GetStorageSize(std::size_t uCapacity)
+{
+    return RoundUpToPowerOfTwo(uCapacity) * sizeof(Slot);
+}
+
+PoseHistory::Slot *PoseHistory::GetSlots()
+{
+    return reinterpret_cast<Slot *>(reinterpret_cast<char *>(this) + m_iStorageOffset);
+}
+
+PoseHistory::Slot const *PoseHistory::GetSlots() const
+{
+    return reinterpret_cast<Slot const *>(reinterpret_cast<char const *>(this) + m_iStorageOffset);
+}
+
+void PoseHistory::Push(PoseSample const &oSample)
+{
+    auto const uIndex = m_uNextIndex.load(std::memory_order_relaxed);
+    auto &rSlot = GetSlots()[uIndex & (m_uCapacity - 1u)];
+    rSlot.m_uSequence.store(2u * uIndex + 1u, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(&rSlot.m_oSample, &oSample, sizeof(oSample));
+    rSlot.m_uSequence.store(2u * uIndex + 2u, std::memory_order_release);
+    m_uNextIndex.store(uIndex + 1u, std::memory_order_release);
+}
+
+std::size_t PoseHistory::Read(std::uint64_t &uCursor, PoseSample *pSamples, std::size_t uMaxSamples, std::uint64_t &uLost) const
+{
+    uLost = 0u;
+    std::size_t uRead = 0u;
+    auto const *pSlots = GetSlots();
+    while (uRead < uMaxSamples)
+    {
+        auto const uNextIndex = m_uNextIndex.load(std::memory_order_acquire);
+        if (uCursor >= uNextIndex)
+        {
+            break;
+        }
+        // the oldest slot may be rewritten any moment, keep one slot of distance
+        auto const uOldest = (uNextIndex > m_uCapacity - 1u) ? uNextIndex - (m_uCapacity - 1u) : 0u;
+        if (uCursor < uOldest)
+        {
+            uLost += uOldest - uCursor;
+            uCursor = uOldest;
+        }
+
+        auto const &rSlot = pSlots[uCursor & (m_uCapacity - 1u)];
+        auto const uExpected = 2u * uCursor + 2u;
+        if (rSlot.m_uSequence.load(std::memory_order_acquire) != uExpected)
+        {
+            // overwritten, look at the ring again
+            continue;
+        }
+        std::memcpy(&pSamples[uRead], &rSlot.m_oSample, sizeof(PoseSample));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (rSlot.m_uSequence.load(std::memory_order_relaxed) != uExpected)
+        {
+            continue;
+        }
+        ++uRead;
+        ++uCursor;
+    }
+    return uRead;
+}
+
+std::uint64_t PoseHistory::GetNextIndex() const
+{
+    return m_uNextIndex.load(std::memory_order_acquire);
+}
+
+std::size_t PoseHistory::GetCapacity() const
+{
+    return static_cast<std::size_t>(m_uCapacity);
+}
+
+} // namespace spvr
@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2016
+ *  Somebody
+ */
+#ifndef SPVR_POSEHISTORY_H
+#define SPVR_POSEHISTORY_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace spvr
+{
+
+struct PoseSample final
+{
+    // steady clock of the driver process, see Tracer::Now
+    std::uint64_t m_uTimestampNs;
+    // packet counter sent by the phone
+    std::int32_t m_iCounter;
+    // 0 for phones that send version 1 packets, see SpvrPacketV2
+    std::uint32_t m_uDeviceId;
+    // quaternions w, x, y, z as received and as published to SteamVR
+    float m_aRaw[4];
+    float m_aFiltered[4];
+    // sender's clock, 0 for version 1 packets
+    std::uint64_t m_uSendTimestampNs;
+};
+
+// Ring of the last N pose samples in shared memory, one writer (the driver's network
+// thread) and any number of readers in any process. Every slot is a seqlock, the writer
+// never waits and readers detect samples that were overwritten while being copied.
+// The slots follow the PoseHistory object at a self-relative offset, see ShmLog.
+class PoseHistory final
+{
+public:
+    // uCapacity is rounded up to a power of two, iStorageOffset is relative to this
+    PoseHistory(std::size_t uCapacity, std::ptrdiff_t iStorageOffset);
+    PoseHistory(PoseHistory const &) = delete;
+    PoseHistory &operator=(PoseHistory const &) = delete;
+
+    static std::size_t GetStorageSize(std::size_t uCapacity);
+
+    // writer side, wait-free
+    void Push(PoseSample const &oSample);
+
+    // Reader side, copies up to uMaxSamples samples starting at uCursor and advances it.
+    // A reader that fell more than the capacity behind skips to the oldest sample still
+    // intact, uLost receives the number of samples skipped. Start with uCursor = 0 to read
+    // everything still in the ring or with GetNextIndex() for new samples only.
+    std::size_t Read(std::uint64_t &uCursor, PoseSample *pSamples, std::size_t uMaxSamples, std::uint64_t &uLost) const;
+
+    // index the next sample will be written to, i.e. the number of samples ever written
+    std::uint64_t GetNextIndex() const;
+    std::size_t GetCapacity() const;
+
+private:
+    struct alignas(64) Slot
+    {
+        // 2 * index + 1 while sample index is written, 2 * index + 2 once it is complete
+        std::atomic<std::uint64_t> m_uSequence;
+        PoseSample m_oSample;
+    };
+
+    Slot *GetSlots();
+    Slot const *GetSlots() const;
+
+    // written once by the creator
+    std::uint64_t m_uCapacity;
+    std::int64_t m_iStorageOffset;
+
+    // written by the writer only
+    alignas(64) std::atomic<std::uint64_t> m_uNextIndex;
+};
+
+} // namespace spvr
+
+#endif // SPVR_POSEHISTORY_H
@@ -8,6 +8,9 @@
 #include "ControlInterface.h"
 #include "HmdDriver.h"
 #include "Logger.h"
+#include "PacketCapture.h"
+#include "SpvrPacket.h"
+#include "Tracer.h"
 
 #include "glm/glm.hpp"
 #include "glm/gtc/matrix_transform.hpp"
@@ -16,11 +19,16 @@
 #include <boost/array.hpp>
 #include <boost/asio.hpp>
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <cstring>
+#include <exception>
 #include <fstream>
+#include <iterator>
 #include <memory>
 #include <string>
+#include <thread>
 
 namespace spvr
 {
@@ -28,43 +36,57 @@ namespace spvr
 namespace
 {
 
-struct SpvrPacket
-{
-    float f[4];
-    std::int32_t m_iCounter;
-};
-
-union SpvrPacketByteHack
-{
-    char c[sizeof(SpvrPacket)];
-    SpvrPacket data;
-};
-
-void NtoH(SpvrPacketByteHack &packet)
-{
-    // not the way to to... UB!
-    for (int iByte = 0; iByte < sizeof(packet.c); iByte += 4)
-    {
-        std::swap(packet.c[iByte], packet.c[iByte + 3]);
-        std::swap(packet.c[iByte + 1], packet.c[iByte + 2]);
-    }
-}
+// a failing socket is set up again after an exponentially growing delay
+static auto const S_oMinRetryDelay = std::chrono::milliseconds{10};
+static auto const S_oMaxRetryDelay = std::chrono::milliseconds{2000};
+// every device id has its own packet counter, ids beyond this share filter slots
+static std::size_t const S_uMaxDevices = 16u;
+// transit times beyond this come from a sender with a different clock
+static std::uint64_t const S_uMaxTransitNs = 10000000000u;
+// longest sleep while replaying, so a shutdown does not wait for a long recorded gap
+static auto const S_oMaxReplaySleep = std::chrono::milliseconds{10};
 
 } // unnamed namespace
 
 class PoseUpdater::PoseUpdaterImpl
 {
 public:
-    PoseUpdaterImpl(Logger &rLogger, HmdDriver &rHmdDriver):
+    PoseUpdaterImpl(Logger &rLogger, HmdDriver &rHmdDriver, PoseUpdaterConfiguration const &oConfiguration):
         m_rLogger(rLogger),
         m_rHmdDriver(rHmdDriver),
         m_rControlInterface(Context::GetInstance().GetControlInterface()),
+        m_rTracer(Context::GetInstance().GetTracer()),
+        m_pTelemetry{m_rControlInterface.GetTelemetry()},
         m_bIsConnected{},
         m_bNetworkThreadActive{true},
+        m_uPort{oConfiguration.m_uPort},
+        m_strReplayFile{oConfiguration.m_strReplayFile},
+        m_eReplayTiming{oConfiguration.m_eReplayTiming},
+        m_oCapture{},
+        m_bResetFilter{false},
+        m_uReceived{0u},
+        m_uRejected{0u},
+        m_uLastSampleTime{0u},
+        m_uLastSendTime{0u},
+        m_uLastHandOffTime{0u},
+        m_aLastCounters{},
+        m_uLastArrival{0u},
         m_oNetworkThread{}
     {
+        std::fill(std::begin(m_aLastCounters), std::end(m_aLastCounters), -1);
+        if (!oConfiguration.m_strCaptureFile.empty())
+        {
+            if (m_oCapture.Open(oConfiguration.m_strCaptureFile, oConfiguration.m_uCaptureSize))
+            {
+                m_rLogger.Log(LogLevel::Info, "PoseUpdater => capturing to " + oConfiguration.m_strCaptureFile + "\n");
+            }
+            else
+            {
+                m_rLogger.Log(LogLevel::Error, "PoseUpdater => could not open the capture file " + oConfiguration.m_strCaptureFile + "\n");
+            }
+        }
         m_oNetworkThread = std::thread{
-            std::bind(&PoseUpdaterImpl::ReceiveUdp, this)
+            std::bind(m_strReplayFile.empty() ? &PoseUpdaterImpl::ReceiveUdp : &PoseUpdaterImpl::Replay, this)
         };
     }
     ~PoseUpdaterImpl()
@@ -78,14 +100,66 @@ public:
     void Shutdown()
     {
         m_bNetworkThreadActive = false;
+        Wake(m_uPort.load());
         if (m_oNetworkThread.joinable())
         {
             m_oNetworkThread.join();
         }
     }
-    void ProcessPacket(SpvrPacket const &packet)
+    void ResetFilter()
+    {
+        m_bResetFilter = true;
+    }
+
+    bool SetPort(std::uint16_t uPort)
+    {
+        if (uPort == 0u)
+        {
+            return false;
+        }
+        auto const uOldPort = m_uPort.exchange(uPort);
+        if (uOldPort != uPort)
+        {
+            Wake(uOldPort);
+        }
+        return true;
+    }
+
+    std::uint16_t GetPort() const
+    {
+        return m_uPort.load();
+    }
+
+    std::uint64_t GetReceivedCount() const
+    {
+        return m_uReceived.load(std::memory_order_relaxed);
+    }
+
+    std::uint64_t GetRejectedCount() const
+    {
+        return m_uRejected.load(std::memory_order_relaxed);
+    }
+
+    std::uint64_t GetLastSampleTime() const
+    {
+        return m_uLastSampleTime.load(std::memory_order_acquire);
+    }
+
+    std::uint64_t GetLastHandOffTime() const
+    {
+        return m_uLastHandOffTime.load(std::memory_order_relaxed);
+    }
+
+    std::uint64_t GetLastSendTime() const
+    {
+        return m_uLastSendTime.load(std::memory_order_relaxed);
+    }
+
+    // uStart is the receive time, it stamps the sample in the pose history, uFiltered the
+    // time the filter accepted the packet, only taken with telemetry
+    void ProcessPacket(SpvrPacketV2 const &packet, std::uint64_t uStart, std::uint64_t uFiltered)
     {
-        m_rLogger.Debug("received: {"
+        SPVR_LOG_DEBUG(&m_rLogger, "received: {"
             + std::to_string(packet.f[0]) + ", \t"
             + std::to_string(packet.f[1]) + ", \t"
             + std::to_string(packet.f[2]) + ", \t"
@@ -95,45 +169,255 @@ public:
         qRotation = glm::normalize(qRotation);
 
         m_rControlInterface.SetRotation(qRotation);
+
+        PoseSample oSample{};
+        oSample.m_uTimestampNs = uStart;
+        oSample.m_iCounter = packet.m_iCounter;
+        oSample.m_uDeviceId = packet.m_uDeviceId;
+        oSample.m_uSendTimestampNs = packet.m_uSendTimeNs;
+        std::copy(std::begin(packet.f), std::end(packet.f), std::begin(oSample.m_aRaw));
+        oSample.m_aFiltered[0] = qRotation.w;
+        oSample.m_aFiltered[1] = qRotation.x;
+        oSample.m_aFiltered[2] = qRotation.y;
+        oSample.m_aFiltered[3] = qRotation.z;
+        m_rControlInterface.PushPoseSample(oSample);
+        if (m_pTelemetry || m_rTracer.GetIsEnabled())
+        {
+            auto const uHandOff = Tracer::Now();
+            auto const uDuration = uHandOff - uStart;
+            if (m_pTelemetry)
+            {
+                m_pTelemetry->m_oPacketProcessing.Record(uDuration);
+                m_pTelemetry->m_oStageHandOff.Record(uHandOff - uFiltered);
+            }
+            m_rTracer.Record(TraceEvent::PoseUpdated, packet.m_iCounter, static_cast<std::int64_t>(uDuration));
+            m_uLastHandOffTime.store(uHandOff, std::memory_order_relaxed);
+        }
+        m_uLastSendTime.store(packet.m_uSendTimeNs, std::memory_order_relaxed);
+        // last, a reader that sees this sample's time also sees its pose and times
+        m_uLastSampleTime.store(uStart, std::memory_order_release);
+    }
+
+    // returns true if the datagram was a packet that updated the pose
+    bool ProcessDatagram(char const *pchData, std::size_t uSize, std::uint64_t uArrival)
+    {
+        SpvrPacketV2 oPacket{};
+        if (!Decode(pchData, uSize, oPacket))
+        {
+            // see Wake
+            return false;
+        }
+        m_uReceived.fetch_add(1u, std::memory_order_relaxed);
+        auto const uDecoded = m_pTelemetry ? Tracer::Now() : 0u;
+        if (m_pTelemetry)
+        {
+            m_pTelemetry->m_oPacketsReceived.Add();
+            m_pTelemetry->m_oStageDecode.Record(uDecoded - uArrival);
+            if (m_uLastArrival != 0u)
+            {
+                m_pTelemetry->m_oPacketInterArrival.Record(uArrival - m_uLastArrival);
+            }
+            if (oPacket.m_uSendTimeNs != 0u && oPacket.m_uSendTimeNs <= uArrival && uArrival - oPacket.m_uSendTimeNs < S_uMaxTransitNs)
+            {
+                m_pTelemetry->m_oPacketTransit.Record(uArrival - oPacket.m_uSendTimeNs);
+            }
+        }
+        m_uLastArrival = uArrival;
+        if (m_bResetFilter.exchange(false))
+        {
+            std::fill(std::begin(m_aLastCounters), std::end(m_aLastCounters), -1);
+        }
+        m_rTracer.Record(TraceEvent::PacketReceived, oPacket.m_iCounter, static_cast<std::int64_t>(uSize));
+        auto &rLastCounter = m_aLastCounters[oPacket.m_uDeviceId % S_uMaxDevices];
+        auto const bAccepted = oPacket.m_iCounter > rLastCounter || oPacket.m_iCounter < 1000;
+        auto const uFiltered = m_pTelemetry ? Tracer::Now() : 0u;
+        if (m_pTelemetry)
+        {
+            m_pTelemetry->m_oStageFilter.Record(uFiltered - uDecoded);
+        }
+        if (bAccepted)
+        {
+            rLastCounter = oPacket.m_iCounter;
+        }
+        else
+        {
+            m_rTracer.Record(TraceEvent::PacketRejected, oPacket.m_iCounter, rLastCounter);
+            m_uRejected.fetch_add(1u, std::memory_order_relaxed);
+            if (m_pTelemetry)
+            {
+                m_pTelemetry->m_oPacketsRejected.Add();
+            }
+            return false;
+        }
+        ProcessPacket(oPacket, uArrival, uFiltered);
+        return true;
+    }
+
+    // both wire formats in host byte order, version 1 packets come from device 0 and carry no send time
+    static bool Decode(char const *pchData, std::size_t uSize, SpvrPacketV2 &oPacket)
+    {
+        if (uSize >= sizeof(SpvrPacketV2))
+        {
+            SpvrPacketV2ByteHack oBytes;
+            std::memcpy(oBytes.c, pchData, sizeof(oBytes.c));
+            NtoH(oBytes);
+            if (oBytes.data.m_uMagic == S_uSpvrPacketV2Magic)
+            {
+                oPacket = oBytes.data;
+                return true;
+            }
+        }
+        if (uSize >= sizeof(SpvrPacket))
+        {
+            SpvrPacketByteHack oBytes;
+            std::memcpy(oBytes.c, pchData, sizeof(oBytes.c));
+            NtoH(oBytes);
+            std::copy(std::begin(oBytes.data.f), std::end(oBytes.data.f), std::begin(oPacket.f));
+            oPacket.m_iCounter = oBytes.data.m_iCounter;
+            return true;
+        }
+        return false;
     }
 
     void ReceiveUdp()
     {
-        std::int32_t m_iLastMsg = -1;
+        auto oRetryDelay = S_oMinRetryDelay;
         while (m_bNetworkThreadActive)
         {
+            auto bFailed = false;
             try
             {
                 using boost::asio::ip::udp;
+                auto const uPort = m_uPort.load();
                 boost::asio::io_service oIoService{};
-                udp::endpoint oEndpoint{udp::v4(), 4321};
+                udp::endpoint oEndpoint{udp::v4(), uPort};
                 udp::socket oSocket{oIoService, oEndpoint};
 
-                SpvrPacketByteHack oPacket;
-                std::memset(oPacket.c, 0, sizeof(oPacket.c));
+                char aBuffer[sizeof(SpvrPacketV2)];
                 boost::system::error_code oError{};
 
-                while (m_bNetworkThreadActive && oError != boost::asio::error::eof)
+                while (m_bNetworkThreadActive && oError != boost::asio::error::eof && m_uPort.load() == uPort)
                 {
                     //auto uBytesRead = oSocket.read_some(boost::asio::buffer(aBuffer.c), oError);
                     //auto uBytesRead = oSocket.receive_from(boost::asio::buffer(aBuffer.c), oEndpoint, 0, oError);
-                    auto uBytesRead = oSocket.receive(boost::asio::buffer(oPacket.c));
-                    NtoH(oPacket);
-                    if (oPacket.data.m_iCounter > m_iLastMsg || oPacket.data.m_iCounter < 1000)
+                    auto uBytesRead = oSocket.receive(boost::asio::buffer(aBuffer));
+                    auto const uArrival = Tracer::Now();
+                    if (uBytesRead != 0u)
                     {
-                        m_iLastMsg = oPacket.data.m_iCounter;
+                        // before processing, so the capture also holds what the filter rejects
+                        m_oCapture.Append(aBuffer, uBytesRead, uArrival);
                     }
-                    else
+                    if (ProcessDatagram(aBuffer, uBytesRead, uArrival))
                     {
-                        continue;
+                        oRetryDelay = S_oMinRetryDelay;
                     }
-                    ProcessPacket(oPacket.data);
                 }
             }
+            catch (std::exception const &e)
+            {
+                bFailed = true;
+                RecordSocketError();
+                SPVR_LOG_RATE_LIMITED(&m_rLogger, LogLevel::Error,
+                    std::string{"PoseUpdater::ReceiveUdp => "} + e.what() + "\n");
+            }
             catch (...)
             {
-                m_rLogger.Log("PoseUpdater::ReceiveUdp => some error occurred...");
+                bFailed = true;
+                RecordSocketError();
+                SPVR_LOG_RATE_LIMITED(&m_rLogger, LogLevel::Error, "PoseUpdater::ReceiveUdp => some error occurred...\n");
             }
+            if (bFailed)
+            {
+                oRetryDelay = BackOff(oRetryDelay);
+            }
+        }
+    }
+
+    // the network thread when there is a capture to replay, feeds it through ProcessDatagram
+    // once and idles until shutdown, so nothing but the capture reaches the pose
+    void Replay()
+    {
+        PacketCaptureReader oReader{};
+        if (!oReader.Open(m_strReplayFile))
+        {
+            m_rLogger.Log(LogLevel::Error, "PoseUpdater::Replay => could not open the capture " + m_strReplayFile + "\n");
+        }
+        else
+        {
+            m_rLogger.Log(LogLevel::Info, "PoseUpdater::Replay => replaying " + m_strReplayFile
+                + (m_eReplayTiming == ReplayTiming::Fast ? " back to back\n" : " at original timing\n"));
+            std::uint64_t uReplayed = 0u;
+            std::uint64_t uFirstReceiveTime = 0u;
+            std::uint64_t uReceiveTime = 0u;
+            char const *pchData = nullptr;
+            std::size_t uSize = 0u;
+            auto const uStart = Tracer::Now();
+            while (m_bNetworkThreadActive && oReader.Next(uReceiveTime, pchData, uSize))
+            {
+                if (uReplayed == 0u)
+                {
+                    uFirstReceiveTime = uReceiveTime;
+                }
+                if (m_eReplayTiming == ReplayTiming::Original && uReceiveTime > uFirstReceiveTime)
+                {
+                    SleepUntil(uStart + (uReceiveTime - uFirstReceiveTime));
+                }
+                ProcessDatagram(pchData, uSize, Tracer::Now());
+                ++uReplayed;
+            }
+            m_rLogger.Log(LogLevel::Info, "PoseUpdater::Replay => replayed " + std::to_string(uReplayed)
+                + " datagrams in " + std::to_string((Tracer::Now() - uStart) / 1000000u) + " ms, the capture had dropped "
+                + std::to_string(oReader.GetDroppedCount()) + "\n");
+        }
+        while (m_bNetworkThreadActive)
+        {
+            std::this_thread::sleep_for(S_oMaxReplaySleep);
+        }
+    }
+
+    // sleeps until Tracer::Now reaches uTime or the network thread is asked to stop
+    void SleepUntil(std::uint64_t uTime) const
+    {
+        for (auto uNow = Tracer::Now(); uNow < uTime && m_bNetworkThreadActive; uNow = Tracer::Now())
+        {
+            std::this_thread::sleep_for(std::min<std::chrono::nanoseconds>(std::chrono::nanoseconds{uTime - uNow}, S_oMaxReplaySleep));
+        }
+    }
+
+    void RecordSocketError()
+    {
+        m_rTracer.Record(TraceEvent::SocketError);
+        if (m_pTelemetry)
+        {
+            m_pTelemetry->m_oSocketErrors.Add();
+        }
+    }
+
+    // sleeps before the socket is set up again, doubling the delay up to S_oMaxRetryDelay
+    std::chrono::milliseconds BackOff(std::chrono::milliseconds oDelay) const
+    {
+        auto const oStep = std::chrono::milliseconds{10};
+        for (auto oSlept = std::chrono::milliseconds{0}; oSlept < oDelay && m_bNetworkThreadActive; oSlept += oStep)
+        {
+            std::this_thread::sleep_for(oStep);
+        }
+        return std::min(oDelay * 2, S_oMaxRetryDelay);
+    }
+
+    // unblocks the network thread's receive with an empty datagram to itself
+    static void Wake(std::uint16_t uPort)
+    {
+        try
+        {
+            using boost::asio::ip::udp;
+            boost::asio::io_service oIoService{};
+            udp::socket oSocket{oIoService, udp::endpoint{udp::v4(), 0}};
+            oSocket.send_to(boost::asio::buffer(static_cast<void const *>(nullptr), 0u),
+                udp::endpoint{boost::asio::ip::address_v4::loopback(), uPort});
+        }
+        catch (...)
+        {
+            // nobody listening, nothing to wake
         }
     }
 
@@ -142,13 +426,32 @@ private:
     Logger &m_rLogger;
     HmdDriver &m_rHmdDriver;
     ControlInterface &m_rControlInterface;
+    Tracer &m_rTracer;
+    Telemetry *m_pTelemetry;
     bool m_bIsConnected;
-    bool m_bNetworkThreadActive;
+    std::atomic<bool> m_bNetworkThreadActive;
+    std::atomic<std::uint16_t> m_uPort;
+    std::string const m_strReplayFile;
+    ReplayTiming const m_eReplayTiming;
+    // only appended to by the network thread
+    PacketCapture m_oCapture;
+    std::atomic<bool> m_bResetFilter;
+    std::atomic<std::uint64_t> m_uReceived;
+    std::atomic<std::uint64_t> m_uRejected;
+    // receive time of the last accepted sample in Tracer::Now ticks
+    std::atomic<std::uint64_t> m_uLastSampleTime;
+    // send time of the last accepted sample on the sender's clock, 0 for version 1 packets
+    std::atomic<std::uint64_t> m_uLastSendTime;
+    // time the last accepted sample became visible to the pose thread, only kept with telemetry or tracing
+    std::atomic<std::uint64_t> m_uLastHandOffTime;
+    // the packet filter, only touched by the thread that processes datagrams
+    std::int32_t m_aLastCounters[S_uMaxDevices];
+    std::uint64_t m_uLastArrival;
     std::thread m_oNetworkThread;
 };
 
-PoseUpdater::PoseUpdater(Logger &rLogger, HmdDriver &rHmdDriver):
-    m_pImpl{std::make_unique<PoseUpdaterImpl>(rLogger, rHmdDriver)}
+PoseUpdater::PoseUpdater(Logger &rLogger, HmdDriver &rHmdDriver, PoseUpdaterConfiguration const &oConfiguration):
+    m_pImpl{std::make_unique<PoseUpdaterImpl>(rLogger, rHmdDriver, oConfiguration)}
 {
 
 }
@@ -165,4 +468,49 @@ void PoseUpdater::Shutdown()
     m_pImpl->Shutdown();
 }
 
+void PoseUpdater::ResetFilter()
+{
+    m_pImpl->ResetFilter();
+}
+
+bool PoseUpdater::ProcessDatagram(char const *pchData, std::size_t uSize)
+{
+    return m_pImpl->ProcessDatagram(pchData, uSize, Tracer::Now());
+}
+
+bool PoseUpdater::SetPort(std::uint16_t uPort)
+{
+    return m_pImpl->SetPort(uPort);
+}
+
+std::uint16_t PoseUpdater::GetPort() const
+{
+    return m_pImpl->GetPort();
+}
+
+std::uint64_t PoseUpdater::GetReceivedCount() const
+{
+    return m_pImpl->GetReceivedCount();
+}
+
+std::uint64_t PoseUpdater::GetRejectedCount() const
+{
+    return m_pImpl->GetRejectedCount();
+}
+
+std::uint64_t PoseUpdater::GetLastSampleTime() const
+{
+    return m_pImpl->GetLastSampleTime();
+}
+
+std::uint64_t PoseUpdater::GetLastHandOffTime() const
+{
+    return m_pImpl->GetLastHandOffTime();
+}
+
+std::uint64_t PoseUpdater::GetLastSendTime() const
+{
+    return m_pImpl->GetLastSendTime();
+}
+
 } // namespace spvr
@@ -5,7 +5,10 @@
 #ifndef SPVR_POSEUPDATER_H
 #define SPVR_POSEUPDATER_H
 
+#include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <string>
 
 namespace spvr
 {
@@ -13,15 +16,57 @@ namespace spvr
 class HmdDriver;
 class Logger;
 
+enum class ReplayTiming
+{
+    // the recorded gaps between datagrams
+    Original,
+    // back to back
+    Fast
+};
+
+struct PoseUpdaterConfiguration final
+{
+    std::uint16_t m_uPort = 4321u;
+    // if set, every datagram received on the socket is appended to this file, see PacketCapture
+    std::string m_strCaptureFile;
+    // bytes of records the capture file has room for
+    std::uint64_t m_uCaptureSize = 64u << 20;
+    // if set, this capture is fed through the processing path once instead of listening
+    // on the socket, the receive times are those of the replay
+    std::string m_strReplayFile;
+    ReplayTiming m_eReplayTiming = ReplayTiming::Original;
+};
+
 class PoseUpdater final
 {
 public:
-    PoseUpdater(Logger &rLogger, HmdDriver &rHmdDriver);
+    PoseUpdater(Logger &rLogger, HmdDriver &rHmdDriver, PoseUpdaterConfiguration const &oConfiguration = PoseUpdaterConfiguration{});
     ~PoseUpdater();
 
     bool GetIsConnected() const;
     void Shutdown();
 
+    // accepts the next packet of every device regardless of its counter, e.g. after the phone app restarted
+    void ResetFilter();
+    // Runs a datagram through the same path as one received on the socket, returns true if
+    // it updated the pose. Not thread safe against the network thread, only for datagrams
+    // that do not arrive on the socket, e.g. in benchmarks.
+    bool ProcessDatagram(char const *pchData, std::size_t uSize);
+    // rebinds the socket, returns false for an invalid port, has no effect while replaying
+    bool SetPort(std::uint16_t uPort);
+    std::uint16_t GetPort() const;
+
+    // packets received and packets rejected for an outdated counter
+    std::uint64_t GetReceivedCount() const;
+    std::uint64_t GetRejectedCount() const;
+    // receive time of the newest accepted sample in Tracer::Now ticks, 0 before the first,
+    // the pose and the times below are at least as new as the sample this returns
+    std::uint64_t GetLastSampleTime() const;
+    // time the newest accepted sample was handed to the pose thread, 0 without telemetry
+    std::uint64_t GetLastHandOffTime() const;
+    // sender's send time of the newest accepted sample, 0 unless it came in a version 2 packet
+    std::uint64_t GetLastSendTime() const;
+
 private:
     class PoseUpdaterImpl;
     std::unique_ptr<PoseUpdaterImpl> m_pImpl;
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2016
+ *  Somebody
+ */
+#ifndef SPVR_RESPONSEWRITER_H
+#define SPVR_RESPONSEWRITER_H
+
+#include <cstdarg>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+
+namespace spvr
+{
+
+// Writes text into a buffer owned by the caller, e.g. the response of a DebugRequest. Never
+// allocates, cuts the text at the end of the buffer and always leaves it null terminated.
+class ResponseWriter final
+{
+public:
+    ResponseWriter(char *pchBuffer, std::size_t uBufferSize):
+        m_pchBuffer{uBufferSize != 0u ? pchBuffer : nullptr},
+        m_uBufferSize{pchBuffer ? uBufferSize : 0u},
+        m_uLength{0u},
+        m_bTruncated{false}
+    {
+        if (m_pchBuffer)
+        {
+            m_pchBuffer[0] = '\0';
+        }
+    }
+
+    ResponseWriter(ResponseWriter const &) = delete;
+    ResponseWriter &operator=(ResponseWriter const &) = delete;
+
+    void Append(char const *pchText)
+    {
+        auto const uLength = std::strlen(pchText);
+        auto const uCopied = uLength < GetRemaining() ? uLength : GetRemaining();
+        if (uCopied != 0u)
+        {
+            std::memcpy(m_pchBuffer + m_uLength, pchText, uCopied);
+            m_uLength += uCopied;
+            m_pchBuffer[m_uLength] = '\0';
+        }
+        m_bTruncated = m_bTruncated || uCopied < uLength;
+    }
+
+    // printf style
+    void Format(char const *pchFormat, ...)
+    {
+        if (!m_pchBuffer)
+        {
+            m_bTruncated = true;
+            return;
+        }
+        va_list oArgs;
+        va_start(oArgs, pchFormat);
+        auto const iWritten = std::vsnprintf(m_pchBuffer + m_uLength, m_uBufferSize - m_uLength, pchFormat, oArgs);
+        va_end(oArgs);
+        if (iWritten < 0)
+        {
+            // nothing sensible was written, drop it
+            m_pchBuffer[m_uLength] = '\0';
+            return;
+        }
+        auto const uWritten = static_cast<std::size_t>(iWritten);
+        m_bTruncated = m_bTruncated || uWritten > GetRemaining();
+        m_uLength += uWritten < GetRemaining() ? uWritten : GetRemaining();
+    }
+
+    std::size_t GetLength() const
+    {
+        return m_uLength;
+    }
+
+    // true once some text did not fit
+    bool GetIsTruncated() const
+    {
+        return m_bTruncated;
+    }
+
+private:
+    // characters that still fit in front of the terminator
+    std::size_t GetRemaining() const
+    {
+        return m_pchBuffer ? m_uBufferSize - 1u - m_uLength : 0u;
+    }
+
+    char *m_pchBuffer;
+    std::size_t m_uBufferSize;
+    std::size_t m_uLength;
+    bool m_bTruncated;
+};
+
+} // namespace spvr
+
+#endif // SPVR_RESPONSEWRITER_H
@@ -4,10 +4,14 @@
  */
 #include "ServerProvider.h"
 
+#include "CommandQueue.h"
 #include "Context.h"
+#include "ControlInterface.h"
 #include "HmdDriver.h"
 #include "Logger.h"
+#include "Tracer.h"
 
+#include <algorithm>
 #include <chrono>
 #include <cstring>
 #include <fstream>
@@ -18,6 +22,8 @@ namespace spvr
 {
 
 SmartServer::SmartServer():
+m_pLogger{},
+m_pDriverLog{},
 m_pHmdDriver{}
 {
 
@@ -27,6 +33,7 @@ SmartServer::~SmartServer() = default;
 
 vr::EVRInitError SmartServer::Init(vr::IDriverLog *pDriverLog, vr::IServerDriverHost *pDriverHost, const char *pchUserDriverConfigDir, const char *pchDriverInstallDir)
 {
+    std::string const strUserDriverConfigDir{pchUserDriverConfigDir ? pchUserDriverConfigDir : ""};
     if (!pchUserDriverConfigDir)
     {
         pchUserDriverConfigDir = "nullptr";
@@ -38,35 +45,62 @@ vr::EVRInitError SmartServer::Init(vr::IDriverLog *pDriverLog, vr::IServerDriver
     Context *pContext = nullptr;
     try
     {
-        pContext = &Context::GetInstance();
+        pContext = &Context::Acquire();
     }
     catch (...)
     {
         return vr::VRInitError_Init_HmdNotFound;
     }
     m_pLogger = &pContext->GetLogger();
+    // vrserver is the only process whose lines go to the shared memory log
+    pContext->GetControlInterface().SetLogProducer(true);
+    // the segment may have been created by an earlier run, none of our writers runs yet
+    if (auto *pTelemetry = pContext->GetControlInterface().GetTelemetry())
+    {
+        pTelemetry->Reset();
+    }
     if (pDriverLog)
     {
+        m_pDriverLog = pDriverLog;
         m_pLogger->AddDriverLog(pDriverLog);
     }
-    m_pLogger->Debug(std::string{"SmartServer::Init(\""} +pchUserDriverConfigDir + "\", \"" + pchDriverInstallDir + "\");\n");
+    SPVR_LOG_DEBUG(m_pLogger, std::string{"SmartServer::Init(\""} +pchUserDriverConfigDir + "\", \"" + pchDriverInstallDir + "\");\n");
+
+    auto *pSettings = pDriverHost ? pDriverHost->GetSettings(vr::IVRSettings_Version) : nullptr;
+    if (pSettings && pSettings->GetBool("spvr", "trace", false) && !strUserDriverConfigDir.empty())
+    {
+        auto &rTracer = pContext->GetTracer();
+        auto const iTraceRecords = pSettings->GetInt32("spvr", "trace-records", static_cast<std::int32_t>(Tracer::S_uDefaultCapacity));
+        if (rTracer.Open(strUserDriverConfigDir + "/spvr-trace.bin", static_cast<std::uint64_t>(std::max(iTraceRecords, 1))))
+        {
+            rTracer.SetEnabled(true);
+        }
+        else
+        {
+            m_pLogger->Log("SmartServer::Init => could not open the trace file\n");
+        }
+    }
 
     try
     {
         if (pDriverHost)
         {
-            m_pHmdDriver = std::make_unique<HmdDriver>(pDriverHost, m_pLogger);
+            m_pHmdDriver = std::make_unique<HmdDriver>(pDriverHost, m_pLogger, strUserDriverConfigDir);
             pDriverHost->TrackedDeviceAdded(m_pHmdDriver->GetSerialNumber());
         }
         else
         {
             m_pLogger->Log("Initialization of HmdDriver failed, pDriverHost == nullptr!\n");
-            return vr::VRInitError_Init_HmdNotFound;
         }
     }
     catch (...)
     {
         m_pLogger->Log("Initialization of HmdDriver failed!\n");
+    }
+    if (!m_pHmdDriver)
+    {
+        // the module is unloaded right after a failed Init, Cleanup is not called
+        Cleanup();
         return vr::VRInitError_Init_HmdNotFound;
     }
 
@@ -76,18 +110,27 @@ vr::EVRInitError SmartServer::Init(vr::IDriverLog *pDriverLog, vr::IServerDriver
 /** cleans up the driver right before it is unloaded */
 void SmartServer::Cleanup()
 {
+    SPVR_LOG_DEBUG(m_pLogger, "SmartServer::Cleanup()\n");
+    // joins the pose, network and lens threads, nothing uses the context after this
+    m_pHmdDriver.reset(nullptr);
     if (m_pLogger)
     {
-        m_pLogger->Debug("SmartServer::Cleanup()\n");
+        m_pLogger->Flush();
+        Context::GetInstance().GetControlInterface().SetLogProducer(false);
+        if (m_pDriverLog)
+        {
+            m_pLogger->RemoveDriverLog(m_pDriverLog);
+            m_pDriverLog = nullptr;
+        }
+        m_pLogger = nullptr;
+        Context::Release();
     }
-    m_pHmdDriver.reset(nullptr);
-    //Context::Destroy();
 }
 
 /** returns the number of HMDs that this driver manages that are physically connected. */
 std::uint32_t SmartServer::GetTrackedDeviceCount()
 {
-    m_pLogger->Debug("SmartServer::GetTrackedDeviceCount()\n");
+    SPVR_LOG_DEBUG(m_pLogger, "SmartServer::GetTrackedDeviceCount()\n");
     return 1;
 }
 
@@ -98,7 +141,7 @@ vr::ITrackedDeviceServerDriver *SmartServer::GetTrackedDeviceDriver(std::uint32_
     {
         pchInterfaceVersion = "nullptr";
     }
-    m_pLogger->Debug(std::string{"SmartServer::GetTrackedDeviceDriver("} +std::to_string(uWhich) + ", \"" + pchInterfaceVersion + "\");\n");
+    SPVR_LOG_DEBUG(m_pLogger, std::string{"SmartServer::GetTrackedDeviceDriver("} +std::to_string(uWhich) + ", \"" + pchInterfaceVersion + "\");\n");
     if (std::string{pchInterfaceVersion} != vr::ITrackedDeviceServerDriver_Version)
     {
         return nullptr;
@@ -118,7 +161,7 @@ vr::ITrackedDeviceServerDriver *SmartServer::FindTrackedDeviceDriver(char const
     {
         pchInterfaceVersion = "nullptr";
     }
-    m_pLogger->Debug(std::string{"SmartServer::GetTrackedDeviceDriver("} +pchId + ", \"" + pchInterfaceVersion + "\");\n");
+    SPVR_LOG_DEBUG(m_pLogger, std::string{"SmartServer::GetTrackedDeviceDriver("} +pchId + ", \"" + pchInterfaceVersion + "\");\n");
     if (std::string{pchInterfaceVersion} != vr::ITrackedDeviceServerDriver_Version)
     {
         return nullptr;
@@ -132,11 +175,31 @@ void SmartServer::RunFrame()
 {
     if (m_pHmdDriver)
     {
-        static auto msSinceLastRunFrame = std::chrono::system_clock::now();
-        auto const now = std::chrono::system_clock::now();
+        static auto msSinceLastRunFrame = std::chrono::steady_clock::now();
+        auto const now = std::chrono::steady_clock::now();
         auto const timeDiff = now - msSinceLastRunFrame;
         msSinceLastRunFrame = now;
+        auto const iInterval = std::chrono::duration_cast<std::chrono::nanoseconds>(timeDiff).count();
+        Context::GetInstance().GetTracer().Record(TraceEvent::RunFrame, iInterval);
         //m_pLogger->Log(std::string{"SmartServer::RunFrame() [time since last: "} +std::to_string(std::chrono::duration_cast<std::chrono::milliseconds>(timeDiff).count()) + " ms]\n");
+
+        // commands from the control app, executed here so the pose path needs no locks
+        auto &rControlInterface = Context::GetInstance().GetControlInterface();
+        auto const pTelemetry = rControlInterface.GetTelemetry();
+        Command oCommand{};
+        std::uint64_t uCommands = 0u;
+        while (rControlInterface.PopCommand(oCommand))
+        {
+            rControlInterface.CompleteCommand(oCommand.m_uSequence, m_pHmdDriver->ExecuteCommand(oCommand));
+            ++uCommands;
+        }
+        if (pTelemetry)
+        {
+            pTelemetry->m_oRunFrames.Add();
+            pTelemetry->m_oCommandsExecuted.Add(uCommands);
+            pTelemetry->m_oRunFrameInterval.Record(static_cast<std::uint64_t>(iInterval));
+        }
+
         m_pHmdDriver->RunFrame();
     }
 }
@@ -147,7 +210,7 @@ void SmartServer::RunFrame()
 /** Returns true if the driver wants to block Standby mode. */
 bool SmartServer::ShouldBlockStandbyMode()
 {
-    m_pLogger->Debug("SmartServer::ShouldBlockStandbyMode()\n");
+    SPVR_LOG_DEBUG(m_pLogger, "SmartServer::ShouldBlockStandbyMode()\n");
     return false;
 }
 
@@ -155,14 +218,14 @@ bool SmartServer::ShouldBlockStandbyMode()
 * state it has. */
 void SmartServer::EnterStandby()
 {
-    m_pLogger->Debug("SmartServer::EnterStandby()\n");
+    SPVR_LOG_DEBUG(m_pLogger, "SmartServer::EnterStandby()\n");
 }
 
 /** Called when the system is leaving Standby mode. The driver should switch itself back to
 full operation. */
 void SmartServer::LeaveStandby()
 {
-    m_pLogger->Debug("SmartServer::LeaveStandby()\n");
+    SPVR_LOG_DEBUG(m_pLogger, "SmartServer::LeaveStandby()\n");
 }
 
 } // namespace spvr
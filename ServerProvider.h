@@ -62,6 +62,8 @@ public:
     full operation. */
     virtual void LeaveStandby() override;
 private:
+    // registered with the context's logger from Init to Cleanup
+    vr::IDriverLog *m_pDriverLog;
     std::unique_ptr<HmdDriver> m_pHmdDriver;
 };
 
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2016
+ *  Somebody
+ */
+#ifndef SPVR_SHAREDMEMORYLAYOUT_H
+#define SPVR_SHAREDMEMORYLAYOUT_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace spvr
+{
+
+// Layout of the shared memory segment shared by the driver and the control app.
+// The segment starts with a SharedMemoryHeader followed by the sections listed in its
+// section table. A section is found by id, it is compatible if its version matches and
+// it is at least as large as the reader's struct, so sections may grow by appending
+// fields and new sections may be added without a lock-step upgrade of both sides.
+// S_uShmLayoutVersion only changes if the header itself changes.
+
+enum class ShmSectionId : std::uint32_t
+{
+    None = 0,
+    Control = 1,        // ControlSection: rotation and lens parameters
+    Log = 2,            // ShmLog
+    LogStorage = 3,     // record storage of the ShmLog
+    PoseHistory = 4,    // PoseHistory
+    PoseHistoryStorage = 5, // slots of the PoseHistory
+    Notifier = 6,       // ShmNotifier, one channel per section id
+    Commands = 7,       // CommandQueue from the control app to the driver
+    Telemetry = 8,      // Telemetry counters and histograms
+};
+
+static char const S_aShmMagic[8] = {'S', 'P', 'V', 'R', 'S', 'H', 'M', '1'};
+static std::uint32_t const S_uShmLayoutVersion = 1u;
+static std::uint32_t const S_uShmMaxSections = 16u;
+// sections start on their own cache line
+static std::size_t const S_uShmSectionAlignment = 64u;
+
+enum class ShmState : std::uint32_t
+{
+    Initializing = 0,
+    Ready = 1
+};
+
+struct ShmSectionEntry final
+{
+    ShmSectionId m_eId;
+    std::uint32_t m_uVersion;
+    // from the start of the segment
+    std::uint64_t m_uOffset;
+    std::uint64_t m_uSize;
+};
+
+struct SharedMemoryHeader final
+{
+    char m_aMagic[8];
+    std::uint32_t m_uLayoutVersion;
+    // set to Ready by the creator once all sections are constructed
+    std::atomic<std::uint32_t> m_uState;
+    std::uint64_t m_uSegmentSize;
+    std::uint32_t m_uSectionCount;
+    std::uint32_t m_uReserved;
+    ShmSectionEntry m_aSections[S_uShmMaxSections];
+
+    ShmSectionEntry const *FindSection(ShmSectionId eId) const
+    {
+        for (std::uint32_t i = 0; i < m_uSectionCount && i < S_uShmMaxSections; ++i)
+        {
+            if (m_aSections[i].m_eId == eId)
+            {
+                return &m_aSections[i];
+            }
+        }
+        return nullptr;
+    }
+};
+
+static_assert(sizeof(ShmSectionEntry) == 24, "ShmSectionEntry: unexpected size");
+static_assert(ATOMIC_INT_LOCK_FREE == 2, "SharedMemoryHeader: 32 bit atomics must be lock-free to be shared between processes");
+
+} // namespace spvr
+
+#endif // SPVR_SHAREDMEMORYLAYOUT_H
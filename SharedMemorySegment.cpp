@@ -0,0 +1,319 @@
+/*
+ * Copyright (c) 2016
+ *  Somebody
+ */
+#include "SharedMemorySegment.h"
+
+#include "ControlInterface.h"
+
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <thread>
+
+#if defined(_WIN32)
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/interprocess/windows_shared_memory.hpp>
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif // WIN32_LEAN_AND_MEAN
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif // NOMINMAX
+#include <windows.h>
+#else // ! _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif // ! _WIN32
+
+namespace spvr
+{
+
+namespace
+{
+
+#if !defined(_WIN32)
+#if defined(SPVR_SHM_HUGEPAGES)
+// hugetlbfs mount point, segments are plain files there
+static char const S_aHugePageDirectory[] = "/dev/hugepages/";
+static std::size_t const S_uHugePageSize = 2u * 1024u * 1024u;
+#endif // SPVR_SHM_HUGEPAGES
+// a segment opened while its creator hasn't sized it yet is retried this often
+static int const S_iSizeRetries = 100;
+static auto const S_oSizeRetryDelay = std::chrono::milliseconds{1};
+
+std::size_t RoundUp(std::size_t uSize, std::size_t uGranularity)
+{
+    return (uSize + uGranularity - 1u) / uGranularity * uGranularity;
+}
+#endif // ! _WIN32
+
+} // unnamed namespace
+
+#if defined(_WIN32)
+
+class SharedMemorySegment::SharedMemorySegmentImpl
+{
+public:
+    SharedMemorySegmentImpl(char const *pchName, std::size_t uSize):
+        m_pShmObject{},
+        m_pMappedRegion{},
+        m_bCreated{false},
+        m_bLocked{false}
+    {
+        using namespace boost::interprocess;
+        try
+        {
+            m_pShmObject = std::make_unique<windows_shared_memory>(open_only, pchName, read_write);
+            m_pMappedRegion = std::make_unique<mapped_region>(*m_pShmObject, read_write);
+        }
+        catch (...)
+        {
+            try
+            {
+                m_pShmObject = std::make_unique<windows_shared_memory>(create_only, pchName, read_write, uSize);
+                m_pMappedRegion = std::make_unique<mapped_region>(*m_pShmObject, read_write);
+                m_bCreated = true;
+            }
+            catch (interprocess_exception const &e)
+            {
+                throw ControlInterface::ControlInterfaceException{std::string{"SharedMemorySegment: "} + e.what()};
+            }
+        }
+#if defined(SPVR_SHM_POPULATE)
+        // fault every page in now instead of on first use
+        auto const *pBytes = static_cast<char const volatile *>(GetAddress());
+        auto const uPageSize = mapped_region::get_page_size();
+        for (std::size_t uOffset = 0; uOffset < GetSize(); uOffset += uPageSize)
+        {
+            (void)pBytes[uOffset];
+        }
+#endif // SPVR_SHM_POPULATE
+#if defined(SPVR_SHM_LOCK)
+        m_bLocked = VirtualLock(GetAddress(), GetSize()) != FALSE;
+#endif // SPVR_SHM_LOCK
+    }
+
+    ~SharedMemorySegmentImpl()
+    {
+        if (m_bLocked)
+        {
+            VirtualUnlock(GetAddress(), GetSize());
+        }
+    }
+
+    void *GetAddress() const
+    {
+        return m_pMappedRegion->get_address();
+    }
+
+    std::size_t GetSize() const
+    {
+        return m_pMappedRegion->get_size();
+    }
+
+    bool GetIsCreated() const
+    {
+        return m_bCreated;
+    }
+
+    bool GetIsLocked() const
+    {
+        return m_bLocked;
+    }
+
+private:
+    std::unique_ptr<boost::interprocess::windows_shared_memory> m_pShmObject;
+    std::unique_ptr<boost::interprocess::mapped_region> m_pMappedRegion;
+    bool m_bCreated;
+    bool m_bLocked;
+};
+
+#else // ! _WIN32
+
+class SharedMemorySegment::SharedMemorySegmentImpl
+{
+public:
+    SharedMemorySegmentImpl(char const *pchName, std::size_t uSize):
+        m_pAddress{nullptr},
+        m_uSize{RoundUp(uSize, static_cast<std::size_t>(sysconf(_SC_PAGESIZE)))},
+        m_bCreated{false},
+        m_bLocked{false}
+    {
+#if defined(SPVR_SHM_HUGEPAGES)
+        // falls back to regular pages if hugetlbfs isn't mounted or has no free pages
+        if (!Attach(std::string{S_aHugePageDirectory} + pchName, RoundUp(uSize, S_uHugePageSize), true))
+#endif // SPVR_SHM_HUGEPAGES
+        {
+            // POSIX names start with a single slash
+            if (!Attach(std::string{"/"} + pchName, m_uSize, false))
+            {
+                throw ControlInterface::ControlInterfaceException{
+                    std::string{"SharedMemorySegment: could not open or create "} + pchName + ", errno " + std::to_string(errno)};
+            }
+        }
+#if defined(SPVR_SHM_LOCK)
+        m_bLocked = mlock(m_pAddress, m_uSize) == 0;
+#endif // SPVR_SHM_LOCK
+    }
+
+    ~SharedMemorySegmentImpl()
+    {
+        if (m_bLocked)
+        {
+            munlock(m_pAddress, m_uSize);
+        }
+        munmap(m_pAddress, m_uSize);
+    }
+
+    void *GetAddress() const
+    {
+        return m_pAddress;
+    }
+
+    std::size_t GetSize() const
+    {
+        return m_uSize;
+    }
+
+    bool GetIsCreated() const
+    {
+        return m_bCreated;
+    }
+
+    bool GetIsLocked() const
+    {
+        return m_bLocked;
+    }
+
+private:
+    static int Open(std::string const &strPath, bool bHugePages, int iFlags)
+    {
+        return bHugePages ? open(strPath.c_str(), iFlags, 0600) : shm_open(strPath.c_str(), iFlags, 0600);
+    }
+
+    static void Remove(std::string const &strPath, bool bHugePages)
+    {
+        bHugePages ? unlink(strPath.c_str()) : shm_unlink(strPath.c_str());
+    }
+
+    // opens the segment or creates it with uSize bytes, then maps it
+    bool Attach(std::string const &strPath, std::size_t uSize, bool bHugePages)
+    {
+        auto iFile = -1;
+        for (auto iRetry = 0; iFile < 0 && iRetry < S_iSizeRetries; ++iRetry)
+        {
+            iFile = Open(strPath, bHugePages, O_RDWR);
+            if (iFile >= 0)
+            {
+                struct stat oStat{};
+                if (fstat(iFile, &oStat) != 0)
+                {
+                    close(iFile);
+                    return false;
+                }
+                auto const uExisting = static_cast<std::size_t>(oStat.st_size);
+                if (uExisting != 0u)
+                {
+                    // whatever its size, the layout header tells what's inside
+                    uSize = uExisting;
+                    break;
+                }
+                close(iFile);
+                iFile = -1;
+                if (iRetry < S_iSizeRetries / 2)
+                {
+                    // the creator hasn't sized it yet
+                    std::this_thread::sleep_for(S_oSizeRetryDelay);
+                    continue;
+                }
+                // left behind by a crashed creator
+                Remove(strPath, bHugePages);
+            }
+            else if (errno != ENOENT)
+            {
+                return false;
+            }
+
+            iFile = Open(strPath, bHugePages, O_RDWR | O_CREAT | O_EXCL);
+            if (iFile >= 0)
+            {
+                if (ftruncate(iFile, static_cast<off_t>(uSize)) != 0)
+                {
+                    close(iFile);
+                    Remove(strPath, bHugePages);
+                    return false;
+                }
+                m_bCreated = true;
+            }
+            else if (errno != EEXIST)
+            {
+                return false;
+            }
+        }
+        if (iFile < 0)
+        {
+            return false;
+        }
+
+        auto iFlags = MAP_SHARED;
+#if defined(SPVR_SHM_POPULATE) && defined(MAP_POPULATE)
+        iFlags |= MAP_POPULATE;
+#endif // SPVR_SHM_POPULATE && MAP_POPULATE
+        auto *pAddress = mmap(nullptr, uSize, PROT_READ | PROT_WRITE, iFlags, iFile, 0);
+        close(iFile);
+        if (pAddress == MAP_FAILED)
+        {
+            if (m_bCreated)
+            {
+                Remove(strPath, bHugePages);
+                m_bCreated = false;
+            }
+            return false;
+        }
+        m_pAddress = pAddress;
+        m_uSize = uSize;
+        return true;
+    }
+
+    void *m_pAddress;
+    std::size_t m_uSize;
+    bool m_bCreated;
+    bool m_bLocked;
+};
+
+#endif // ! _WIN32
+
+SharedMemorySegment::SharedMemorySegment(char const *pchName, std::size_t uSize):
+    m_pImpl{std::make_unique<SharedMemorySegmentImpl>(pchName, uSize)}
+{
+
+}
+
+SharedMemorySegment::~SharedMemorySegment() = default;
+
+void *SharedMemorySegment::GetAddress() const
+{
+    return m_pImpl->GetAddress();
+}
+
+std::size_t SharedMemorySegment::GetSize() const
+{
+    return m_pImpl->GetSize();
+}
+
+bool SharedMemorySegment::GetIsCreated() const
+{
+    return m_pImpl->GetIsCreated();
+}
+
+bool SharedMemorySegment::GetIsLocked() const
+{
+    return m_pImpl->GetIsLocked();
+}
+
+} // namespace spvr
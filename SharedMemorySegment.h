@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) 2016
+ *  Somebody
+ */
+#ifndef SPVR_SHAREDMEMORYSEGMENT_H
+#define SPVR_SHAREDMEMORYSEGMENT_H
+
+#include <cstddef>
+#include <memory>
+
+namespace spvr
+{
+
+// Named shared memory segment, opened if it exists and created otherwise. The backend
+// is chosen at build time: windows_shared_memory on Windows, shm_open (or a file on
+// hugetlbfs with SPVR_SHM_HUGEPAGES) elsewhere. With SPVR_SHM_POPULATE the pages are
+// faulted in up front and with SPVR_SHM_LOCK they are locked into memory, so the hot
+// path never takes a page fault on the segment.
+//
+// An existing segment is mapped at its own size, which may differ from the requested
+// one, see SharedMemoryLayout.h. A POSIX segment outlives the processes that use it.
+class SharedMemorySegment final
+{
+public:
+    // throws ControlInterface::ControlInterfaceException if the segment can't be opened or created
+    SharedMemorySegment(char const *pchName, std::size_t uSize);
+    ~SharedMemorySegment();
+
+    SharedMemorySegment(SharedMemorySegment const &) = delete;
+    SharedMemorySegment &operator=(SharedMemorySegment const &) = delete;
+
+    void *GetAddress() const;
+    std::size_t GetSize() const;
+    // true if this process created the segment, its content is zero-initialized then
+    bool GetIsCreated() const;
+    // true if the pages are locked into memory
+    bool GetIsLocked() const;
+
+private:
+    class SharedMemorySegmentImpl;
+    std::unique_ptr<SharedMemorySegmentImpl> m_pImpl;
+};
+
+} // namespace spvr
+
+#endif // SPVR_SHAREDMEMORYSEGMENT_H
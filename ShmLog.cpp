@@ -0,0 +1,190 @@
+/*
+ * Copyright (c) 2016
+ *  Somebody
+ */
+#include "ShmLog.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+namespace spvr
+{
+
+namespace
+{
+
+static std::uint32_t const S_uPaddingRecord = 0xffffffffu;
+static std::uint64_t const S_uAlignment = 8u;
+
+std::uint64_t AlignUp(std::uint64_t uSize)
+{
+    return (uSize + S_uAlignment - 1u) & ~(S_uAlignment - 1u);
+}
+
+std::size_t RoundUpToPowerOfTwo(std::size_t uSize)
+{
+    std::size_t uPowerOfTwo = 64u;
+    while (uPowerOfTwo < uSize)
+    {
+        uPowerOfTwo <<= 1u;
+    }
+    return uPowerOfTwo;
+}
+
+} // unnamed namespace
+
+ShmLog::ShmLog(std::size_t uCapacity, std::ptrdiff_t iStorageOffset, Policy ePolicy):
+    m_uCapacity{RoundUpToPowerOfTwo(uCapacity)},
+    m_iStorageOffset{iStorageOffset},
+    m_ePolicy{ePolicy},
+    m_uHead{0u},
+    m_uOldest{0u},
+    m_uRejected{0u},
+    m_uNextSequence{0u},
+    m_uReadPosition{0u},
+    m_uLost{0u},
+    m_uExpectedSequence{0u}
+{
+    static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "ShmLog: 64 bit atomics must be lock-free to be shared between processes");
+}
+
+std::size_t ShmLog::GetStorageSize(std::size_t uCapacity)
+{
+    return RoundUpToPowerOfTwo(uCapacity);
+}
+
+char *ShmLog::GetStorage()
+{
+    return reinterpret_cast<char *>(this) + m_iStorageOffset;
+}
+
+char const *ShmLog::GetStorage() const
+{
+    return reinterpret_cast<char const *>(this) + m_iStorageOffset;
+}
+
+ShmLog::RecordHeader ShmLog::ReadHeader(std::uint64_t uPosition) const
+{
+    // headers are 8 byte aligned and never wrap
+    RecordHeader oHeader{};
+    std::memcpy(&oHeader, GetStorage() + (uPosition & (m_uCapacity - 1u)), sizeof(oHeader));
+    return oHeader;
+}
+
+void ShmLog::Copy(std::uint64_t uPosition, char const *pchData, std::size_t uLength)
+{
+    std::memcpy(GetStorage() + (uPosition & (m_uCapacity - 1u)), pchData, uLength);
+}
+
+bool ShmLog::Log(char const *pchMessage, std::size_t uLength)
+{
+    // a record never spans more than half the ring
+    uLength = std::min<std::size_t>(uLength, m_uCapacity / 2u - sizeof(RecordHeader));
+    auto const uRecordSize = AlignUp(sizeof(RecordHeader) + uLength);
+    auto uPosition = m_uHead.load(std::memory_order_relaxed);
+    auto const uOffset = uPosition & (m_uCapacity - 1u);
+    auto const uPadding = (uOffset + uRecordSize > m_uCapacity) ? m_uCapacity - uOffset : 0u;
+    auto const uEnd = uPosition + uPadding + uRecordSize;
+
+    if (m_ePolicy == Policy::DropNewest)
+    {
+        if (uEnd - m_uReadPosition.load(std::memory_order_acquire) > m_uCapacity)
+        {
+            m_uRejected.fetch_add(1u, std::memory_order_relaxed);
+            return false;
+        }
+    }
+    else
+    {
+        // retire the oldest records before their bytes get overwritten
+        auto uOldest = m_uOldest.load(std::memory_order_relaxed);
+        if (uEnd - uOldest > m_uCapacity)
+        {
+            while (uEnd - uOldest > m_uCapacity)
+            {
+                auto const oHeader = ReadHeader(uOldest);
+                uOldest += (oHeader.m_uLength == S_uPaddingRecord)
+                    ? m_uCapacity - (uOldest & (m_uCapacity - 1u))
+                    : AlignUp(sizeof(RecordHeader) + oHeader.m_uLength);
+            }
+            m_uOldest.store(uOldest, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+        }
+    }
+
+    if (uPadding != 0u)
+    {
+        RecordHeader const oPadding{S_uPaddingRecord, 0u};
+        Copy(uPosition, reinterpret_cast<char const *>(&oPadding), sizeof(oPadding));
+        uPosition += uPadding;
+    }
+    RecordHeader const oHeader{static_cast<std::uint32_t>(uLength), m_uNextSequence++};
+    Copy(uPosition, reinterpret_cast<char const *>(&oHeader), sizeof(oHeader));
+    Copy(uPosition + sizeof(RecordHeader), pchMessage, uLength);
+    m_uHead.store(uEnd, std::memory_order_release);
+    return true;
+}
+
+bool ShmLog::GetNext(std::string &strMsg)
+{
+    auto uPosition = m_uReadPosition.load(std::memory_order_relaxed);
+    while (true)
+    {
+        auto const uOldest = m_uOldest.load(std::memory_order_acquire);
+        uPosition = std::max(uPosition, uOldest);
+        if (uPosition == m_uHead.load(std::memory_order_acquire))
+        {
+            m_uReadPosition.store(uPosition, std::memory_order_release);
+            return false;
+        }
+
+        auto const oHeader = ReadHeader(uPosition);
+        if (oHeader.m_uLength == S_uPaddingRecord)
+        {
+            uPosition += m_uCapacity - (uPosition & (m_uCapacity - 1u));
+            continue;
+        }
+        if (oHeader.m_uLength > m_uCapacity / 2u)
+        {
+            // overwritten under our feet, resynchronize at the oldest intact record
+            continue;
+        }
+        auto const uOffset = (uPosition + sizeof(RecordHeader)) & (m_uCapacity - 1u);
+        strMsg.assign(GetStorage() + uOffset, oHeader.m_uLength);
+
+        // the copy is only valid if the producer did not retire the record meanwhile
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (m_uOldest.load(std::memory_order_relaxed) > uPosition)
+        {
+            continue;
+        }
+
+        if (oHeader.m_uSequence != m_uExpectedSequence)
+        {
+            m_uLost.fetch_add(oHeader.m_uSequence - m_uExpectedSequence, std::memory_order_relaxed);
+        }
+        m_uExpectedSequence = oHeader.m_uSequence + 1u;
+        m_uReadPosition.store(uPosition + AlignUp(sizeof(RecordHeader) + oHeader.m_uLength), std::memory_order_release);
+        return true;
+    }
+}
+
+std::string const ShmLog::GetNext()
+{
+    std::string strMsg{};
+    GetNext(strMsg);
+    return strMsg;
+}
+
+std::uint64_t ShmLog::GetDroppedCount() const
+{
+    return m_uRejected.load(std::memory_order_relaxed) + m_uLost.load(std::memory_order_relaxed);
+}
+
+std::size_t ShmLog::GetCapacity() const
+{
+    return static_cast<std::size_t>(m_uCapacity);
+}
+
+} // namespace spvr
@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2016
+ *  Somebody
+ */
+#ifndef SPVR_SHMLOG_H
+#define SPVR_SHMLOG_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace spvr
+{
+
+// Single-producer single-consumer ring of variable-length log records living in
+// shared memory, the producer (driver) and the consumer (control app) may be in
+// different processes. Nothing arbitrates between producers, the caller must make
+// sure only one process writes, see ControlInterface::SetLogProducer. The record storage follows the ShmLog object at a
+// self-relative offset so both sides can map the segment at different addresses.
+//
+// With OverwriteOldest the producer never waits for the consumer, unread records
+// are overwritten and show up in GetDroppedCount. With DropNewest a full ring
+// rejects the new record instead.
+class ShmLog final
+{
+public:
+    enum class Policy : std::uint32_t
+    {
+        OverwriteOldest = 0,
+        DropNewest = 1
+    };
+
+    // uCapacity is rounded up to a power of two, iStorageOffset is relative to this
+    ShmLog(std::size_t uCapacity, std::ptrdiff_t iStorageOffset, Policy ePolicy = Policy::OverwriteOldest);
+    ShmLog(ShmLog const &) = delete;
+    ShmLog &operator=(ShmLog const &) = delete;
+
+    static std::size_t GetStorageSize(std::size_t uCapacity);
+
+    // producer side
+    bool Log(char const *pchMessage, std::size_t uLength);
+    void Log(std::string const &strMsg)
+    {
+        Log(strMsg.data(), strMsg.size());
+    }
+
+    // consumer side, returns false if there is nothing to read
+    bool GetNext(std::string &strMsg);
+    std::string const GetNext();
+
+    // records that were never delivered, overwritten or rejected
+    std::uint64_t GetDroppedCount() const;
+    std::size_t GetCapacity() const;
+
+private:
+    struct RecordHeader
+    {
+        std::uint32_t m_uLength;
+        std::uint32_t m_uSequence;
+    };
+
+    char *GetStorage();
+    char const *GetStorage() const;
+    RecordHeader ReadHeader(std::uint64_t uPosition) const;
+    void Copy(std::uint64_t uPosition, char const *pchData, std::size_t uLength);
+
+    // written once by the creator
+    std::uint64_t m_uCapacity;
+    std::int64_t m_iStorageOffset;
+    Policy m_ePolicy;
+
+    // written by the producer only
+    alignas(64) std::atomic<std::uint64_t> m_uHead;
+    std::atomic<std::uint64_t> m_uOldest;
+    std::atomic<std::uint64_t> m_uRejected;
+    std::uint32_t m_uNextSequence;
+
+    // written by the consumer only
+    alignas(64) std::atomic<std::uint64_t> m_uReadPosition;
+    std::atomic<std::uint64_t> m_uLost;
+    std::uint32_t m_uExpectedSequence;
+};
+
+} // namespace spvr
+
+#endif // SPVR_SHMLOG_H
@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2016
+ *  Somebody
+ */
+#include "ShmNotifier.h"
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <thread>
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#endif // __linux__
+
+namespace spvr
+{
+
+namespace
+{
+
+#if defined(__linux__)
+static_assert(sizeof(std::atomic<std::uint32_t>) == sizeof(std::uint32_t), "ShmNotifier: the futex word must be a plain 32 bit integer");
+
+// not FUTEX_PRIVATE_FLAG, the word is shared between processes
+void FutexWait(std::atomic<std::uint32_t> &rWord, std::uint32_t uExpected, std::chrono::microseconds oTimeout)
+{
+    auto const oSeconds = std::chrono::duration_cast<std::chrono::seconds>(oTimeout);
+    timespec oTimespec{};
+    oTimespec.tv_sec = oSeconds.count();
+    oTimespec.tv_nsec = std::chrono::duration_cast<std::chrono::nanoseconds>(oTimeout - oSeconds).count();
+    syscall(SYS_futex, reinterpret_cast<std::uint32_t *>(&rWord), FUTEX_WAIT, uExpected, &oTimespec, nullptr, 0);
+}
+
+void FutexWakeAll(std::atomic<std::uint32_t> &rWord)
+{
+    syscall(SYS_futex, reinterpret_cast<std::uint32_t *>(&rWord), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+#else // ! __linux__
+// granularity of the polling fallback
+static auto const S_oPollInterval = std::chrono::microseconds{500};
+#endif // ! __linux__
+
+} // unnamed namespace
+
+ShmNotifier::ShmNotifier():
+    m_aGenerations{},
+    m_aWaiters{}
+{
+    static_assert(ATOMIC_INT_LOCK_FREE == 2, "ShmNotifier: 32 bit atomics must be lock-free to be shared between processes");
+}
+
+void ShmNotifier::Notify(std::uint32_t uChannel)
+{
+    auto &rGeneration = m_aGenerations[uChannel % S_uChannels];
+    // pairs with the waiter registration in Wait, either the waiter sees the new
+    // generation or we see the waiter
+    rGeneration.fetch_add(1u, std::memory_order_seq_cst);
+#if defined(__linux__)
+    if (m_aWaiters[uChannel % S_uChannels].load(std::memory_order_seq_cst) != 0u)
+    {
+        FutexWakeAll(rGeneration);
+    }
+#endif // __linux__
+}
+
+std::uint32_t ShmNotifier::GetGeneration(std::uint32_t uChannel) const
+{
+    return m_aGenerations[uChannel % S_uChannels].load(std::memory_order_acquire);
+}
+
+bool ShmNotifier::Wait(std::uint32_t uChannel, std::uint32_t uKnownGeneration, std::chrono::microseconds oTimeout)
+{
+    auto const oDeadline = std::chrono::steady_clock::now() + oTimeout;
+    while (true)
+    {
+        if (GetGeneration(uChannel) != uKnownGeneration)
+        {
+            return true;
+        }
+        auto const oRemaining = std::chrono::duration_cast<std::chrono::microseconds>(oDeadline - std::chrono::steady_clock::now());
+        if (oRemaining.count() <= 0)
+        {
+            return false;
+        }
+#if defined(__linux__)
+        auto &rWaiters = m_aWaiters[uChannel % S_uChannels];
+        rWaiters.fetch_add(1u, std::memory_order_seq_cst);
+        // sleeps only if the generation is still the known one
+        FutexWait(m_aGenerations[uChannel % S_uChannels], uKnownGeneration, oRemaining);
+        rWaiters.fetch_sub(1u, std::memory_order_relaxed);
+#else // ! __linux__
+        std::this_thread::sleep_for(std::min(oRemaining, std::chrono::duration_cast<std::chrono::microseconds>(S_oPollInterval)));
+#endif // ! __linux__
+    }
+}
+
+} // namespace spvr
@@ -0,0 +1,47 @@
+/*
+ * Copyright (c) 2016
+ *  Somebody
+ */
+#ifndef SPVR_SHMNOTIFIER_H
+#define SPVR_SHMNOTIFIER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace spvr
+{
+
+// Change notification between the processes sharing the segment. Every channel (one
+// per section id) has a generation counter that writers bump after a change, waiters
+// sleep on it as a process-shared futex word until the generation they know is outdated.
+// Notify costs an atomic increment and a load unless somebody waits on that channel, then
+// one futex wake, so a busy channel never wakes the waiters of another one. Without
+// futexes (Windows, non-Linux) Wait falls back to short sleeps.
+class ShmNotifier final
+{
+public:
+    static std::uint32_t const S_uChannels = 16u;
+
+    ShmNotifier();
+    ShmNotifier(ShmNotifier const &) = delete;
+    ShmNotifier &operator=(ShmNotifier const &) = delete;
+
+    void Notify(std::uint32_t uChannel);
+    std::uint32_t GetGeneration(std::uint32_t uChannel) const;
+    // Returns true as soon as the channel's generation differs from uKnownGeneration,
+    // false on timeout.
+    bool Wait(std::uint32_t uChannel, std::uint32_t uKnownGeneration, std::chrono::microseconds oTimeout);
+
+private:
+    // futex words, written by the notifying side
+    alignas(64) std::atomic<std::uint32_t> m_aGenerations[S_uChannels];
+    // written by the waiting side. A waiter that dies inside Wait never deregisters, its
+    // channel then costs every Notify a futex wake syscall until the driver creates the
+    // segment (and with it the notifier) again. Correctness is not affected.
+    alignas(64) std::atomic<std::uint32_t> m_aWaiters[S_uChannels];
+};
+
+} // namespace spvr
+
+#endif // SPVR_SHMNOTIFIER_H
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2016
+ *  Somebody
+ */
+#ifndef SPVR_SPVRPACKET_H
+#define SPVR_SPVRPACKET_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+namespace spvr
+{
+
+// Datagram sent by the phone app, every 4 byte field in network byte order.
+struct SpvrPacket
+{
+    float f[4];
+    std::int32_t m_iCounter;
+};
+
+union SpvrPacketByteHack
+{
+    char c[sizeof(SpvrPacket)];
+    SpvrPacket data;
+};
+
+// swaps every 4 byte field, assumes a little endian host
+inline void NtoH(SpvrPacketByteHack &packet)
+{
+    // not the way to to... UB!
+    for (std::size_t uByte = 0; uByte < sizeof(packet.c); uByte += 4)
+    {
+        std::swap(packet.c[uByte], packet.c[uByte + 3]);
+        std::swap(packet.c[uByte + 1], packet.c[uByte + 2]);
+    }
+}
+
+// Version 2 appends a magic, the sender's steady clock at send time and a device id, so
+// several simulated phones can share a port and latency can be measured from the send.
+// A version 1 driver reads the leading SpvrPacket and ignores the rest.
+struct SpvrPacketV2
+{
+    float f[4];
+    std::int32_t m_iCounter;
+    std::uint32_t m_uMagic;
+    // nanoseconds, only comparable to the driver's clock if sent from the same machine
+    std::uint64_t m_uSendTimeNs;
+    std::uint32_t m_uDeviceId;
+    std::uint32_t m_uReserved;
+};
+
+static_assert(sizeof(SpvrPacketV2) == 40, "SpvrPacketV2: the wire format has no padding");
+
+static std::uint32_t const S_uSpvrPacketV2Magic = 0x53505632u; // "SPV2"
+
+union SpvrPacketV2ByteHack
+{
+    char c[sizeof(SpvrPacketV2)];
+    SpvrPacketV2 data;
+};
+
+inline void NtoH(SpvrPacketV2ByteHack &packet)
+{
+    auto const uTimeOffset = offsetof(SpvrPacketV2, m_uSendTimeNs);
+    for (std::size_t uByte = 0; uByte < sizeof(packet.c); uByte += 4)
+    {
+        if (uByte == uTimeOffset)
+        {
+            std::reverse(packet.c + uByte, packet.c + uByte + 8);
+            uByte += 4;
+            continue;
+        }
+        std::swap(packet.c[uByte], packet.c[uByte + 3]);
+        std::swap(packet.c[uByte + 1], packet.c[uByte + 2]);
+    }
+}
+
+// the byte swaps are their own inverse
+inline void HtoN(SpvrPacketByteHack &packet)
+{
+    NtoH(packet);
+}
+
+inline void HtoN(SpvrPacketV2ByteHack &packet)
+{
+    NtoH(packet);
+}
+
+} // namespace spvr
+
+#endif // SPVR_SPVRPACKET_H
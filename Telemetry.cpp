@@ -0,0 +1,302 @@
+/*
+ * Copyright (c) 2016
+ *  Somebody
+ */
+#include "Telemetry.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+namespace spvr
+{
+
+namespace
+{
+
+// 2^S_uSubBucketBits linear buckets per power of two
+static std::uint32_t const S_uSubBucketBits = 3u;
+static std::uint32_t const S_uSubBuckets = 1u << S_uSubBucketBits;
+
+std::uint32_t FindMostSignificantBit(std::uint64_t uValue)
+{
+    std::uint32_t uBit = 0u;
+    while (uValue >>= 1u)
+    {
+        ++uBit;
+    }
+    return uBit;
+}
+
+void Increment(std::atomic<std::uint64_t> &rValue, std::uint64_t uBy)
+{
+    rValue.store(rValue.load(std::memory_order_relaxed) + uBy, std::memory_order_relaxed);
+}
+
+static char const *const S_aLatencyStageNames[] = {
+    "decode",
+    "filter",
+    "handoff",
+    "pickup",
+    "publish",
+    "end-to-end"
+};
+
+static_assert(sizeof(S_aLatencyStageNames) / sizeof(S_aLatencyStageNames[0]) == static_cast<std::size_t>(LatencyStage::Count),
+    "S_aLatencyStageNames: one name per stage");
+
+} // unnamed namespace
+
+TelemetryHistogram::TelemetryHistogram():
+    m_uCount{0u},
+    m_uSum{0u},
+    m_uMax{0u},
+    m_aBuckets{}
+{
+    static_assert((63u - S_uSubBucketBits + 1u) * S_uSubBuckets + S_uSubBuckets - 1u < S_uBuckets, "TelemetryHistogram: too few buckets");
+}
+
+std::uint32_t TelemetryHistogram::GetBucketIndex(std::uint64_t uValue)
+{
+    if (uValue < S_uSubBuckets)
+    {
+        return static_cast<std::uint32_t>(uValue);
+    }
+    auto const uExponent = FindMostSignificantBit(uValue);
+    auto const uSubBucket = static_cast<std::uint32_t>(uValue >> (uExponent - S_uSubBucketBits)) & (S_uSubBuckets - 1u);
+    return (uExponent - S_uSubBucketBits + 1u) * S_uSubBuckets + uSubBucket;
+}
+
+std::uint64_t TelemetryHistogram::GetBucketLowerBound(std::uint32_t uBucket)
+{
+    if (uBucket < S_uSubBuckets)
+    {
+        return uBucket;
+    }
+    auto const uExponent = uBucket / S_uSubBuckets + S_uSubBucketBits - 1u;
+    auto const uSubBucket = static_cast<std::uint64_t>(uBucket % S_uSubBuckets);
+    return (std::uint64_t{1u} << uExponent) + (uSubBucket << (uExponent - S_uSubBucketBits));
+}
+
+void TelemetryHistogram::Record(std::uint64_t uValue)
+{
+    Increment(m_aBuckets[GetBucketIndex(uValue)], 1u);
+    Increment(m_uSum, uValue);
+    if (uValue > m_uMax.load(std::memory_order_relaxed))
+    {
+        m_uMax.store(uValue, std::memory_order_relaxed);
+    }
+    Increment(m_uCount, 1u);
+}
+
+void TelemetryHistogram::Reset()
+{
+    for (auto &rBucket : m_aBuckets)
+    {
+        rBucket.store(0u, std::memory_order_relaxed);
+    }
+    m_uSum.store(0u, std::memory_order_relaxed);
+    m_uMax.store(0u, std::memory_order_relaxed);
+    m_uCount.store(0u, std::memory_order_relaxed);
+}
+
+std::uint64_t TelemetryHistogram::GetCount() const
+{
+    return m_uCount.load(std::memory_order_relaxed);
+}
+
+std::uint64_t TelemetryHistogram::GetSum() const
+{
+    return m_uSum.load(std::memory_order_relaxed);
+}
+
+std::uint64_t TelemetryHistogram::GetMax() const
+{
+    return m_uMax.load(std::memory_order_relaxed);
+}
+
+std::uint64_t TelemetryHistogram::GetBucket(std::uint32_t uBucket) const
+{
+    return m_aBuckets[uBucket % S_uBuckets].load(std::memory_order_relaxed);
+}
+
+std::uint64_t TelemetryHistogram::GetPercentile(double fFraction) const
+{
+    return TelemetryHistogramSnapshot{*this}.GetPercentile(fFraction);
+}
+
+TelemetryHistogramSnapshot::TelemetryHistogramSnapshot():
+    m_uCount{0u},
+    m_uSum{0u},
+    m_uMax{0u},
+    m_aBuckets{}
+{
+
+}
+
+TelemetryHistogramSnapshot::TelemetryHistogramSnapshot(TelemetryHistogram const &rHistogram):
+    m_uCount{0u},
+    m_uSum{rHistogram.GetSum()},
+    m_uMax{rHistogram.GetMax()},
+    m_aBuckets{}
+{
+    // the buckets are the source of truth, the live count may be a few updates behind
+    for (std::uint32_t i = 0; i < TelemetryHistogram::S_uBuckets; ++i)
+    {
+        m_aBuckets[i] = rHistogram.GetBucket(i);
+        m_uCount += m_aBuckets[i];
+    }
+}
+
+TelemetryHistogramSnapshot TelemetryHistogramSnapshot::Since(TelemetryHistogramSnapshot const &rEarlier) const
+{
+    TelemetryHistogramSnapshot oDifference{};
+    std::uint32_t uHighest = 0u;
+    for (std::uint32_t i = 0; i < TelemetryHistogram::S_uBuckets; ++i)
+    {
+        // a racing reader may have seen a bucket ahead of the sum, never let it wrap
+        oDifference.m_aBuckets[i] = m_aBuckets[i] - std::min(m_aBuckets[i], rEarlier.m_aBuckets[i]);
+        oDifference.m_uCount += oDifference.m_aBuckets[i];
+        if (oDifference.m_aBuckets[i] != 0u)
+        {
+            uHighest = i;
+        }
+    }
+    oDifference.m_uSum = m_uSum - std::min(m_uSum, rEarlier.m_uSum);
+    if (oDifference.m_uCount != 0u)
+    {
+        auto const uUpperBound = (uHighest + 1u < TelemetryHistogram::S_uBuckets)
+            ? TelemetryHistogram::GetBucketLowerBound(uHighest + 1u) - 1u : ~std::uint64_t{0u};
+        oDifference.m_uMax = std::min(uUpperBound, m_uMax);
+    }
+    return oDifference;
+}
+
+std::uint64_t TelemetryHistogramSnapshot::GetCount() const
+{
+    return m_uCount;
+}
+
+std::uint64_t TelemetryHistogramSnapshot::GetSum() const
+{
+    return m_uSum;
+}
+
+std::uint64_t TelemetryHistogramSnapshot::GetMax() const
+{
+    return m_uMax;
+}
+
+std::uint64_t TelemetryHistogramSnapshot::GetBucket(std::uint32_t uBucket) const
+{
+    return m_aBuckets[uBucket % TelemetryHistogram::S_uBuckets];
+}
+
+std::uint64_t TelemetryHistogramSnapshot::GetPercentile(double fFraction) const
+{
+    if (m_uCount == 0u)
+    {
+        return 0u;
+    }
+    auto const uRank = static_cast<std::uint64_t>(std::ceil(std::min(std::max(fFraction, 0.0), 1.0) * static_cast<double>(m_uCount)));
+    std::uint64_t uSeen = 0u;
+    for (std::uint32_t i = 0; i < TelemetryHistogram::S_uBuckets; ++i)
+    {
+        uSeen += m_aBuckets[i];
+        if (uSeen >= std::max<std::uint64_t>(uRank, 1u))
+        {
+            auto const uUpperBound = (i + 1u < TelemetryHistogram::S_uBuckets)
+                ? TelemetryHistogram::GetBucketLowerBound(i + 1u) - 1u : ~std::uint64_t{0u};
+            return std::min(uUpperBound, m_uMax);
+        }
+    }
+    return m_uMax;
+}
+
+char const *GetLatencyStageName(LatencyStage eStage)
+{
+    return eStage < LatencyStage::Count ? S_aLatencyStageNames[static_cast<std::uint32_t>(eStage)] : nullptr;
+}
+
+LatencyStage FindLatencyStage(char const *pchName)
+{
+    for (std::uint32_t i = 0; pchName && i < static_cast<std::uint32_t>(LatencyStage::Count); ++i)
+    {
+        if (std::strcmp(pchName, S_aLatencyStageNames[i]) == 0)
+        {
+            return static_cast<LatencyStage>(i);
+        }
+    }
+    return LatencyStage::Count;
+}
+
+Telemetry::Telemetry():
+    m_oPacketsReceived{},
+    m_oPacketsRejected{},
+    m_oSocketErrors{},
+    m_oPacketInterArrival{},
+    m_oPacketProcessing{},
+    m_oPacketTransit{},
+    m_oStageDecode{},
+    m_oStageFilter{},
+    m_oStageHandOff{},
+    m_oPosesPublished{},
+    m_oSampleAge{},
+    m_oSendToPublish{},
+    m_oStagePickup{},
+    m_oStagePublish{},
+    m_oStageEndToEnd{},
+    m_oRunFrames{},
+    m_oCommandsExecuted{},
+    m_oRunFrameInterval{},
+    m_uStartTime{0u}
+{
+
+}
+
+void Telemetry::Reset()
+{
+    m_oPacketsReceived.Reset();
+    m_oPacketsRejected.Reset();
+    m_oSocketErrors.Reset();
+    m_oPacketInterArrival.Reset();
+    m_oPacketProcessing.Reset();
+    m_oPacketTransit.Reset();
+    m_oStageDecode.Reset();
+    m_oStageFilter.Reset();
+    m_oStageHandOff.Reset();
+    m_oPosesPublished.Reset();
+    m_oSampleAge.Reset();
+    m_oSendToPublish.Reset();
+    m_oStagePickup.Reset();
+    m_oStagePublish.Reset();
+    m_oStageEndToEnd.Reset();
+    m_oRunFrames.Reset();
+    m_oCommandsExecuted.Reset();
+    m_oRunFrameInterval.Reset();
+    auto const oSinceEpoch = std::chrono::system_clock::now().time_since_epoch();
+    m_uStartTime.store(static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(oSinceEpoch).count()),
+        std::memory_order_relaxed);
+}
+
+TelemetryHistogram const &Telemetry::GetLatencyStage(LatencyStage eStage) const
+{
+    switch (eStage)
+    {
+    case LatencyStage::Decode:
+        return m_oStageDecode;
+    case LatencyStage::Filter:
+        return m_oStageFilter;
+    case LatencyStage::HandOff:
+        return m_oStageHandOff;
+    case LatencyStage::Pickup:
+        return m_oStagePickup;
+    case LatencyStage::Publish:
+        return m_oStagePublish;
+    default:
+        return m_oStageEndToEnd;
+    }
+}
+
+} // namespace spvr
@@ -0,0 +1,174 @@
+/*
+ * Copyright (c) 2016
+ *  Somebody
+ */
+#ifndef SPVR_TELEMETRY_H
+#define SPVR_TELEMETRY_H
+
+#include <atomic>
+#include <cstdint>
+
+namespace spvr
+{
+
+// Telemetry lives in the shared memory segment. Every counter and histogram has exactly
+// one writing thread, which updates it with relaxed loads and stores, no read-modify-write
+// and no fences. Readers in other processes see values that may be a few updates behind
+// and a histogram's count may briefly disagree with its buckets, which is fine for monitoring.
+
+class TelemetryCounter final
+{
+public:
+    TelemetryCounter():
+        m_uValue{0u}
+    {
+
+    }
+
+    void Add(std::uint64_t uValue = 1u)
+    {
+        m_uValue.store(m_uValue.load(std::memory_order_relaxed) + uValue, std::memory_order_relaxed);
+    }
+
+    std::uint64_t Get() const
+    {
+        return m_uValue.load(std::memory_order_relaxed);
+    }
+
+    // only while the writing thread is not running
+    void Reset()
+    {
+        m_uValue.store(0u, std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<std::uint64_t> m_uValue;
+};
+
+// Log-linear histogram of nanosecond values in the spirit of HdrHistogram: 8 linear buckets
+// per power of two, i.e. a relative bucket width of at most 12.5 %, covering the whole 64 bit
+// range in 512 buckets.
+class alignas(64) TelemetryHistogram final
+{
+public:
+    static std::uint32_t const S_uBuckets = 512u;
+
+    TelemetryHistogram();
+
+    void Record(std::uint64_t uValue);
+    // only while the writing thread is not running
+    void Reset();
+
+    std::uint64_t GetCount() const;
+    std::uint64_t GetSum() const;
+    std::uint64_t GetMax() const;
+    std::uint64_t GetBucket(std::uint32_t uBucket) const;
+    // upper bound of the bucket holding the given fraction (0 .. 1) of all values, 0 if empty
+    std::uint64_t GetPercentile(double fFraction) const;
+
+    static std::uint32_t GetBucketIndex(std::uint64_t uValue);
+    // smallest value that falls into uBucket
+    static std::uint64_t GetBucketLowerBound(std::uint32_t uBucket);
+
+private:
+    std::atomic<std::uint64_t> m_uCount;
+    std::atomic<std::uint64_t> m_uSum;
+    std::atomic<std::uint64_t> m_uMax;
+    std::atomic<std::uint64_t> m_aBuckets[S_uBuckets];
+};
+
+// Plain copy of a TelemetryHistogram, lets readers report the values recorded between two
+// points in time without resetting the live histogram, which only its writer may touch.
+class TelemetryHistogramSnapshot final
+{
+public:
+    TelemetryHistogramSnapshot();
+    explicit TelemetryHistogramSnapshot(TelemetryHistogram const &rHistogram);
+
+    // the values recorded after rEarlier was taken
+    TelemetryHistogramSnapshot Since(TelemetryHistogramSnapshot const &rEarlier) const;
+
+    std::uint64_t GetCount() const;
+    std::uint64_t GetSum() const;
+    // exact for a full snapshot, the upper bound of the highest bucket for a difference
+    std::uint64_t GetMax() const;
+    std::uint64_t GetBucket(std::uint32_t uBucket) const;
+    // see TelemetryHistogram::GetPercentile
+    std::uint64_t GetPercentile(double fFraction) const;
+
+private:
+    std::uint64_t m_uCount;
+    std::uint64_t m_uSum;
+    std::uint64_t m_uMax;
+    std::uint64_t m_aBuckets[TelemetryHistogram::S_uBuckets];
+};
+
+// The stages of a sample from the socket to SteamVR. The network thread records its stages
+// once per packet, the pose thread its stages once per sample it publishes.
+enum class LatencyStage : std::uint32_t
+{
+    // receive returned to the packet being decoded
+    Decode,
+    // decoded to the packet counter filter's decision
+    Filter,
+    // accepted to rotation and pose history being updated
+    HandOff,
+    // handed off to the pose thread picking the sample up
+    Pickup,
+    // picked up to TrackedDevicePoseUpdated returning
+    Publish,
+    // receive returned to TrackedDevicePoseUpdated returning
+    EndToEnd,
+    Count
+};
+
+// lower case, e.g. "handoff", nullptr for Count
+char const *GetLatencyStageName(LatencyStage eStage);
+// LatencyStage::Count if pchName is none of the names
+LatencyStage FindLatencyStage(char const *pchName);
+
+struct Telemetry final
+{
+    Telemetry();
+
+    // The segment outlives the driver and is reused by the next one, which calls this before
+    // its threads start so that a run does not report the packets of the previous ones.
+    void Reset();
+
+    TelemetryHistogram const &GetLatencyStage(LatencyStage eStage) const;
+
+    // written by the network thread
+    alignas(64) TelemetryCounter m_oPacketsReceived;
+    TelemetryCounter m_oPacketsRejected;
+    TelemetryCounter m_oSocketErrors;
+    TelemetryHistogram m_oPacketInterArrival;
+    TelemetryHistogram m_oPacketProcessing;
+    // receive time minus the send time of version 2 packets sent from the same machine
+    TelemetryHistogram m_oPacketTransit;
+    TelemetryHistogram m_oStageDecode;
+    TelemetryHistogram m_oStageFilter;
+    TelemetryHistogram m_oStageHandOff;
+
+    // written by the pose thread
+    alignas(64) TelemetryCounter m_oPosesPublished;
+    // time from receiving a sample to publishing it to SteamVR
+    TelemetryHistogram m_oSampleAge;
+    // send time of a version 2 packet to the first publish of its sample
+    TelemetryHistogram m_oSendToPublish;
+    TelemetryHistogram m_oStagePickup;
+    TelemetryHistogram m_oStagePublish;
+    TelemetryHistogram m_oStageEndToEnd;
+
+    // written by SmartServer::RunFrame
+    alignas(64) TelemetryCounter m_oRunFrames;
+    TelemetryCounter m_oCommandsExecuted;
+    TelemetryHistogram m_oRunFrameInterval;
+
+    // written by Reset, system clock nanoseconds since the epoch, 0 until the first Reset;
+    // readers keeping earlier values compare it to tell a restarted driver from a wrap
+    alignas(64) std::atomic<std::uint64_t> m_uStartTime;
+};
+
+} // namespace spvr
+
+#endif // SPVR_TELEMETRY_H
@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2016
+ *  Somebody
+ */
+#ifndef SPVR_TRACEFORMAT_H
+#define SPVR_TRACEFORMAT_H
+
+#include <atomic>
+#include <cstdint>
+
+namespace spvr
+{
+
+// On-disk layout of the binary trace ring, shared by the driver and spvr_trace_decode.
+// The file is a TraceFileHeader followed by m_uCapacity TraceRecords. Record i lives in
+// slot i % m_uCapacity and is complete once its m_uSequence equals (i + 1) truncated to 32 bits.
+
+enum class TraceEvent : std::uint32_t
+{
+    None = 0,
+    PacketReceived = 1,     // args: packet counter, bytes
+    PacketRejected = 2,     // args: packet counter, last accepted counter
+    PoseUpdated = 3,        // args: packet counter, processing time [ns]
+    PosePublished = 4,      // args: object id, sample age [ns], 0 before the first sample
+    RunFrame = 5,           // args: interval since last RunFrame [ns]
+    LensRebuilt = 6,        // args: parameter generation
+    SocketError = 7,
+};
+
+inline char const *GetTraceEventName(TraceEvent eEvent)
+{
+    switch (eEvent)
+    {
+    case TraceEvent::None: return "None";
+    case TraceEvent::PacketReceived: return "PacketReceived";
+    case TraceEvent::PacketRejected: return "PacketRejected";
+    case TraceEvent::PoseUpdated: return "PoseUpdated";
+    case TraceEvent::PosePublished: return "PosePublished";
+    case TraceEvent::RunFrame: return "RunFrame";
+    case TraceEvent::LensRebuilt: return "LensRebuilt";
+    case TraceEvent::SocketError: return "SocketError";
+    default: return "Unknown";
+    }
+}
+
+static char const S_aTraceMagic[8] = {'S', 'P', 'V', 'R', 'T', 'R', 'C', '1'};
+static std::uint32_t const S_uTraceVersion = 1u;
+
+struct TraceFileHeader final
+{
+    char m_aMagic[8];
+    std::uint32_t m_uVersion;
+    std::uint32_t m_uRecordSize;
+    std::uint64_t m_uCapacity;
+    // total number of records ever started, the only contended word
+    alignas(64) std::atomic<std::uint64_t> m_uNextRecord;
+    char m_aPadding[56];
+};
+
+struct TraceRecord final
+{
+    std::uint64_t m_uTimestampNs; // steady clock
+    std::atomic<std::uint32_t> m_uSequence;
+    TraceEvent m_eEvent;
+    std::int64_t m_aArgs[2];
+};
+
+static_assert(sizeof(TraceFileHeader) == 128, "TraceFileHeader: unexpected size");
+static_assert(sizeof(TraceRecord) == 32, "TraceRecord: unexpected size");
+
+} // namespace spvr
+
+#endif // SPVR_TRACEFORMAT_H
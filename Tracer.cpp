@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2016
+ *  Somebody
+ */
+#include "Tracer.h"
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+
+namespace spvr
+{
+
+namespace
+{
+
+using namespace boost::interprocess;
+
+bool CreateFileOfSize(std::string const &strFileName, std::uint64_t uSize)
+{
+    std::ofstream oFile{strFileName, std::ios::binary | std::ios::trunc};
+    if (!oFile || uSize == 0u)
+    {
+        return false;
+    }
+    oFile.seekp(static_cast<std::streamoff>(uSize - 1u));
+    oFile.put('\0');
+    return static_cast<bool>(oFile);
+}
+
+} // unnamed namespace
+
+class Tracer::TracerImpl
+{
+public:
+    TracerImpl():
+        m_oMutex{},
+        m_pFileMapping{},
+        m_pMappedRegion{}
+    {
+
+    }
+
+    TraceFileHeader *Open(std::string const &strFileName, std::uint64_t uCapacity)
+    {
+        std::lock_guard<std::mutex> oLock{m_oMutex};
+        if (m_pMappedRegion || uCapacity == 0u)
+        {
+            return nullptr;
+        }
+        uCapacity = std::min(uCapacity, Tracer::S_uMaxCapacity);
+        try
+        {
+            auto const uSize = sizeof(TraceFileHeader) + uCapacity * sizeof(TraceRecord);
+            if (!CreateFileOfSize(strFileName, uSize))
+            {
+                return nullptr;
+            }
+            m_pFileMapping = std::make_unique<file_mapping>(strFileName.c_str(), read_write);
+            m_pMappedRegion = std::make_unique<mapped_region>(*m_pFileMapping, read_write);
+            // the file is zero-filled, so all records already read as incomplete
+            auto *pHeader = new (m_pMappedRegion->get_address()) TraceFileHeader{};
+            std::memcpy(pHeader->m_aMagic, S_aTraceMagic, sizeof(S_aTraceMagic));
+            pHeader->m_uVersion = S_uTraceVersion;
+            pHeader->m_uRecordSize = sizeof(TraceRecord);
+            pHeader->m_uCapacity = uCapacity;
+            pHeader->m_uNextRecord.store(0u, std::memory_order_release);
+            return pHeader;
+        }
+        catch (...)
+        {
+            m_pMappedRegion.reset();
+            m_pFileMapping.reset();
+            return nullptr;
+        }
+    }
+
+private:
+    std::mutex m_oMutex;
+    std::unique_ptr<file_mapping> m_pFileMapping;
+    std::unique_ptr<mapped_region> m_pMappedRegion;
+};
+
+std::uint64_t const Tracer::S_uDefaultCapacity;
+std::uint64_t const Tracer::S_uMaxCapacity;
+
+Tracer::Tracer():
+    m_pImpl{std::make_unique<TracerImpl>()},
+    m_pHeader{nullptr},
+    m_pRecords{nullptr},
+    m_bEnabled{false}
+{
+
+}
+
+Tracer::~Tracer()
+{
+    m_bEnabled = false;
+}
+
+bool Tracer::Open(std::string const &strFileName, std::uint64_t uCapacity)
+{
+    auto *pHeader = m_pImpl->Open(strFileName, uCapacity);
+    if (!pHeader)
+    {
+        return false;
+    }
+    m_pRecords = reinterpret_cast<TraceRecord *>(pHeader + 1);
+    m_pHeader.store(pHeader, std::memory_order_release);
+    return true;
+}
+
+bool Tracer::GetIsOpen() const
+{
+    return m_pHeader.load(std::memory_order_acquire) != nullptr;
+}
+
+void Tracer::SetEnabled(bool bEnabled)
+{
+    m_bEnabled.store(bEnabled && GetIsOpen(), std::memory_order_relaxed);
+}
+
+bool Tracer::GetIsEnabled() const
+{
+    return m_bEnabled.load(std::memory_order_relaxed);
+}
+
+std::uint64_t Tracer::Now()
+{
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void Tracer::Write(TraceEvent eEvent, std::int64_t iArg0, std::int64_t iArg1)
+{
+    auto *pHeader = m_pHeader.load(std::memory_order_acquire);
+    if (!pHeader)
+    {
+        return;
+    }
+    auto const uIndex = pHeader->m_uNextRecord.fetch_add(1u, std::memory_order_relaxed);
+    auto &rRecord = m_pRecords[uIndex % pHeader->m_uCapacity];
+    // invalidate first, a reader must not pair the old sequence with new contents
+    rRecord.m_uSequence.store(0u, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    rRecord.m_uTimestampNs = Now();
+    rRecord.m_eEvent = eEvent;
+    rRecord.m_aArgs[0] = iArg0;
+    rRecord.m_aArgs[1] = iArg1;
+    rRecord.m_uSequence.store(static_cast<std::uint32_t>(uIndex + 1u), std::memory_order_release);
+}
+
+} // namespace spvr
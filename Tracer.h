@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2016
+ *  Somebody
+ */
+#ifndef SPVR_TRACER_H
+#define SPVR_TRACER_H
+
+#include "TraceFormat.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace spvr
+{
+
+// Writes fixed-size binary records into a memory-mapped ring file, see TraceFormat.h.
+// Record is wait-free (one atomic increment) and a no-op until Open succeeded and
+// tracing is enabled, so trace points can stay in production builds.
+class Tracer final
+{
+public:
+    // records in the ring unless the spvr/trace-records setting says otherwise
+    static std::uint64_t const S_uDefaultCapacity = 1u << 18;
+    // Open clamps the capacity to this, a 128 MB file
+    static std::uint64_t const S_uMaxCapacity = 1u << 22;
+
+    Tracer();
+    ~Tracer();
+
+    // maps (and creates or resets) the ring file, can only be done once
+    bool Open(std::string const &strFileName, std::uint64_t uCapacity);
+    bool GetIsOpen() const;
+
+    void SetEnabled(bool bEnabled);
+    bool GetIsEnabled() const;
+
+    void Record(TraceEvent eEvent, std::int64_t iArg0 = 0, std::int64_t iArg1 = 0)
+    {
+        if (m_bEnabled.load(std::memory_order_relaxed))
+        {
+            Write(eEvent, iArg0, iArg1);
+        }
+    }
+
+    // steady clock in nanoseconds, the time base of all records
+    static std::uint64_t Now();
+
+private:
+    void Write(TraceEvent eEvent, std::int64_t iArg0, std::int64_t iArg1);
+
+    class TracerImpl;
+    std::unique_ptr<TracerImpl> m_pImpl;
+    std::atomic<TraceFileHeader *> m_pHeader;
+    TraceRecord *m_pRecords;
+    std::atomic<bool> m_bEnabled;
+};
+
+} // namespace spvr
+
+#endif // SPVR_TRACER_H
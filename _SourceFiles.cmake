@@ -5,23 +5,53 @@ set(RelativeSourceGroup "src")
 set(SubDirs)
 
 set(DirFiles
+    BoundedQueue.h
+    CaptureFormat.h
     ClientProvider.cpp
     ClientProvider.h
+    CommandQueue.cpp
+    CommandQueue.h
     Context.cpp
     Context.h
     ControlInterface.cpp
     ControlInterface.h
+    DebugRequestHandler.cpp
+    DebugRequestHandler.h
+    DistortionTable.cpp
+    DistortionTable.h
+    HiddenAreaMesh.cpp
+    HiddenAreaMesh.h
     HmdDriver.cpp
     HmdDriver.h
+    LensState.cpp
+    LensState.h
     Logger.cpp
     Logger.h
+    PacketCapture.cpp
+    PacketCapture.h
+    PoseHistory.cpp
+    PoseHistory.h
     PoseUpdater.cpp
     PoseUpdater.h
+    ResponseWriter.h
     ServerProvider.cpp
     ServerProvider.h
+    SharedMemoryLayout.h
+    SharedMemorySegment.cpp
+    SharedMemorySegment.h
+    ShmLog.cpp
+    ShmLog.h
+    ShmNotifier.cpp
+    ShmNotifier.h
     smartvr.cpp
     smartvr.h
+    SpvrPacket.h
     SVRLibConfig.h
+    Telemetry.cpp
+    Telemetry.h
+    TraceFormat.h
+    Tracer.cpp
+    Tracer.h
 
     openvr_driver.h
 
@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2016
+ *  Somebody
+ */
+
+// Measures the cost of Context::GetInstance under contention, next to the
+// mutex-guarded lookup it replaced. Usage: spvr_bench_context [iterations]
+
+#include "Context.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+// the lookup as it was before, every call takes the global mutex
+class MutexSingleton final
+{
+public:
+    static MutexSingleton &GetInstance()
+    {
+        std::lock_guard<std::mutex> oLock{S_oMutex};
+        if (!S_pInstance)
+        {
+            S_pInstance.reset(new MutexSingleton{});
+        }
+        return *S_pInstance;
+    }
+
+private:
+    static std::mutex S_oMutex;
+    static std::unique_ptr<MutexSingleton> S_pInstance;
+};
+
+std::mutex MutexSingleton::S_oMutex{};
+std::unique_ptr<MutexSingleton> MutexSingleton::S_pInstance{};
+
+// returns ns per call, averaged over all threads
+template<typename Access>
+double Measure(unsigned uThreads, std::uint64_t uIterations, Access oAccess)
+{
+    std::atomic<unsigned> uReady{0u};
+    std::atomic<bool> bGo{false};
+    std::atomic<std::uintptr_t> uSink{0u};
+    std::vector<std::thread> vecThreads{};
+    for (unsigned i = 0; i < uThreads; ++i)
+    {
+        vecThreads.emplace_back([&]()
+        {
+            uReady.fetch_add(1u);
+            while (!bGo.load(std::memory_order_acquire))
+            {
+            }
+            std::uintptr_t uLocal = 0u;
+            for (std::uint64_t u = 0; u < uIterations; ++u)
+            {
+                uLocal ^= reinterpret_cast<std::uintptr_t>(&oAccess());
+            }
+            uSink.fetch_xor(uLocal);
+        });
+    }
+    while (uReady.load() != uThreads)
+    {
+    }
+    auto const oStart = std::chrono::steady_clock::now();
+    bGo.store(true, std::memory_order_release);
+    for (auto &rThread : vecThreads)
+    {
+        rThread.join();
+    }
+    auto const oElapsed = std::chrono::steady_clock::now() - oStart;
+    auto const fNs = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(oElapsed).count());
+    return fNs / static_cast<double>(uIterations);
+}
+
+} // unnamed namespace
+
+int main(int argc, char *argv[])
+{
+    std::uint64_t const uIterations = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 2000000u;
+    auto const uMaxThreads = std::max(std::thread::hardware_concurrency(), 1u);
+
+    // create both singletons outside of the measurement
+    spvr::Context::GetInstance();
+    MutexSingleton::GetInstance();
+
+    std::printf("%8s %20s %20s\n", "threads", "mutex [ns/op]", "Context [ns/op]");
+    for (unsigned uThreads = 1u; uThreads <= uMaxThreads; uThreads *= 2u)
+    {
+        auto const fMutex = Measure(uThreads, uIterations, []() -> MutexSingleton & { return MutexSingleton::GetInstance(); });
+        auto const fAtomic = Measure(uThreads, uIterations, []() -> spvr::Context & { return spvr::Context::GetInstance(); });
+        std::printf("%8u %20.2f %20.2f\n", uThreads, fMutex, fAtomic);
+    }
+
+    spvr::Context::Destroy();
+    return 0;
+}
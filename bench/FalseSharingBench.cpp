@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2016
+ *  Somebody
+ */
+
+// Two-process benchmark of the control section layout: a writer process updates the
+// pose as fast as it can while a reader process takes seqlock snapshots of the
+// parameters, once with both in the same cache line (the layout before the split) and
+// once with the pose and the parameters in cache lines of their own (ControlSection).
+// With shared lines every pose write invalidates the reader's copy of the parameters,
+// the throughput of both sides shows the coherence traffic.
+// Usage: spvr_bench_false_sharing [seconds per layout]
+
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <sched.h>
+#endif // __linux__
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <thread>
+
+namespace
+{
+
+// mirrors ControlInterface.cpp, rotation and parameters packed together
+struct PackedLayout final
+{
+    float m_aRotation[4];
+    std::atomic<std::uint32_t> m_uParameterGeneration;
+    float m_fDistortionK0;
+    float m_fDistortionK1;
+    float m_fDistortionScale;
+    float m_fHeight;
+};
+
+// mirrors ControlInterface.cpp, one cache line per writer
+struct AlignedLayout final
+{
+    alignas(64) float m_aRotation[4];
+    alignas(64) std::atomic<std::uint32_t> m_uParameterGeneration;
+    float m_fDistortionK0;
+    float m_fDistortionK1;
+    float m_fDistortionScale;
+    float m_fHeight;
+};
+
+// keeps the reader's loads alive
+static float volatile S_fSink = 0.0f;
+
+template<typename Layout>
+struct SharedBlock final
+{
+    alignas(64) Layout m_oLayout;
+    alignas(64) std::atomic<bool> m_bStart;
+    std::atomic<bool> m_bStop;
+    alignas(64) std::atomic<std::uint64_t> m_uWrites;
+    alignas(64) std::atomic<std::uint64_t> m_uReads;
+};
+
+void PinToCpu(unsigned uCpu)
+{
+#if defined(__linux__)
+    cpu_set_t oSet;
+    CPU_ZERO(&oSet);
+    CPU_SET(uCpu % std::max(std::thread::hardware_concurrency(), 1u), &oSet);
+    sched_setaffinity(0, sizeof(oSet), &oSet);
+#else
+    (void)uCpu;
+#endif
+}
+
+template<typename Layout>
+void Run(char const *pchName, std::chrono::seconds oDuration)
+{
+    auto *pMemory = mmap(nullptr, sizeof(SharedBlock<Layout>), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (pMemory == MAP_FAILED)
+    {
+        std::perror("mmap");
+        std::exit(1);
+    }
+    auto *pBlock = new (pMemory) SharedBlock<Layout>{};
+
+    auto const iWriter = fork();
+    if (iWriter == 0)
+    {
+        // the network thread
+        PinToCpu(0u);
+        auto *pRotation = static_cast<float volatile *>(pBlock->m_oLayout.m_aRotation);
+        while (!pBlock->m_bStart.load(std::memory_order_acquire))
+        {
+        }
+        std::uint64_t uWrites = 0u;
+        while (!pBlock->m_bStop.load(std::memory_order_relaxed))
+        {
+            auto const fValue = static_cast<float>(uWrites);
+            pRotation[0] = fValue;
+            pRotation[1] = fValue;
+            pRotation[2] = fValue;
+            pRotation[3] = fValue;
+            ++uWrites;
+        }
+        pBlock->m_uWrites.store(uWrites);
+        _exit(0);
+    }
+
+    // the driver reading the parameters
+    PinToCpu(1u);
+    auto &rLayout = pBlock->m_oLayout;
+    float fSink = 0.0f;
+    std::uint64_t uReads = 0u;
+    pBlock->m_bStart.store(true, std::memory_order_release);
+    auto const oEnd = std::chrono::steady_clock::now() + oDuration;
+    while ((uReads & 0xfffu) != 0u || std::chrono::steady_clock::now() < oEnd)
+    {
+        auto const uGeneration = rLayout.m_uParameterGeneration.load(std::memory_order_acquire);
+        auto const fK0 = rLayout.m_fDistortionK0;
+        auto const fK1 = rLayout.m_fDistortionK1;
+        auto const fHeight = rLayout.m_fHeight;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (rLayout.m_uParameterGeneration.load(std::memory_order_relaxed) == uGeneration)
+        {
+            fSink += fK0 + fK1 + fHeight;
+        }
+        ++uReads;
+    }
+    pBlock->m_bStop.store(true);
+    waitpid(iWriter, nullptr, 0);
+
+    auto const fSeconds = static_cast<double>(oDuration.count());
+    std::printf("%-10s %16.2f %16.2f\n", pchName,
+        static_cast<double>(pBlock->m_uWrites.load()) / fSeconds / 1e6,
+        static_cast<double>(uReads) / fSeconds / 1e6);
+    S_fSink = fSink;
+    munmap(pMemory, sizeof(SharedBlock<Layout>));
+}
+
+} // unnamed namespace
+
+int main(int argc, char *argv[])
+{
+    auto const oDuration = std::chrono::seconds{(argc > 1) ? std::atoi(argv[1]) : 2};
+    std::printf("%-10s %16s %16s\n", "layout", "writes [M/s]", "reads [M/s]");
+    Run<PackedLayout>("packed", oDuration);
+    Run<AlignedLayout>("aligned", oDuration);
+    return 0;
+}
@@ -0,0 +1,348 @@
+/*
+ * Copyright (c) 2016
+ *  Somebody
+ */
+
+// Micro benchmarks of the driver's hot paths, reports ns/op and heap allocations/op of the
+// calling thread, as a table or as JSON to keep a baseline per release.
+// Usage: bench_spvr [--json] [--min-time <ms>] [--filter <substring>]
+
+#include "Context.h"
+#include "ControlInterface.h"
+#include "HmdDriver.h"
+#include "Logger.h"
+#include "PoseUpdater.h"
+#include "SpvrPacket.h"
+
+#include "openvr_driver.h"
+
+#include "glm/gtc/quaternion.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+// allocations made by the current thread, counted by the replaced operator new below
+thread_local std::uint64_t t_uAllocations = 0u;
+
+void const *volatile S_pSink = nullptr;
+
+// keeps the compiler from dropping a result that is otherwise unused
+template<typename T>
+void Consume(T const &rValue)
+{
+    S_pSink = &rValue;
+}
+
+class BenchSettings final : public vr::IVRSettings
+{
+public:
+    virtual char const *GetSettingsErrorNameFromEnum(vr::EVRSettingsError) override { return ""; }
+    virtual bool Sync(bool, vr::EVRSettingsError *) override { return true; }
+    virtual bool GetBool(char const *, char const *, bool bDefaultValue, vr::EVRSettingsError *) override { return bDefaultValue; }
+    virtual void SetBool(char const *, char const *, bool, vr::EVRSettingsError *) override {}
+    virtual std::int32_t GetInt32(char const *, char const *, std::int32_t nDefaultValue, vr::EVRSettingsError *) override { return nDefaultValue; }
+    virtual void SetInt32(char const *, char const *, std::int32_t, vr::EVRSettingsError *) override {}
+    virtual float GetFloat(char const *, char const *, float flDefaultValue, vr::EVRSettingsError *) override { return flDefaultValue; }
+    virtual void SetFloat(char const *, char const *, float, vr::EVRSettingsError *) override {}
+    virtual void GetString(char const *, char const *, char *pchValue, std::uint32_t unValueLen, char const *, vr::EVRSettingsError *) override
+    {
+        if (pchValue && unValueLen > 0u)
+        {
+            pchValue[0] = '\0';
+        }
+    }
+    virtual void SetString(char const *, char const *, char const *, vr::EVRSettingsError *) override {}
+    virtual void RemoveSection(char const *, vr::EVRSettingsError *) override {}
+    virtual void RemoveKeyInSection(char const *, char const *, vr::EVRSettingsError *) override {}
+};
+
+// every setting at its default, every event dropped
+class BenchServerDriverHost final : public vr::IServerDriverHost
+{
+public:
+    BenchServerDriverHost():
+        m_oSettings{}
+    {
+
+    }
+
+    virtual bool TrackedDeviceAdded(char const *) override { return true; }
+    virtual void TrackedDevicePoseUpdated(std::uint32_t, vr::DriverPose_t const &) override {}
+    virtual void TrackedDevicePropertiesChanged(std::uint32_t) override {}
+    virtual void VsyncEvent(double) override {}
+    virtual void TrackedDeviceButtonPressed(std::uint32_t, vr::EVRButtonId, double) override {}
+    virtual void TrackedDeviceButtonUnpressed(std::uint32_t, vr::EVRButtonId, double) override {}
+    virtual void TrackedDeviceButtonTouched(std::uint32_t, vr::EVRButtonId, double) override {}
+    virtual void TrackedDeviceButtonUntouched(std::uint32_t, vr::EVRButtonId, double) override {}
+    virtual void TrackedDeviceAxisUpdated(std::uint32_t, std::uint32_t, vr::VRControllerAxis_t const &) override {}
+    virtual void MCImageUpdated() override {}
+    virtual vr::IVRSettings *GetSettings(char const *) override { return &m_oSettings; }
+    virtual void PhysicalIpdSet(std::uint32_t, float) override {}
+    virtual void ProximitySensorState(std::uint32_t, bool) override {}
+    virtual void VendorSpecificEvent(std::uint32_t, vr::EVREventType, vr::VREvent_Data_t const &, double) override {}
+    virtual bool IsExiting() override { return false; }
+
+private:
+    BenchSettings m_oSettings;
+};
+
+struct BenchResult final
+{
+    std::string m_strName;
+    std::uint64_t m_uIterations;
+    double m_fNsPerOp;
+    double m_fAllocsPerOp;
+};
+
+class BenchRunner final
+{
+public:
+    BenchRunner(std::chrono::milliseconds oMinTime, std::string const &strFilter):
+        m_oMinTime{oMinTime},
+        m_strFilter{strFilter},
+        m_vecResults{}
+    {
+
+    }
+
+    // grows the batch until it runs for the minimum time, then reports the median of 5 batches
+    template<typename Operation>
+    void Run(char const *pchName, Operation oOperation)
+    {
+        if (!m_strFilter.empty() && std::string{pchName}.find(m_strFilter) == std::string::npos)
+        {
+            return;
+        }
+        std::uint64_t uIterations = 16u;
+        while (Measure(uIterations, oOperation) < std::chrono::duration<double>(m_oMinTime).count() && uIterations < (1ull << 40))
+        {
+            uIterations *= 2u;
+        }
+        std::vector<double> vecNsPerOp{};
+        std::uint64_t uAllocations = 0u;
+        for (int iRepetition = 0; iRepetition < 5; ++iRepetition)
+        {
+            auto const uAllocationsBefore = t_uAllocations;
+            vecNsPerOp.push_back(Measure(uIterations, oOperation) * 1e9 / static_cast<double>(uIterations));
+            uAllocations += t_uAllocations - uAllocationsBefore;
+        }
+        std::sort(vecNsPerOp.begin(), vecNsPerOp.end());
+        m_vecResults.push_back(BenchResult{pchName, uIterations, vecNsPerOp[vecNsPerOp.size() / 2u],
+            static_cast<double>(uAllocations) / static_cast<double>(5u * uIterations)});
+    }
+
+    void PrintTable() const
+    {
+        std::printf("%-32s %14s %12s %14s\n", "benchmark", "iterations", "ns/op", "allocs/op");
+        for (auto const &rResult : m_vecResults)
+        {
+            std::printf("%-32s %14llu %12.2f %14.3f\n", rResult.m_strName.c_str(),
+                static_cast<unsigned long long>(rResult.m_uIterations), rResult.m_fNsPerOp, rResult.m_fAllocsPerOp);
+        }
+    }
+
+    void PrintJson() const
+    {
+        std::printf("{\n  \"benchmarks\": [\n");
+        for (std::size_t i = 0; i < m_vecResults.size(); ++i)
+        {
+            auto const &rResult = m_vecResults[i];
+            std::printf("    {\"name\": \"%s\", \"iterations\": %llu, \"ns_per_op\": %.3f, \"allocs_per_op\": %.3f}%s\n",
+                rResult.m_strName.c_str(), static_cast<unsigned long long>(rResult.m_uIterations),
+                rResult.m_fNsPerOp, rResult.m_fAllocsPerOp, i + 1u < m_vecResults.size() ? "," : "");
+        }
+        std::printf("  ]\n}\n");
+    }
+
+private:
+    // returns seconds
+    template<typename Operation>
+    static double Measure(std::uint64_t uIterations, Operation &oOperation)
+    {
+        auto const oStart = std::chrono::steady_clock::now();
+        for (std::uint64_t u = 0; u < uIterations; ++u)
+        {
+            oOperation();
+        }
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - oStart).count();
+    }
+
+    std::chrono::milliseconds const m_oMinTime;
+    std::string const m_strFilter;
+    std::vector<BenchResult> m_vecResults;
+};
+
+// a phone packet as it arrives on the socket, i.e. in network byte order
+void EncodePacket(std::int32_t iCounter, char (&aBuffer)[sizeof(spvr::SpvrPacket)])
+{
+    spvr::SpvrPacketByteHack oPacket;
+    oPacket.data = spvr::SpvrPacket{{1.0f, 0.0f, 0.0f, 0.0f}, iCounter};
+    spvr::NtoH(oPacket);
+    std::memcpy(aBuffer, oPacket.c, sizeof(aBuffer));
+}
+
+} // unnamed namespace
+
+void *operator new(std::size_t uSize)
+{
+    ++t_uAllocations;
+    if (void *pMemory = std::malloc(uSize ? uSize : 1u))
+    {
+        return pMemory;
+    }
+    throw std::bad_alloc{};
+}
+
+void *operator new[](std::size_t uSize)
+{
+    return operator new(uSize);
+}
+
+void operator delete(void *pMemory) noexcept
+{
+    std::free(pMemory);
+}
+
+void operator delete[](void *pMemory) noexcept
+{
+    std::free(pMemory);
+}
+
+void operator delete(void *pMemory, std::size_t) noexcept
+{
+    std::free(pMemory);
+}
+
+void operator delete[](void *pMemory, std::size_t) noexcept
+{
+    std::free(pMemory);
+}
+
+int main(int argc, char *argv[])
+{
+    bool bJson = false;
+    auto oMinTime = std::chrono::milliseconds{100};
+    std::string strFilter{};
+    for (int iArg = 1; iArg < argc; ++iArg)
+    {
+        if (std::strcmp(argv[iArg], "--json") == 0)
+        {
+            bJson = true;
+        }
+        else if (std::strcmp(argv[iArg], "--min-time") == 0 && iArg + 1 < argc)
+        {
+            oMinTime = std::chrono::milliseconds{std::strtol(argv[++iArg], nullptr, 10)};
+        }
+        else if (std::strcmp(argv[iArg], "--filter") == 0 && iArg + 1 < argc)
+        {
+            strFilter = argv[++iArg];
+        }
+        else
+        {
+            std::fprintf(stderr, "usage: %s [--json] [--min-time <ms>] [--filter <substring>]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    auto &rContext = spvr::Context::GetInstance();
+    auto &rControlInterface = rContext.GetControlInterface();
+    auto &rLogger = rContext.GetLogger();
+    BenchServerDriverHost oHost{};
+    // not activated, so the driver's own pose thread stays idle
+    auto pHmdDriver = std::make_unique<spvr::HmdDriver>(&oHost, &rLogger);
+    // a second port keeps its socket clear of the driver's own PoseUpdater
+    spvr::PoseUpdaterConfiguration oPoseUpdater{};
+    ++oPoseUpdater.m_uPort;
+    auto pPoseUpdater = std::make_unique<spvr::PoseUpdater>(rLogger, *pHmdDriver, oPoseUpdater);
+
+    BenchRunner oRunner{oMinTime, strFilter};
+
+    oRunner.Run("Context::GetInstance", []()
+    {
+        Consume(spvr::Context::GetInstance());
+    });
+
+    glm::quat const qRotation = glm::normalize(glm::quat{0.9f, 0.1f, 0.2f, 0.3f});
+    oRunner.Run("ControlInterface::SetRotation", [&]()
+    {
+        rControlInterface.SetRotation(qRotation);
+    });
+    oRunner.Run("ControlInterface::GetRotation", [&]()
+    {
+        auto const q = rControlInterface.GetRotation();
+        Consume(q);
+    });
+
+    oRunner.Run("HmdDriver::GetPose", [&]()
+    {
+        auto const oPose = pHmdDriver->GetPose();
+        Consume(oPose);
+    });
+
+    std::uint32_t uSample = 0u;
+    oRunner.Run("HmdDriver::ComputeDistortion", [&]()
+    {
+        // walks a 64 x 64 grid over both eyes so the table lookups do not stay in one cell
+        auto const fU = static_cast<float>(uSample % 64u) / 63.0f;
+        auto const fV = static_cast<float>((uSample / 64u) % 64u) / 63.0f;
+        auto const eEye = (uSample & 4096u) ? vr::Eye_Right : vr::Eye_Left;
+        ++uSample;
+        auto const oCoordinates = pHmdDriver->ComputeDistortion(eEye, fU, fV);
+        Consume(oCoordinates);
+    });
+
+    char aDatagram[sizeof(spvr::SpvrPacket)];
+    EncodePacket(1, aDatagram);
+    oRunner.Run("NtoH", [&]()
+    {
+        spvr::SpvrPacketByteHack oPacket;
+        std::memcpy(oPacket.c, aDatagram, sizeof(oPacket.c));
+        spvr::NtoH(oPacket);
+        Consume(oPacket);
+    });
+
+    std::int32_t iCounter = 0;
+    oRunner.Run("PoseUpdater::ProcessDatagram", [&]()
+    {
+        // counters only ever grow, so every packet passes the filter
+        EncodePacket(++iCounter, aDatagram);
+        Consume(pPoseUpdater->ProcessDatagram(aDatagram, sizeof(aDatagram)));
+    });
+
+    std::string const strMessage{"bench_spvr: a log line of typical length, about sixty characters\n"};
+    oRunner.Run("Logger::Log", [&]()
+    {
+        rLogger.Log(strMessage);
+    });
+    oRunner.Run("Logger::Debug", [&]()
+    {
+        rLogger.Debug(strMessage);
+    });
+
+    pPoseUpdater.reset();
+    pHmdDriver.reset();
+    rLogger.Flush();
+
+    if (bJson)
+    {
+        oRunner.PrintJson();
+    }
+    else
+    {
+        oRunner.PrintTable();
+    }
+
+    spvr::Context::Destroy();
+    return 0;
+}
@@ -0,0 +1,233 @@
+/*
+ * Copyright (c) 2016
+ *  Somebody
+ */
+
+// The steady state hot paths must not touch the heap: after a warm-up, Logger::Log,
+// HmdDriver::GetPose and PoseUpdater::ProcessDatagram are called in a loop and the heap
+// allocations of the calling thread, counted by the replaced operator new below, must stay 0.
+// Heap allocated BoundedQueues, the Logger's among them, must keep their cache line alignment.
+// Usage: spvr_test_allocations, exits non-zero if any path allocates
+
+#include "BoundedQueue.h"
+#include "Context.h"
+#include "HmdDriver.h"
+#include "Logger.h"
+#include "PoseUpdater.h"
+#include "SpvrPacket.h"
+
+#include "openvr_driver.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+// allocations made by the current thread, counted by the replaced operator new below
+thread_local std::uint64_t t_uAllocations = 0u;
+
+static std::uint32_t const S_uWarmUpCalls = 1000u;
+static std::uint32_t const S_uCalls = 100000u;
+
+void const *volatile S_pSink = nullptr;
+
+// keeps the compiler from dropping a result that is otherwise unused
+template<typename T>
+void Consume(T const &rValue)
+{
+    S_pSink = &rValue;
+}
+
+class TestSettings final : public vr::IVRSettings
+{
+public:
+    virtual char const *GetSettingsErrorNameFromEnum(vr::EVRSettingsError) override { return ""; }
+    virtual bool Sync(bool, vr::EVRSettingsError *) override { return true; }
+    virtual bool GetBool(char const *, char const *, bool bDefaultValue, vr::EVRSettingsError *) override { return bDefaultValue; }
+    virtual void SetBool(char const *, char const *, bool, vr::EVRSettingsError *) override {}
+    virtual std::int32_t GetInt32(char const *, char const *, std::int32_t nDefaultValue, vr::EVRSettingsError *) override { return nDefaultValue; }
+    virtual void SetInt32(char const *, char const *, std::int32_t, vr::EVRSettingsError *) override {}
+    virtual float GetFloat(char const *, char const *, float flDefaultValue, vr::EVRSettingsError *) override { return flDefaultValue; }
+    virtual void SetFloat(char const *, char const *, float, vr::EVRSettingsError *) override {}
+    virtual void GetString(char const *, char const *, char *pchValue, std::uint32_t unValueLen, char const *, vr::EVRSettingsError *) override
+    {
+        if (pchValue && unValueLen > 0u)
+        {
+            pchValue[0] = '\0';
+        }
+    }
+    virtual void SetString(char const *, char const *, char const *, vr::EVRSettingsError *) override {}
+    virtual void RemoveSection(char const *, vr::EVRSettingsError *) override {}
+    virtual void RemoveKeyInSection(char const *, char const *, vr::EVRSettingsError *) override {}
+};
+
+// every setting at its default, every event dropped
+class TestServerDriverHost final : public vr::IServerDriverHost
+{
+public:
+    TestServerDriverHost():
+        m_oSettings{}
+    {
+
+    }
+
+    virtual bool TrackedDeviceAdded(char const *) override { return true; }
+    virtual void TrackedDevicePoseUpdated(std::uint32_t, vr::DriverPose_t const &) override {}
+    virtual void TrackedDevicePropertiesChanged(std::uint32_t) override {}
+    virtual void VsyncEvent(double) override {}
+    virtual void TrackedDeviceButtonPressed(std::uint32_t, vr::EVRButtonId, double) override {}
+    virtual void TrackedDeviceButtonUnpressed(std::uint32_t, vr::EVRButtonId, double) override {}
+    virtual void TrackedDeviceButtonTouched(std::uint32_t, vr::EVRButtonId, double) override {}
+    virtual void TrackedDeviceButtonUntouched(std::uint32_t, vr::EVRButtonId, double) override {}
+    virtual void TrackedDeviceAxisUpdated(std::uint32_t, std::uint32_t, vr::VRControllerAxis_t const &) override {}
+    virtual void MCImageUpdated() override {}
+    virtual vr::IVRSettings *GetSettings(char const *) override { return &m_oSettings; }
+    virtual void PhysicalIpdSet(std::uint32_t, float) override {}
+    virtual void ProximitySensorState(std::uint32_t, bool) override {}
+    virtual void VendorSpecificEvent(std::uint32_t, vr::EVREventType, vr::VREvent_Data_t const &, double) override {}
+    virtual bool IsExiting() override { return false; }
+
+private:
+    TestSettings m_oSettings;
+};
+
+// a phone packet as it arrives on the socket, i.e. in network byte order
+void EncodePacket(std::int32_t iCounter, char (&aBuffer)[sizeof(spvr::SpvrPacket)])
+{
+    spvr::SpvrPacketByteHack oPacket;
+    oPacket.data = spvr::SpvrPacket{{1.0f, 0.0f, 0.0f, 0.0f}, iCounter};
+    spvr::NtoH(oPacket);
+    std::memcpy(aBuffer, oPacket.c, sizeof(aBuffer));
+}
+
+// calls oOperation S_uWarmUpCalls times, then S_uCalls times counting the allocations
+template<typename Operation>
+bool CheckNoAllocations(char const *pchName, Operation oOperation)
+{
+    for (std::uint32_t u = 0; u < S_uWarmUpCalls; ++u)
+    {
+        oOperation();
+    }
+    auto const uAllocationsBefore = t_uAllocations;
+    for (std::uint32_t u = 0; u < S_uCalls; ++u)
+    {
+        oOperation();
+    }
+    auto const uAllocations = t_uAllocations - uAllocationsBefore;
+    std::printf("%s %s: %llu allocations in %u calls\n", uAllocations == 0u ? "ok  " : "FAIL", pchName,
+        static_cast<unsigned long long>(uAllocations), S_uCalls);
+    return uAllocations == 0u;
+}
+
+// a new-expression before C++17 only guarantees alignof(std::max_align_t)
+bool CheckAlignedQueues()
+{
+    using Queue = spvr::BoundedQueue<std::uint64_t, 1024>;
+    static_assert(alignof(Queue) > alignof(std::max_align_t), "CheckAlignedQueues: the queue is not over-aligned");
+    std::vector<std::unique_ptr<Queue>> vecQueues;
+    auto bAligned = true;
+    for (std::uint32_t u = 0; u < 64u; ++u)
+    {
+        vecQueues.push_back(std::make_unique<Queue>());
+        bAligned = bAligned && reinterpret_cast<std::uintptr_t>(vecQueues.back().get()) % alignof(Queue) == 0u;
+    }
+    std::printf("%s BoundedQueue: heap instances aligned to %u bytes\n", bAligned ? "ok  " : "FAIL",
+        static_cast<unsigned>(alignof(Queue)));
+    return bAligned;
+}
+
+} // unnamed namespace
+
+void *operator new(std::size_t uSize)
+{
+    ++t_uAllocations;
+    if (void *pMemory = std::malloc(uSize ? uSize : 1u))
+    {
+        return pMemory;
+    }
+    throw std::bad_alloc{};
+}
+
+void *operator new[](std::size_t uSize)
+{
+    return operator new(uSize);
+}
+
+void operator delete(void *pMemory) noexcept
+{
+    std::free(pMemory);
+}
+
+void operator delete[](void *pMemory) noexcept
+{
+    std::free(pMemory);
+}
+
+void operator delete(void *pMemory, std::size_t) noexcept
+{
+    std::free(pMemory);
+}
+
+void operator delete[](void *pMemory, std::size_t) noexcept
+{
+    std::free(pMemory);
+}
+
+int main()
+{
+    auto bPassed = CheckAlignedQueues();
+
+    auto &rContext = spvr::Context::GetInstance();
+    auto &rLogger = rContext.GetLogger();
+    TestServerDriverHost oHost{};
+    // not activated, so the driver's own pose thread stays idle
+    auto pHmdDriver = std::make_unique<spvr::HmdDriver>(&oHost, &rLogger);
+    // a second port keeps its socket clear of the driver's own PoseUpdater
+    spvr::PoseUpdaterConfiguration oPoseUpdater{};
+    ++oPoseUpdater.m_uPort;
+    auto pPoseUpdater = std::make_unique<spvr::PoseUpdater>(rLogger, *pHmdDriver, oPoseUpdater);
+
+    std::string const strMessage{"spvr_test_allocations: a log line of typical length, about sixty characters\n"};
+    bPassed = CheckNoAllocations("Logger::Log(std::string)", [&]()
+    {
+        rLogger.Log(strMessage);
+    }) && bPassed;
+    bPassed = CheckNoAllocations("Logger::Log(LogLevel, char const *)", [&]()
+    {
+        rLogger.Log(spvr::LogLevel::Warning, strMessage.c_str());
+    }) && bPassed;
+    // a disabled level must not even build the message
+    bPassed = CheckNoAllocations("SPVR_LOG, level disabled", [&]()
+    {
+        SPVR_LOG(&rLogger, spvr::LogLevel::Debug, std::string{"never built "} + strMessage);
+    }) && bPassed;
+
+    char aDatagram[sizeof(spvr::SpvrPacket)];
+    std::int32_t iCounter = 0;
+    bPassed = CheckNoAllocations("PoseUpdater::ProcessDatagram", [&]()
+    {
+        // counters only ever grow, so every packet passes the filter
+        EncodePacket(++iCounter, aDatagram);
+        Consume(pPoseUpdater->ProcessDatagram(aDatagram, sizeof(aDatagram)));
+    }) && bPassed;
+
+    bPassed = CheckNoAllocations("HmdDriver::GetPose", [&]()
+    {
+        auto const oPose = pHmdDriver->GetPose();
+        Consume(oPose);
+    }) && bPassed;
+
+    pPoseUpdater.reset();
+    pHmdDriver.reset();
+    rLogger.Flush();
+    spvr::Context::Destroy();
+    return bPassed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
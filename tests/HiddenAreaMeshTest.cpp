@@ -0,0 +1,191 @@
+/*
+ * Copyright (c) 2016
+ *  Somebody
+ */
+
+// BuildHiddenAreaMesh against the lens model: the triangle count stays within two per
+// segment, no texel whose center the distortion samples is covered, and the texels it
+// never samples are (mostly) covered, including the render target's corners.
+// Usage: spvr_test_hidden_area_mesh, exits non-zero on the first failed case
+
+#include "DistortionTable.h"
+#include "HiddenAreaMesh.h"
+
+#include "openvr_driver.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace
+{
+
+using namespace spvr;
+
+// render target texels per axis the mesh is checked at
+static std::uint32_t const S_uTexels = 512u;
+static std::uint32_t const S_uSegmentsPerEdge = 32u;
+// a texel counts as visible if its preimage is inside the viewport by more than this,
+// in viewport uv, which absorbs the float rounding of the lens model
+static float const S_fVisibleTolerance = 1e-4f;
+
+struct TestCase final
+{
+    char const *m_pchName;
+    DistortionParameters m_oParameters;
+    // lower bound for the share of hidden texels the mesh covers
+    double m_fMinHiddenCoverage;
+};
+
+float Cross(vr::HmdVector2_t const &a, vr::HmdVector2_t const &b, float fU, float fV)
+{
+    return (b.v[0] - a.v[0]) * (fV - a.v[1]) - (b.v[1] - a.v[1]) * (fU - a.v[0]);
+}
+
+// either winding, the edges count as inside
+bool IsInTriangle(vr::HmdVector2_t const *pTriangle, float fU, float fV)
+{
+    auto const d0 = Cross(pTriangle[0], pTriangle[1], fU, fV);
+    auto const d1 = Cross(pTriangle[1], pTriangle[2], fU, fV);
+    auto const d2 = Cross(pTriangle[2], pTriangle[0], fU, fV);
+    return !((d0 < 0.0f || d1 < 0.0f || d2 < 0.0f) && (d0 > 0.0f || d1 > 0.0f || d2 > 0.0f));
+}
+
+// Preimage of a render target point under the lens model, found by bisection along the ray
+// from the lens center, returns the preimage's larger distance from the viewport's center
+// (0.5 on the viewport's border). Independent of the mesh's own ray construction.
+float GetPreimageExtent(DistortionParameters const &oParameters, SampledBounds const &oBounds, float fU, float fV)
+{
+    auto const fDistortedU = oBounds.m_fUMin + fU * (oBounds.m_fUMax - oBounds.m_fUMin) - 0.5f;
+    auto const fDistortedV = oBounds.m_fVMin + fV * (oBounds.m_fVMax - oBounds.m_fVMin) - 0.5f;
+    auto const fTarget = std::sqrt(fDistortedU * fDistortedU + fDistortedV * fDistortedV);
+    if (fTarget <= 0.0f)
+    {
+        return 0.0f;
+    }
+    auto const fDirectionU = fDistortedU / fTarget;
+    auto const fDirectionV = fDistortedV / fTarget;
+    auto fLow = 0.0f;
+    auto fHigh = 2.0f;
+    for (int i = 0; i < 40; ++i)
+    {
+        auto const fMid = 0.5f * (fLow + fHigh);
+        auto const oDistortion = ComputeRadialDistortion(oParameters, 0.5f + fDirectionU * fMid, 0.5f + fDirectionV * fMid);
+        auto const fU1 = oDistortion.rfGreen[0] - 0.5f;
+        auto const fV1 = oDistortion.rfGreen[1] - 0.5f;
+        if (std::sqrt(fU1 * fU1 + fV1 * fV1) < fTarget)
+        {
+            fLow = fMid;
+        }
+        else
+        {
+            fHigh = fMid;
+        }
+    }
+    auto const fRadius = 0.5f * (fLow + fHigh);
+    return std::max(std::fabs(fDirectionU), std::fabs(fDirectionV)) * fRadius;
+}
+
+bool Run(TestCase const &oCase)
+{
+    auto const vecMesh = BuildHiddenAreaMesh(oCase.m_oParameters, S_uSegmentsPerEdge);
+    auto const oBounds = ComputeSampledBounds(oCase.m_oParameters);
+    auto const uTriangles = vecMesh.size() / 3u;
+    auto bPassed = true;
+    if (vecMesh.size() % 3u != 0u || uTriangles > 2u * 4u * S_uSegmentsPerEdge)
+    {
+        std::printf("FAIL %s: %zu vertices, at most %u triangles expected\n", oCase.m_pchName, vecMesh.size(), 2u * 4u * S_uSegmentsPerEdge);
+        bPassed = false;
+    }
+
+    std::uint64_t uHidden = 0u;
+    std::uint64_t uHiddenCovered = 0u;
+    std::uint64_t uVisibleCovered = 0u;
+    for (std::uint32_t uY = 0; uY < S_uTexels; ++uY)
+    {
+        for (std::uint32_t uX = 0; uX < S_uTexels; ++uX)
+        {
+            auto const fU = (static_cast<float>(uX) + 0.5f) / static_cast<float>(S_uTexels);
+            auto const fV = (static_cast<float>(uY) + 0.5f) / static_cast<float>(S_uTexels);
+            auto bCovered = false;
+            for (std::size_t i = 0; i + 2u < vecMesh.size() && !bCovered; i += 3u)
+            {
+                bCovered = IsInTriangle(&vecMesh[i], fU, fV);
+            }
+            auto const fExtent = GetPreimageExtent(oCase.m_oParameters, oBounds, fU, fV);
+            if (fExtent < 0.5f - S_fVisibleTolerance)
+            {
+                uVisibleCovered += bCovered ? 1u : 0u;
+            }
+            else if (fExtent > 0.5f + S_fVisibleTolerance)
+            {
+                ++uHidden;
+                uHiddenCovered += bCovered ? 1u : 0u;
+            }
+        }
+    }
+
+    auto const fCoverage = uHidden > 0u ? static_cast<double>(uHiddenCovered) / static_cast<double>(uHidden) : 1.0;
+    if (uVisibleCovered > 0u)
+    {
+        std::printf("FAIL %s: %llu visible texels covered\n", oCase.m_pchName, static_cast<unsigned long long>(uVisibleCovered));
+        bPassed = false;
+    }
+    if (fCoverage < oCase.m_fMinHiddenCoverage)
+    {
+        std::printf("FAIL %s: %.4f of the hidden texels covered, at least %.4f expected\n", oCase.m_pchName, fCoverage, oCase.m_fMinHiddenCoverage);
+        bPassed = false;
+    }
+    std::printf("%s %s: %zu triangles, %llu hidden texels, %.4f covered\n", bPassed ? "ok  " : "FAIL",
+        oCase.m_pchName, uTriangles, static_cast<unsigned long long>(uHidden), fCoverage);
+    return bPassed;
+}
+
+} // unnamed namespace
+
+int main()
+{
+    TestCase const aCases[] = {
+        // the cardboard defaults magnify, the viewport's image covers the whole render target
+        {"cardboard", DistortionParameters{0.441f, 0.156f, 1.0f}, 1.0},
+        // the image is the render target itself
+        {"identity", DistortionParameters{0.0f, 0.0f, 1.0f}, 1.0},
+        // pincushion: the image touches the render target at its corners, the edges are hidden
+        {"pincushion", DistortionParameters{0.441f, 0.156f, 0.6f}, 0.95},
+        // barrel: the image touches the render target at the edge centers, the corners are hidden
+        {"barrel", DistortionParameters{-0.25f, 0.0f, 1.0f}, 0.95}
+    };
+
+    auto bPassed = true;
+    for (auto const &oCase : aCases)
+    {
+        bPassed = Run(oCase) && bPassed;
+    }
+
+    // the identity lens samples every texel, a mesh for it must be empty
+    if (!BuildHiddenAreaMesh(DistortionParameters{0.0f, 0.0f, 1.0f}, S_uSegmentsPerEdge).empty())
+    {
+        std::printf("FAIL identity: non-empty mesh\n");
+        bPassed = false;
+    }
+    // the corners of a barrel lens's render target are never sampled
+    auto const vecBarrel = BuildHiddenAreaMesh(DistortionParameters{-0.25f, 0.0f, 1.0f}, S_uSegmentsPerEdge);
+    for (auto const &oCorner : {std::make_pair(0.0f, 0.0f), std::make_pair(1.0f, 0.0f), std::make_pair(1.0f, 1.0f), std::make_pair(0.0f, 1.0f)})
+    {
+        auto bCovered = false;
+        for (std::size_t i = 0; i + 2u < vecBarrel.size() && !bCovered; i += 3u)
+        {
+            bCovered = IsInTriangle(&vecBarrel[i], oCorner.first, oCorner.second);
+        }
+        if (!bCovered)
+        {
+            std::printf("FAIL barrel: corner (%.0f, %.0f) not covered\n", static_cast<double>(oCorner.first),
+                static_cast<double>(oCorner.second));
+            bPassed = false;
+        }
+    }
+    return bPassed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2016
+ *  Somebody
+ */
+
+// The recommended render target size against a target pixels per degree: over the projection
+// the LensState reports, the render target must have at least the target density at the lens
+// center and one pixel less must fall below it. Without an explicit target the target is the
+// panel's density at the center, measured here independently of LensState, times the quality.
+// Usage: spvr_test_render_target_size, exits non-zero if any case fails
+
+#include "DistortionTable.h"
+#include "LensState.h"
+
+#include "openvr_driver.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+
+namespace
+{
+
+using namespace spvr;
+
+static float const S_fDegreesPerRadian = 57.2957795f;
+
+struct TestCase final
+{
+    char const *m_pchName;
+    DistortionParameters m_oParameters;
+    DisplayConfiguration m_oDisplay;
+};
+
+DisplayConfiguration MakeDisplay(std::int32_t iWidth, std::int32_t iHeight, float fRenderQuality, float fPixelsPerDegree)
+{
+    DisplayConfiguration oDisplay{};
+    oDisplay.m_iWindowWidth = iWidth;
+    oDisplay.m_iWindowHeight = iHeight;
+    oDisplay.m_fRenderQuality = fRenderQuality;
+    oDisplay.m_fPixelsPerDegree = fPixelsPerDegree;
+    return oDisplay;
+}
+
+// Panel pixels per degree at the lens center along one axis: one panel pixel spans 1 / iPixels
+// of the viewport, the lens maps it onto the nominal frustum (tangents [-1, 1] over uv [0, 1])
+// magnified by the slope of the distortion at the center.
+float MeasurePanelPixelsPerDegree(DistortionParameters const &oParameters, std::int32_t iPixels, bool bVertical)
+{
+    auto const fStep = 1e-3f;
+    auto const oLow = ComputeRadialDistortion(oParameters, bVertical ? 0.5f : 0.5f - fStep, bVertical ? 0.5f - fStep : 0.5f);
+    auto const oHigh = ComputeRadialDistortion(oParameters, bVertical ? 0.5f : 0.5f + fStep, bVertical ? 0.5f + fStep : 0.5f);
+    auto const iAxis = bVertical ? 1 : 0;
+    auto const fTangentsPerUv = 2.0f * (oHigh.rfGreen[iAxis] - oLow.rfGreen[iAxis]) / (2.0f * fStep);
+    return static_cast<float>(iPixels) / (fTangentsPerUv * S_fDegreesPerRadian);
+}
+
+// render target pixels per degree at the center of a projection spanning [fLow, fHigh] in tangents
+float GetRenderTargetPixelsPerDegree(std::uint32_t uPixels, float fLow, float fHigh)
+{
+    return static_cast<float>(uPixels) / ((fHigh - fLow) * S_fDegreesPerRadian);
+}
+
+bool CheckAxis(char const *pchName, char const *pchAxis, std::uint32_t uPixels, float fLow, float fHigh, float fTarget)
+{
+    auto const fAchieved = GetRenderTargetPixelsPerDegree(uPixels, fLow, fHigh);
+    auto const fOneLess = GetRenderTargetPixelsPerDegree(uPixels - 1u, fLow, fHigh);
+    // the lens model runs in float, allow for its rounding around the target
+    auto const fTolerance = 1e-3f * fTarget;
+    auto const bPassed = fAchieved >= fTarget - fTolerance && fOneLess < fTarget + fTolerance;
+    std::printf("%s %s %s: %u px over [%.4f, %.4f], %.3f px/deg, target %.3f\n", bPassed ? "ok  " : "FAIL",
+        pchName, pchAxis, uPixels, static_cast<double>(fLow), static_cast<double>(fHigh),
+        static_cast<double>(fAchieved), static_cast<double>(fTarget));
+    return bPassed;
+}
+
+bool Run(TestCase const &oCase)
+{
+    LensState const oState{0u, std::make_shared<DistortionTable const>(oCase.m_oParameters, 65u, ""), oCase.m_oDisplay};
+    std::uint32_t uWidth = 0u;
+    std::uint32_t uHeight = 0u;
+    oState.GetRecommendedRenderTargetSize(uWidth, uHeight);
+
+    auto fTargetU = oCase.m_oDisplay.m_fPixelsPerDegree;
+    auto fTargetV = oCase.m_oDisplay.m_fPixelsPerDegree;
+    if (fTargetU <= 0.0f)
+    {
+        fTargetU = oCase.m_oDisplay.m_fRenderQuality
+            * MeasurePanelPixelsPerDegree(oCase.m_oParameters, oCase.m_oDisplay.m_iWindowWidth / 2, false);
+        fTargetV = oCase.m_oDisplay.m_fRenderQuality
+            * MeasurePanelPixelsPerDegree(oCase.m_oParameters, oCase.m_oDisplay.m_iWindowHeight, true);
+    }
+
+    auto bPassed = uWidth > 1u && uHeight > 1u;
+    for (auto eEye : {vr::Eye_Left, vr::Eye_Right})
+    {
+        float fLeft = 0.0f;
+        float fRight = 0.0f;
+        float fTop = 0.0f;
+        float fBottom = 0.0f;
+        oState.GetProjectionRaw(eEye, fLeft, fRight, fTop, fBottom);
+        bPassed = CheckAxis(oCase.m_pchName, eEye == vr::Eye_Left ? "left u" : "right u", uWidth, fLeft, fRight, fTargetU) && bPassed;
+        bPassed = CheckAxis(oCase.m_pchName, eEye == vr::Eye_Left ? "left v" : "right v", uHeight, fTop, fBottom, fTargetV) && bPassed;
+    }
+    return bPassed;
+}
+
+} // unnamed namespace
+
+int main()
+{
+    TestCase const aCases[] = {
+        {"cardboard 1280x720", DistortionParameters{0.441f, 0.156f, 1.0f}, MakeDisplay(1280, 720, 1.0f, 0.0f)},
+        {"cardboard 1920x1080", DistortionParameters{0.441f, 0.156f, 1.0f}, MakeDisplay(1920, 1080, 1.0f, 0.0f)},
+        {"cardboard 1920x1080 quality 1.4", DistortionParameters{0.441f, 0.156f, 1.0f}, MakeDisplay(1920, 1080, 1.4f, 0.0f)},
+        {"pincushion 1280x720", DistortionParameters{0.441f, 0.156f, 0.6f}, MakeDisplay(1280, 720, 1.0f, 0.0f)},
+        {"barrel 2560x1440", DistortionParameters{-0.25f, 0.0f, 1.0f}, MakeDisplay(2560, 1440, 1.0f, 0.0f)},
+        {"cardboard 12 px/deg", DistortionParameters{0.441f, 0.156f, 1.0f}, MakeDisplay(1280, 720, 1.0f, 12.0f)},
+        {"barrel 20 px/deg", DistortionParameters{-0.25f, 0.0f, 1.0f}, MakeDisplay(1920, 1080, 2.0f, 20.0f)}
+    };
+
+    auto bPassed = true;
+    for (auto const &oCase : aCases)
+    {
+        bPassed = Run(oCase) && bPassed;
+    }
+    return bPassed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
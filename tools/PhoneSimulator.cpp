@@ -0,0 +1,427 @@
+/*
+ * Copyright (c) 2016
+ *  Somebody
+ */
+#include "SpvrPacket.h"
+
+#include <boost/asio.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Sends phone packets to the driver's port without a phone: any number of simulated
+// devices at a fixed rate, in bursts, with injected loss, reordering and jitter, following
+// a built-in or scripted head motion. Version 2 packets carry the send time, so a driver
+// on the same machine can measure the one-way latency, see Telemetry::m_oPacketTransit.
+
+namespace
+{
+
+static double const S_fPi = 3.14159265358979323846;
+
+std::uint64_t Now()
+{
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+struct Orientation final
+{
+    // degrees, yaw about y (up), pitch about x, roll about z
+    double m_fYaw;
+    double m_fPitch;
+    double m_fRoll;
+};
+
+// w, x, y, z of yaw * pitch * roll
+void ToQuaternion(Orientation const &oOrientation, float (&aQuaternion)[4])
+{
+    auto const fYaw = oOrientation.m_fYaw * S_fPi / 360.0;
+    auto const fPitch = oOrientation.m_fPitch * S_fPi / 360.0;
+    auto const fRoll = oOrientation.m_fRoll * S_fPi / 360.0;
+    auto const cy = std::cos(fYaw), sy = std::sin(fYaw);
+    auto const cp = std::cos(fPitch), sp = std::sin(fPitch);
+    auto const cr = std::cos(fRoll), sr = std::sin(fRoll);
+    aQuaternion[0] = static_cast<float>(cy * cp * cr + sy * sp * sr);
+    aQuaternion[1] = static_cast<float>(cy * sp * cr + sy * cp * sr);
+    aQuaternion[2] = static_cast<float>(sy * cp * cr - cy * sp * sr);
+    aQuaternion[3] = static_cast<float>(cy * cp * sr - sy * sp * cr);
+}
+
+// head motion over time, built in or keyframes from a file
+class Trajectory final
+{
+public:
+    explicit Trajectory(std::string const &strMotion):
+        m_strMotion{strMotion},
+        m_vecKeyTimes{},
+        m_vecKeyFrames{}
+    {
+        if (strMotion == "static" || strMotion == "yaw" || strMotion == "nod" || strMotion == "figure8")
+        {
+            return;
+        }
+        // one keyframe per line: <seconds> <yaw> <pitch> <roll>, '#' starts a comment
+        std::ifstream oFile{strMotion};
+        if (!oFile)
+        {
+            throw std::runtime_error{"unknown motion or unreadable file: " + strMotion};
+        }
+        std::string strLine{};
+        while (std::getline(oFile, strLine))
+        {
+            std::istringstream oLine{strLine.substr(0u, strLine.find('#'))};
+            double fTime = 0.0;
+            Orientation oOrientation{};
+            if (oLine >> fTime >> oOrientation.m_fYaw >> oOrientation.m_fPitch >> oOrientation.m_fRoll)
+            {
+                if (!m_vecKeyTimes.empty() && fTime <= m_vecKeyTimes.back())
+                {
+                    throw std::runtime_error{"keyframe times must increase: " + strLine};
+                }
+                m_vecKeyTimes.push_back(fTime);
+                m_vecKeyFrames.push_back(oOrientation);
+            }
+        }
+        if (m_vecKeyTimes.empty())
+        {
+            throw std::runtime_error{"no keyframes in " + strMotion};
+        }
+    }
+
+    Orientation Get(double fSeconds) const
+    {
+        if (m_strMotion == "static")
+        {
+            return Orientation{0.0, 0.0, 0.0};
+        }
+        if (m_strMotion == "yaw")
+        {
+            return Orientation{60.0 * std::sin(2.0 * S_fPi * 0.25 * fSeconds), 0.0, 0.0};
+        }
+        if (m_strMotion == "nod")
+        {
+            return Orientation{0.0, 20.0 * std::sin(2.0 * S_fPi * 0.5 * fSeconds), 0.0};
+        }
+        if (m_strMotion == "figure8")
+        {
+            return Orientation{30.0 * std::sin(2.0 * S_fPi * 0.2 * fSeconds), 15.0 * std::sin(2.0 * S_fPi * 0.4 * fSeconds), 0.0};
+        }
+        // the script loops after its last keyframe
+        auto const fLength = m_vecKeyTimes.back();
+        auto const fTime = fLength > 0.0 ? std::fmod(fSeconds, fLength) : 0.0;
+        auto const it = std::upper_bound(m_vecKeyTimes.begin(), m_vecKeyTimes.end(), fTime);
+        if (it == m_vecKeyTimes.begin())
+        {
+            return m_vecKeyFrames.front();
+        }
+        if (it == m_vecKeyTimes.end())
+        {
+            return m_vecKeyFrames.back();
+        }
+        auto const uNext = static_cast<std::size_t>(it - m_vecKeyTimes.begin());
+        auto const &rFrom = m_vecKeyFrames[uNext - 1u];
+        auto const &rTo = m_vecKeyFrames[uNext];
+        auto const f = (fTime - m_vecKeyTimes[uNext - 1u]) / (m_vecKeyTimes[uNext] - m_vecKeyTimes[uNext - 1u]);
+        return Orientation{
+            rFrom.m_fYaw + f * (rTo.m_fYaw - rFrom.m_fYaw),
+            rFrom.m_fPitch + f * (rTo.m_fPitch - rFrom.m_fPitch),
+            rFrom.m_fRoll + f * (rTo.m_fRoll - rFrom.m_fRoll)};
+    }
+
+private:
+    std::string const m_strMotion;
+    std::vector<double> m_vecKeyTimes;
+    std::vector<Orientation> m_vecKeyFrames;
+};
+
+struct Options final
+{
+    std::string m_strHost = "127.0.0.1";
+    std::uint16_t m_uPort = 4321u;
+    double m_fRate = 1000.0;
+    std::uint32_t m_uDevices = 1u;
+    double m_fDuration = 10.0;
+    int m_iFormat = 2;
+    std::uint32_t m_uBurst = 1u;
+    double m_fLoss = 0.0;
+    double m_fReorder = 0.0;
+    double m_fJitterUs = 0.0;
+    std::string m_strMotion = "figure8";
+    std::uint32_t m_uSeed = 1u;
+    bool m_bSpin = false;
+};
+
+void PrintUsage(char const *pchProgram)
+{
+    std::fprintf(stderr,
+        "usage: %s [--host <address>] [--port <port>] [--rate <Hz per device>] [--devices <n>]\n"
+        "          [--duration <s>] [--format 1|2] [--burst <packets>] [--loss <0..1>] [--reorder <0..1>]\n"
+        "          [--jitter <us>] [--motion static|yaw|nod|figure8|<keyframe file>] [--seed <n>] [--spin]\n", pchProgram);
+}
+
+bool ParseOptions(int argc, char **argv, Options &oOptions)
+{
+    for (int iArg = 1; iArg < argc; ++iArg)
+    {
+        std::string const strArg{argv[iArg]};
+        if (strArg == "--spin")
+        {
+            oOptions.m_bSpin = true;
+            continue;
+        }
+        if (iArg + 1 >= argc)
+        {
+            return false;
+        }
+        char const *pchValue = argv[++iArg];
+        if (strArg == "--host")
+        {
+            oOptions.m_strHost = pchValue;
+        }
+        else if (strArg == "--port")
+        {
+            oOptions.m_uPort = static_cast<std::uint16_t>(std::strtoul(pchValue, nullptr, 10));
+        }
+        else if (strArg == "--rate")
+        {
+            oOptions.m_fRate = std::strtod(pchValue, nullptr);
+        }
+        else if (strArg == "--devices")
+        {
+            oOptions.m_uDevices = static_cast<std::uint32_t>(std::strtoul(pchValue, nullptr, 10));
+        }
+        else if (strArg == "--duration")
+        {
+            oOptions.m_fDuration = std::strtod(pchValue, nullptr);
+        }
+        else if (strArg == "--format")
+        {
+            oOptions.m_iFormat = static_cast<int>(std::strtol(pchValue, nullptr, 10));
+        }
+        else if (strArg == "--burst")
+        {
+            oOptions.m_uBurst = static_cast<std::uint32_t>(std::strtoul(pchValue, nullptr, 10));
+        }
+        else if (strArg == "--loss")
+        {
+            oOptions.m_fLoss = std::strtod(pchValue, nullptr);
+        }
+        else if (strArg == "--reorder")
+        {
+            oOptions.m_fReorder = std::strtod(pchValue, nullptr);
+        }
+        else if (strArg == "--jitter")
+        {
+            oOptions.m_fJitterUs = std::strtod(pchValue, nullptr);
+        }
+        else if (strArg == "--motion")
+        {
+            oOptions.m_strMotion = pchValue;
+        }
+        else if (strArg == "--seed")
+        {
+            oOptions.m_uSeed = static_cast<std::uint32_t>(std::strtoul(pchValue, nullptr, 10));
+        }
+        else
+        {
+            return false;
+        }
+    }
+    return oOptions.m_fRate > 0.0 && oOptions.m_uDevices > 0u && oOptions.m_uBurst > 0u
+        && (oOptions.m_iFormat == 1 || oOptions.m_iFormat == 2);
+}
+
+// a packet ready to go out, the send time is stamped when it is actually sent
+struct PendingPacket final
+{
+    float m_aQuaternion[4];
+    std::int32_t m_iCounter;
+    std::uint32_t m_uDeviceId;
+};
+
+class Sender final
+{
+public:
+    explicit Sender(Options const &oOptions):
+        m_iFormat{oOptions.m_iFormat},
+        m_oIoService{},
+        m_oSocket{m_oIoService, boost::asio::ip::udp::endpoint{boost::asio::ip::udp::v4(), 0}},
+        m_oEndpoint{boost::asio::ip::address::from_string(oOptions.m_strHost), oOptions.m_uPort},
+        m_uSent{0u},
+        m_uErrors{0u}
+    {
+
+    }
+
+    void Send(PendingPacket const &oPending)
+    {
+        boost::system::error_code oError{};
+        if (m_iFormat == 1)
+        {
+            spvr::SpvrPacketByteHack oPacket;
+            std::copy(std::begin(oPending.m_aQuaternion), std::end(oPending.m_aQuaternion), std::begin(oPacket.data.f));
+            oPacket.data.m_iCounter = oPending.m_iCounter;
+            spvr::HtoN(oPacket);
+            m_oSocket.send_to(boost::asio::buffer(oPacket.c), m_oEndpoint, 0, oError);
+        }
+        else
+        {
+            spvr::SpvrPacketV2ByteHack oPacket;
+            std::copy(std::begin(oPending.m_aQuaternion), std::end(oPending.m_aQuaternion), std::begin(oPacket.data.f));
+            oPacket.data.m_iCounter = oPending.m_iCounter;
+            oPacket.data.m_uMagic = spvr::S_uSpvrPacketV2Magic;
+            oPacket.data.m_uDeviceId = oPending.m_uDeviceId;
+            oPacket.data.m_uReserved = 0u;
+            oPacket.data.m_uSendTimeNs = Now();
+            spvr::HtoN(oPacket);
+            m_oSocket.send_to(boost::asio::buffer(oPacket.c), m_oEndpoint, 0, oError);
+        }
+        ++(oError ? m_uErrors : m_uSent);
+    }
+
+    std::uint64_t GetSent() const
+    {
+        return m_uSent;
+    }
+
+    std::uint64_t GetErrors() const
+    {
+        return m_uErrors;
+    }
+
+private:
+    int const m_iFormat;
+    boost::asio::io_service m_oIoService;
+    boost::asio::ip::udp::socket m_oSocket;
+    boost::asio::ip::udp::endpoint const m_oEndpoint;
+    std::uint64_t m_uSent;
+    std::uint64_t m_uErrors;
+};
+
+} // unnamed namespace
+
+int main(int argc, char **argv)
+{
+    Options oOptions{};
+    if (!ParseOptions(argc, argv, oOptions))
+    {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    try
+    {
+        Trajectory const oTrajectory{oOptions.m_strMotion};
+        Sender oSender{oOptions};
+        std::mt19937 oRandom{oOptions.m_uSeed};
+        std::uniform_real_distribution<double> oUniform{0.0, 1.0};
+
+        // a burst of n packets per device every n periods keeps the average rate
+        auto const fTickSeconds = static_cast<double>(oOptions.m_uBurst) / oOptions.m_fRate;
+        auto const uTicks = static_cast<std::uint64_t>(oOptions.m_fDuration / fTickSeconds);
+        std::vector<std::int32_t> vecCounters(oOptions.m_uDevices, 0);
+        // a packet held back by the reordering is sent after the device's next one
+        std::vector<PendingPacket> vecHeld(oOptions.m_uDevices);
+        std::vector<bool> vecIsHeld(oOptions.m_uDevices, false);
+        std::vector<std::uint64_t> vecLateness{};
+        vecLateness.reserve(static_cast<std::size_t>(std::min<std::uint64_t>(uTicks, 1u << 24)));
+        std::uint64_t uLost = 0u;
+        std::uint64_t uReordered = 0u;
+
+        auto const uStart = Now();
+        for (std::uint64_t uTick = 0u; uTick < uTicks; ++uTick)
+        {
+            auto const fJitterNs = oOptions.m_fJitterUs * 1e3 * oUniform(oRandom);
+            auto const uTarget = uStart + static_cast<std::uint64_t>(static_cast<double>(uTick) * fTickSeconds * 1e9 + fJitterNs);
+            auto uNow = Now();
+            if (uTarget > uNow)
+            {
+                // sleeping is coarse, --spin busy-waits the last stretch for rates of tens of kHz
+                auto const uSpinNs = oOptions.m_bSpin ? std::uint64_t{200000u} : std::uint64_t{0u};
+                if (uTarget - uNow > uSpinNs)
+                {
+                    std::this_thread::sleep_for(std::chrono::nanoseconds{uTarget - uNow - uSpinNs});
+                }
+                while ((uNow = Now()) < uTarget)
+                {
+                }
+            }
+            if (vecLateness.size() < vecLateness.capacity())
+            {
+                vecLateness.push_back(uNow - uTarget);
+            }
+
+            auto const fSeconds = static_cast<double>(uTick) * fTickSeconds;
+            for (std::uint32_t uBurst = 0u; uBurst < oOptions.m_uBurst; ++uBurst)
+            {
+                for (std::uint32_t uDevice = 0u; uDevice < oOptions.m_uDevices; ++uDevice)
+                {
+                    PendingPacket oPending{};
+                    // the devices look around out of phase
+                    ToQuaternion(oTrajectory.Get(fSeconds + 0.37 * uDevice), oPending.m_aQuaternion);
+                    oPending.m_iCounter = vecCounters[uDevice]++;
+                    oPending.m_uDeviceId = uDevice;
+                    if (oUniform(oRandom) < oOptions.m_fLoss)
+                    {
+                        ++uLost;
+                        continue;
+                    }
+                    if (!vecIsHeld[uDevice] && oUniform(oRandom) < oOptions.m_fReorder)
+                    {
+                        vecHeld[uDevice] = oPending;
+                        vecIsHeld[uDevice] = true;
+                        ++uReordered;
+                        continue;
+                    }
+                    oSender.Send(oPending);
+                    if (vecIsHeld[uDevice])
+                    {
+                        oSender.Send(vecHeld[uDevice]);
+                        vecIsHeld[uDevice] = false;
+                    }
+                }
+            }
+        }
+        for (std::uint32_t uDevice = 0u; uDevice < oOptions.m_uDevices; ++uDevice)
+        {
+            if (vecIsHeld[uDevice])
+            {
+                oSender.Send(vecHeld[uDevice]);
+            }
+        }
+        auto const fElapsed = static_cast<double>(Now() - uStart) / 1e9;
+
+        std::sort(vecLateness.begin(), vecLateness.end());
+        auto const GetLateness = [&vecLateness](double fFraction)
+        {
+            return vecLateness.empty() ? 0.0
+                : static_cast<double>(vecLateness[static_cast<std::size_t>(fFraction * static_cast<double>(vecLateness.size() - 1u))]) / 1e3;
+        };
+        std::printf("sent %llu (%.1f /s), send errors %llu, dropped %llu, reordered %llu\n",
+            static_cast<unsigned long long>(oSender.GetSent()),
+            fElapsed > 0.0 ? static_cast<double>(oSender.GetSent()) / fElapsed : 0.0,
+            static_cast<unsigned long long>(oSender.GetErrors()),
+            static_cast<unsigned long long>(uLost),
+            static_cast<unsigned long long>(uReordered));
+        std::printf("send lateness p50 %.1f us, p99 %.1f us, max %.1f us\n", GetLateness(0.5), GetLateness(0.99), GetLateness(1.0));
+    }
+    catch (std::exception const &e)
+    {
+        std::fprintf(stderr, "spvr_phone_simulator: %s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,311 @@
+/*
+ * Copyright (c) 2016
+ *  Somebody
+ */
+#include "ControlInterface.h"
+#include "PoseHistory.h"
+#include "Telemetry.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Live view of a running driver, built in CONTROL mode. Everything it shows is read from
+// the shared memory segment: telemetry, pose history and the log ring. It never waits on
+// the notifier, a waiter would make the driver issue wake-up syscalls on every change.
+
+namespace
+{
+
+static std::atomic<bool> S_bRunning{true};
+
+void HandleSignal(int)
+{
+    S_bRunning = false;
+}
+
+void PrintUsage(char const *pchProgram)
+{
+    std::fprintf(stderr, "usage: %s [--interval <ms>] [--count <n>] [--plain]\n", pchProgram);
+}
+
+double ToMs(std::uint64_t uNanoseconds)
+{
+    return static_cast<double>(uNanoseconds) / 1e6;
+}
+
+double Rate(std::uint64_t uCount, double fSeconds)
+{
+    return fSeconds > 0.0 ? static_cast<double>(uCount) / fSeconds : 0.0;
+}
+
+void PrintHistogram(char const *pchName, spvr::TelemetryHistogramSnapshot const &rHistogram)
+{
+    if (rHistogram.GetCount() == 0u)
+    {
+        std::printf("%-22s -\n", pchName);
+        return;
+    }
+    std::printf("%-22s p50 %8.3f  p99 %8.3f  p99.9 %8.3f  max %8.3f ms  (%llu)\n", pchName,
+        ToMs(rHistogram.GetPercentile(0.5)),
+        ToMs(rHistogram.GetPercentile(0.99)),
+        ToMs(rHistogram.GetPercentile(0.999)),
+        ToMs(rHistogram.GetMax()),
+        static_cast<unsigned long long>(rHistogram.GetCount()));
+}
+
+// what the driver published up to one point in time
+struct TelemetrySnapshot final
+{
+    static std::uint32_t const S_uStages = static_cast<std::uint32_t>(spvr::LatencyStage::Count);
+
+    TelemetrySnapshot():
+        m_uStartTime{0u},
+        m_uPacketsReceived{0u},
+        m_uPacketsRejected{0u},
+        m_uSocketErrors{0u},
+        m_uPosesPublished{0u},
+        m_uRunFrames{0u},
+        m_uCommandsExecuted{0u},
+        m_oPacketInterArrival{},
+        m_oPacketProcessing{},
+        m_oPacketTransit{},
+        m_oSampleAge{},
+        m_oSendToPublish{},
+        m_oRunFrameInterval{},
+        m_aStages{}
+    {
+
+    }
+
+    explicit TelemetrySnapshot(spvr::Telemetry const &rTelemetry):
+        m_uStartTime{rTelemetry.m_uStartTime.load(std::memory_order_relaxed)},
+        m_uPacketsReceived{rTelemetry.m_oPacketsReceived.Get()},
+        m_uPacketsRejected{rTelemetry.m_oPacketsRejected.Get()},
+        m_uSocketErrors{rTelemetry.m_oSocketErrors.Get()},
+        m_uPosesPublished{rTelemetry.m_oPosesPublished.Get()},
+        m_uRunFrames{rTelemetry.m_oRunFrames.Get()},
+        m_uCommandsExecuted{rTelemetry.m_oCommandsExecuted.Get()},
+        m_oPacketInterArrival{rTelemetry.m_oPacketInterArrival},
+        m_oPacketProcessing{rTelemetry.m_oPacketProcessing},
+        m_oPacketTransit{rTelemetry.m_oPacketTransit},
+        m_oSampleAge{rTelemetry.m_oSampleAge},
+        m_oSendToPublish{rTelemetry.m_oSendToPublish},
+        m_oRunFrameInterval{rTelemetry.m_oRunFrameInterval},
+        m_aStages{}
+    {
+        for (std::uint32_t i = 0; i < S_uStages; ++i)
+        {
+            m_aStages[i] = spvr::TelemetryHistogramSnapshot{rTelemetry.GetLatencyStage(static_cast<spvr::LatencyStage>(i))};
+        }
+    }
+
+    std::uint64_t m_uStartTime;
+    std::uint64_t m_uPacketsReceived;
+    std::uint64_t m_uPacketsRejected;
+    std::uint64_t m_uSocketErrors;
+    std::uint64_t m_uPosesPublished;
+    std::uint64_t m_uRunFrames;
+    std::uint64_t m_uCommandsExecuted;
+    spvr::TelemetryHistogramSnapshot m_oPacketInterArrival;
+    spvr::TelemetryHistogramSnapshot m_oPacketProcessing;
+    spvr::TelemetryHistogramSnapshot m_oPacketTransit;
+    spvr::TelemetryHistogramSnapshot m_oSampleAge;
+    spvr::TelemetryHistogramSnapshot m_oSendToPublish;
+    spvr::TelemetryHistogramSnapshot m_oRunFrameInterval;
+    spvr::TelemetryHistogramSnapshot m_aStages[S_uStages];
+};
+
+// counts the phone's packet counter gaps in the pose history, i.e. packets lost on the way
+class LossCounter final
+{
+public:
+    LossCounter():
+        m_uCursor{0u},
+        m_aLastCounters{},
+        m_vecSamples(4096u)
+    {
+        std::fill(std::begin(m_aLastCounters), std::end(m_aLastCounters), -1);
+    }
+
+    // reads the new samples, returns the number of samples read, uMissing and uOverrun
+    // receive the counter gaps and the samples the history overwrote before they were read
+    std::uint64_t Update(spvr::ControlInterface const &rControlInterface, std::uint64_t &uMissing, std::uint64_t &uOverrun)
+    {
+        std::uint64_t uRead = 0u;
+        uMissing = 0u;
+        uOverrun = 0u;
+        for (;;)
+        {
+            std::uint64_t uLost = 0u;
+            auto const uCount = rControlInterface.ReadPoseHistory(m_uCursor, m_vecSamples.data(), m_vecSamples.size(), uLost);
+            uOverrun += uLost;
+            for (std::size_t i = 0; i < uCount; ++i)
+            {
+                auto const iCounter = m_vecSamples[i].m_iCounter;
+                // every device counts on its own, a restart below 1000 is accepted, see PoseUpdater
+                auto &rLastCounter = m_aLastCounters[m_vecSamples[i].m_uDeviceId % S_uMaxDevices];
+                if (rLastCounter >= 0 && iCounter > rLastCounter + 1 && iCounter - rLastCounter < 1000)
+                {
+                    uMissing += static_cast<std::uint64_t>(iCounter - rLastCounter - 1);
+                }
+                rLastCounter = iCounter;
+            }
+            uRead += uCount;
+            if (uCount < m_vecSamples.size())
+            {
+                return uRead;
+            }
+        }
+    }
+
+private:
+    static std::size_t const S_uMaxDevices = 16u;
+
+    std::uint64_t m_uCursor;
+    std::int32_t m_aLastCounters[S_uMaxDevices];
+    std::vector<spvr::PoseSample> m_vecSamples;
+};
+
+} // unnamed namespace
+
+int main(int argc, char **argv)
+{
+    auto oInterval = std::chrono::milliseconds{250};
+    long iCount = -1;
+    bool bPlain = false;
+    for (int iArg = 1; iArg < argc; ++iArg)
+    {
+        if (std::strcmp(argv[iArg], "--interval") == 0 && iArg + 1 < argc)
+        {
+            oInterval = std::chrono::milliseconds{std::max(10l, std::strtol(argv[++iArg], nullptr, 10))};
+        }
+        else if (std::strcmp(argv[iArg], "--count") == 0 && iArg + 1 < argc)
+        {
+            iCount = std::strtol(argv[++iArg], nullptr, 10);
+        }
+        else if (std::strcmp(argv[iArg], "--plain") == 0)
+        {
+            bPlain = true;
+        }
+        else
+        {
+            PrintUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    std::signal(SIGINT, HandleSignal);
+    std::signal(SIGTERM, HandleSignal);
+
+    try
+    {
+        spvr::ControlInterface oControlInterface{};
+        auto const *pTelemetry = oControlInterface.GetTelemetry();
+
+        LossCounter oLossCounter{};
+        std::uint64_t uIgnored = 0u;
+        // only samples that arrive from now on
+        oLossCounter.Update(oControlInterface, uIgnored, uIgnored);
+
+        TelemetrySnapshot oPrevious = pTelemetry ? TelemetrySnapshot{*pTelemetry} : TelemetrySnapshot{};
+        auto oPreviousTime = std::chrono::steady_clock::now();
+        std::string strLine{};
+        std::vector<std::string> vecLog{};
+        for (long iRefresh = 0; S_bRunning && iRefresh != iCount; ++iRefresh)
+        {
+            std::this_thread::sleep_for(oInterval);
+
+            auto const oNow = std::chrono::steady_clock::now();
+            auto const fSeconds = std::chrono::duration<double>(oNow - oPreviousTime).count();
+            oPreviousTime = oNow;
+
+            std::uint64_t uMissing = 0u;
+            std::uint64_t uOverrun = 0u;
+            auto const uSamples = oLossCounter.Update(oControlInterface, uMissing, uOverrun);
+
+            vecLog.clear();
+            while (oControlInterface.PullLog(strLine))
+            {
+                vecLog.push_back(strLine);
+            }
+
+            if (!bPlain)
+            {
+                // home and clear screen
+                std::printf("\x1b[H\x1b[2J");
+            }
+            if (pTelemetry)
+            {
+                TelemetrySnapshot const oCurrent{*pTelemetry};
+                if (oCurrent.m_uStartTime != oPrevious.m_uStartTime)
+                {
+                    // the driver restarted and reset the telemetry, everything is new
+                    oPrevious = TelemetrySnapshot{};
+                }
+                auto const uReceived = oCurrent.m_uPacketsReceived - oPrevious.m_uPacketsReceived;
+                auto const uRejected = oCurrent.m_uPacketsRejected - oPrevious.m_uPacketsRejected;
+                auto const oInterArrival = oCurrent.m_oPacketInterArrival.Since(oPrevious.m_oPacketInterArrival);
+
+                std::printf("packets   %9.1f /s  rejected %6.1f /s  lost %6.2f %%  socket errors %llu\n",
+                    Rate(uReceived, fSeconds), Rate(uRejected, fSeconds),
+                    uSamples + uMissing != 0u ? 100.0 * static_cast<double>(uMissing) / static_cast<double>(uSamples + uMissing) : 0.0,
+                    static_cast<unsigned long long>(oCurrent.m_uSocketErrors));
+                std::printf("published %9.1f /s  run frames %6.1f /s  commands %llu  history overrun %llu\n",
+                    Rate(oCurrent.m_uPosesPublished - oPrevious.m_uPosesPublished, fSeconds),
+                    Rate(oCurrent.m_uRunFrames - oPrevious.m_uRunFrames, fSeconds),
+                    static_cast<unsigned long long>(oCurrent.m_uCommandsExecuted),
+                    static_cast<unsigned long long>(uOverrun));
+                std::printf("jitter    %9.3f ms (inter-arrival p99 - p50)\n\n",
+                    ToMs(oInterArrival.GetPercentile(0.99) - std::min(oInterArrival.GetPercentile(0.5), oInterArrival.GetPercentile(0.99))));
+                PrintHistogram("packet inter-arrival", oInterArrival);
+                PrintHistogram("packet processing", oCurrent.m_oPacketProcessing.Since(oPrevious.m_oPacketProcessing));
+                PrintHistogram("packet transit", oCurrent.m_oPacketTransit.Since(oPrevious.m_oPacketTransit));
+                PrintHistogram("sample age", oCurrent.m_oSampleAge.Since(oPrevious.m_oSampleAge));
+                PrintHistogram("send to publish", oCurrent.m_oSendToPublish.Since(oPrevious.m_oSendToPublish));
+                PrintHistogram("run frame interval", oCurrent.m_oRunFrameInterval.Since(oPrevious.m_oRunFrameInterval));
+                std::printf("\nlatency by stage\n");
+                for (std::uint32_t i = 0; i < TelemetrySnapshot::S_uStages; ++i)
+                {
+                    PrintHistogram(spvr::GetLatencyStageName(static_cast<spvr::LatencyStage>(i)), oCurrent.m_aStages[i].Since(oPrevious.m_aStages[i]));
+                }
+                oPrevious = oCurrent;
+            }
+            else
+            {
+                std::printf("the driver's segment has no telemetry, samples %.1f /s, lost %llu\n",
+                    Rate(uSamples, fSeconds), static_cast<unsigned long long>(uMissing));
+            }
+            std::printf("\nlog (%llu lines dropped)\n", static_cast<unsigned long long>(oControlInterface.GetLogDroppedCount()));
+            for (auto const &rLine : vecLog)
+            {
+                std::printf("%s", rLine.c_str());
+                if (rLine.empty() || rLine.back() != '\n')
+                {
+                    std::printf("\n");
+                }
+            }
+            std::fflush(stdout);
+        }
+    }
+    catch (std::exception const &e)
+    {
+        std::fprintf(stderr, "spvr_top: %s\n", e.what());
+        return 1;
+    }
+    catch (...)
+    {
+        std::fprintf(stderr, "spvr_top: could not attach to the shared memory segment\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,614 @@
+/*
+ * Copyright (c) 2016
+ *  Somebody
+ */
+#include "openvr_driver.h"
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif // WIN32_LEAN_AND_MEAN
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif // NOMINMAX
+#include <Windows.h>
+#else // ! _WIN32
+#include <dlfcn.h>
+#endif // ! _WIN32
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Loads driver_spvr through HmdDriverFactory like vrserver does and hosts it without
+// SteamVR: in-process IServerDriverHost, IClientDriverHost and IVRSettings, RunFrame at a
+// fixed rate and a timestamp for every TrackedDevicePoseUpdated call.
+
+#if !defined(SPVR_TEST_HOST_DRIVER)
+#if defined(_WIN32)
+#define SPVR_TEST_HOST_DRIVER "driver_spvr.dll"
+#else // ! _WIN32
+#define SPVR_TEST_HOST_DRIVER "./libdriver_spvr.so"
+#endif // ! _WIN32
+#endif // ! SPVR_TEST_HOST_DRIVER
+
+namespace
+{
+
+using HmdDriverFactoryFn = void *(*)(char const *, int *);
+
+std::uint64_t Now()
+{
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+class DriverLibrary final
+{
+public:
+    explicit DriverLibrary(std::string const &strPath):
+        m_pHandle{}
+    {
+#if defined(_WIN32)
+        m_pHandle = ::LoadLibraryA(strPath.c_str());
+#else // ! _WIN32
+        m_pHandle = ::dlopen(strPath.c_str(), RTLD_NOW | RTLD_LOCAL);
+#endif // ! _WIN32
+        if (!m_pHandle)
+        {
+            throw std::runtime_error{"could not load " + strPath};
+        }
+    }
+
+    ~DriverLibrary()
+    {
+#if defined(_WIN32)
+        ::FreeLibrary(static_cast<HMODULE>(m_pHandle));
+#else // ! _WIN32
+        ::dlclose(m_pHandle);
+#endif // ! _WIN32
+    }
+
+    DriverLibrary(DriverLibrary const &) = delete;
+    DriverLibrary &operator=(DriverLibrary const &) = delete;
+
+    HmdDriverFactoryFn GetFactory() const
+    {
+#if defined(_WIN32)
+        auto const pSymbol = ::GetProcAddress(static_cast<HMODULE>(m_pHandle), "HmdDriverFactory");
+#else // ! _WIN32
+        auto const pSymbol = ::dlsym(m_pHandle, "HmdDriverFactory");
+#endif // ! _WIN32
+        if (!pSymbol)
+        {
+            throw std::runtime_error{"the library does not export HmdDriverFactory"};
+        }
+        return reinterpret_cast<HmdDriverFactoryFn>(pSymbol);
+    }
+
+private:
+    void *m_pHandle;
+};
+
+class TestDriverLog final : public vr::IDriverLog
+{
+public:
+    explicit TestDriverLog(bool bVerbose):
+        m_bVerbose{bVerbose}
+    {
+
+    }
+
+    virtual void Log(char const *pchLogMessage) override
+    {
+        if (m_bVerbose && pchLogMessage)
+        {
+            std::fprintf(stderr, "%s", pchLogMessage);
+        }
+    }
+
+private:
+    bool const m_bVerbose;
+};
+
+// values from --set section/key=value, everything else returns the caller's default
+class TestSettings final : public vr::IVRSettings
+{
+public:
+    TestSettings():
+        m_oMutex{},
+        m_mapValues{}
+    {
+
+    }
+
+    void Set(std::string const &strSection, std::string const &strKey, std::string const &strValue)
+    {
+        std::lock_guard<std::mutex> oLock{m_oMutex};
+        m_mapValues[strSection + "/" + strKey] = strValue;
+    }
+
+    virtual char const *GetSettingsErrorNameFromEnum(vr::EVRSettingsError eError) override
+    {
+        return eError == vr::VRSettingsError_None ? "None" : "Error";
+    }
+
+    virtual bool Sync(bool, vr::EVRSettingsError *peError) override
+    {
+        SetError(peError);
+        return true;
+    }
+
+    virtual bool GetBool(char const *pchSection, char const *pchSettingsKey, bool bDefaultValue, vr::EVRSettingsError *peError) override
+    {
+        std::string strValue{};
+        return Find(pchSection, pchSettingsKey, strValue, peError) ? (strValue == "true" || strValue == "1") : bDefaultValue;
+    }
+
+    virtual void SetBool(char const *pchSection, char const *pchSettingsKey, bool bValue, vr::EVRSettingsError *peError) override
+    {
+        Set(pchSection, pchSettingsKey, bValue ? "true" : "false");
+        SetError(peError);
+    }
+
+    virtual std::int32_t GetInt32(char const *pchSection, char const *pchSettingsKey, std::int32_t nDefaultValue, vr::EVRSettingsError *peError) override
+    {
+        std::string strValue{};
+        return Find(pchSection, pchSettingsKey, strValue, peError) ? static_cast<std::int32_t>(std::strtol(strValue.c_str(), nullptr, 0)) : nDefaultValue;
+    }
+
+    virtual void SetInt32(char const *pchSection, char const *pchSettingsKey, std::int32_t nValue, vr::EVRSettingsError *peError) override
+    {
+        Set(pchSection, pchSettingsKey, std::to_string(nValue));
+        SetError(peError);
+    }
+
+    virtual float GetFloat(char const *pchSection, char const *pchSettingsKey, float flDefaultValue, vr::EVRSettingsError *peError) override
+    {
+        std::string strValue{};
+        return Find(pchSection, pchSettingsKey, strValue, peError) ? std::strtof(strValue.c_str(), nullptr) : flDefaultValue;
+    }
+
+    virtual void SetFloat(char const *pchSection, char const *pchSettingsKey, float flValue, vr::EVRSettingsError *peError) override
+    {
+        Set(pchSection, pchSettingsKey, std::to_string(flValue));
+        SetError(peError);
+    }
+
+    virtual void GetString(char const *pchSection, char const *pchSettingsKey, char *pchValue, std::uint32_t unValueLen, char const *pchDefaultValue, vr::EVRSettingsError *peError) override
+    {
+        std::string strValue{pchDefaultValue ? pchDefaultValue : ""};
+        Find(pchSection, pchSettingsKey, strValue, peError);
+        if (pchValue && unValueLen > 0u)
+        {
+            auto const uLength = std::min<std::size_t>(strValue.size(), unValueLen - 1u);
+            std::memcpy(pchValue, strValue.data(), uLength);
+            pchValue[uLength] = '\0';
+        }
+    }
+
+    virtual void SetString(char const *pchSection, char const *pchSettingsKey, char const *pchValue, vr::EVRSettingsError *peError) override
+    {
+        Set(pchSection, pchSettingsKey, pchValue ? pchValue : "");
+        SetError(peError);
+    }
+
+    virtual void RemoveSection(char const *pchSection, vr::EVRSettingsError *peError) override
+    {
+        std::lock_guard<std::mutex> oLock{m_oMutex};
+        std::string const strPrefix = std::string{pchSection} + "/";
+        for (auto it = m_mapValues.begin(); it != m_mapValues.end();)
+        {
+            it = it->first.compare(0u, strPrefix.size(), strPrefix) == 0 ? m_mapValues.erase(it) : std::next(it);
+        }
+        SetError(peError);
+    }
+
+    virtual void RemoveKeyInSection(char const *pchSection, char const *pchSettingsKey, vr::EVRSettingsError *peError) override
+    {
+        std::lock_guard<std::mutex> oLock{m_oMutex};
+        m_mapValues.erase(std::string{pchSection} + "/" + pchSettingsKey);
+        SetError(peError);
+    }
+
+private:
+    static void SetError(vr::EVRSettingsError *peError)
+    {
+        if (peError)
+        {
+            *peError = vr::VRSettingsError_None;
+        }
+    }
+
+    bool Find(char const *pchSection, char const *pchSettingsKey, std::string &strValue, vr::EVRSettingsError *peError)
+    {
+        SetError(peError);
+        std::lock_guard<std::mutex> oLock{m_oMutex};
+        auto const it = m_mapValues.find(std::string{pchSection} + "/" + pchSettingsKey);
+        if (it == m_mapValues.end())
+        {
+            return false;
+        }
+        strValue = it->second;
+        return true;
+    }
+
+    std::mutex m_oMutex;
+    std::map<std::string, std::string> m_mapValues;
+};
+
+struct PoseUpdate final
+{
+    std::uint64_t m_uTimestampNs;
+    std::uint32_t m_uDevice;
+    bool m_bPoseIsValid;
+};
+
+// Records every pose update into a preallocated buffer, the driver calls it from its pose
+// thread and from RunFrame concurrently, so a slot is claimed with a single fetch_add.
+class TestServerDriverHost final : public vr::IServerDriverHost
+{
+public:
+    TestServerDriverHost(TestSettings &rSettings, std::size_t uMaxUpdates):
+        m_rSettings(rSettings),
+        m_vecUpdates(uMaxUpdates),
+        m_uNextUpdate{0u},
+        m_uDevicesAdded{0u},
+        m_uPropertiesChanged{0u},
+        m_bIsExiting{false}
+    {
+
+    }
+
+    virtual bool TrackedDeviceAdded(char const *) override
+    {
+        m_uDevicesAdded.fetch_add(1u);
+        return true;
+    }
+
+    virtual void TrackedDevicePoseUpdated(std::uint32_t unWhichDevice, vr::DriverPose_t const &newPose) override
+    {
+        auto const uTimestamp = Now();
+        auto const uIndex = m_uNextUpdate.fetch_add(1u, std::memory_order_relaxed);
+        if (uIndex < m_vecUpdates.size())
+        {
+            m_vecUpdates[uIndex] = PoseUpdate{uTimestamp, unWhichDevice, newPose.poseIsValid};
+        }
+    }
+
+    virtual void TrackedDevicePropertiesChanged(std::uint32_t) override
+    {
+        m_uPropertiesChanged.fetch_add(1u);
+    }
+
+    virtual void VsyncEvent(double) override {}
+    virtual void TrackedDeviceButtonPressed(std::uint32_t, vr::EVRButtonId, double) override {}
+    virtual void TrackedDeviceButtonUnpressed(std::uint32_t, vr::EVRButtonId, double) override {}
+    virtual void TrackedDeviceButtonTouched(std::uint32_t, vr::EVRButtonId, double) override {}
+    virtual void TrackedDeviceButtonUntouched(std::uint32_t, vr::EVRButtonId, double) override {}
+    virtual void TrackedDeviceAxisUpdated(std::uint32_t, std::uint32_t, vr::VRControllerAxis_t const &) override {}
+    virtual void MCImageUpdated() override {}
+
+    virtual vr::IVRSettings *GetSettings(char const *pchInterfaceVersion) override
+    {
+        return std::strcmp(pchInterfaceVersion, vr::IVRSettings_Version) == 0 ? &m_rSettings : nullptr;
+    }
+
+    virtual void PhysicalIpdSet(std::uint32_t, float) override {}
+    virtual void ProximitySensorState(std::uint32_t, bool) override {}
+    virtual void VendorSpecificEvent(std::uint32_t, vr::EVREventType, vr::VREvent_Data_t const &, double) override {}
+
+    virtual bool IsExiting() override
+    {
+        return m_bIsExiting;
+    }
+
+    void SetIsExiting()
+    {
+        m_bIsExiting = true;
+    }
+
+    // only valid once the driver stopped publishing
+    std::vector<PoseUpdate> GetUpdates() const
+    {
+        auto const uCount = std::min<std::size_t>(m_uNextUpdate.load(), m_vecUpdates.size());
+        return std::vector<PoseUpdate>{m_vecUpdates.begin(), m_vecUpdates.begin() + static_cast<std::ptrdiff_t>(uCount)};
+    }
+
+    // updates that did not fit into the buffer
+    std::uint64_t GetOverflowCount() const
+    {
+        auto const uCount = m_uNextUpdate.load();
+        return uCount > m_vecUpdates.size() ? uCount - m_vecUpdates.size() : 0u;
+    }
+
+    std::uint32_t GetDevicesAdded() const
+    {
+        return m_uDevicesAdded.load();
+    }
+
+    std::uint32_t GetPropertiesChanged() const
+    {
+        return m_uPropertiesChanged.load();
+    }
+
+private:
+    TestSettings &m_rSettings;
+    std::vector<PoseUpdate> m_vecUpdates;
+    std::atomic<std::uint64_t> m_uNextUpdate;
+    std::atomic<std::uint32_t> m_uDevicesAdded;
+    std::atomic<std::uint32_t> m_uPropertiesChanged;
+    std::atomic<bool> m_bIsExiting;
+};
+
+class TestClientDriverHost final : public vr::IClientDriverHost
+{
+public:
+    explicit TestClientDriverHost(TestSettings &rSettings):
+        m_rSettings(rSettings)
+    {
+
+    }
+
+    virtual vr::ETrackedDeviceClass GetTrackedDeviceClass(vr::TrackedDeviceIndex_t unDeviceIndex) override
+    {
+        return unDeviceIndex == vr::k_unTrackedDeviceIndex_Hmd ? vr::TrackedDeviceClass_HMD : vr::TrackedDeviceClass_Invalid;
+    }
+
+    virtual bool IsTrackedDeviceConnected(vr::TrackedDeviceIndex_t unDeviceIndex) override
+    {
+        return unDeviceIndex == vr::k_unTrackedDeviceIndex_Hmd;
+    }
+
+    virtual bool GetBoolTrackedDeviceProperty(vr::TrackedDeviceIndex_t, vr::ETrackedDeviceProperty, vr::ETrackedPropertyError *pError) override
+    {
+        return Unknown(pError, false);
+    }
+
+    virtual float GetFloatTrackedDeviceProperty(vr::TrackedDeviceIndex_t, vr::ETrackedDeviceProperty, vr::ETrackedPropertyError *pError) override
+    {
+        return Unknown(pError, 0.0f);
+    }
+
+    virtual std::int32_t GetInt32TrackedDeviceProperty(vr::TrackedDeviceIndex_t, vr::ETrackedDeviceProperty, vr::ETrackedPropertyError *pError) override
+    {
+        return Unknown(pError, 0);
+    }
+
+    virtual std::uint64_t GetUint64TrackedDeviceProperty(vr::TrackedDeviceIndex_t, vr::ETrackedDeviceProperty, vr::ETrackedPropertyError *pError) override
+    {
+        return Unknown(pError, std::uint64_t{0u});
+    }
+
+    virtual std::uint32_t GetStringTrackedDeviceProperty(vr::TrackedDeviceIndex_t, vr::ETrackedDeviceProperty, char *pchValue, std::uint32_t unBufferSize, vr::ETrackedPropertyError *pError) override
+    {
+        if (pchValue && unBufferSize > 0u)
+        {
+            pchValue[0] = '\0';
+        }
+        return Unknown(pError, 0u);
+    }
+
+    virtual vr::IVRSettings *GetSettings(char const *pchInterfaceVersion) override
+    {
+        return std::strcmp(pchInterfaceVersion, vr::IVRSettings_Version) == 0 ? &m_rSettings : nullptr;
+    }
+
+private:
+    template <typename T>
+    static T Unknown(vr::ETrackedPropertyError *pError, T oValue)
+    {
+        if (pError)
+        {
+            *pError = vr::TrackedProp_UnknownProperty;
+        }
+        return oValue;
+    }
+
+    TestSettings &m_rSettings;
+};
+
+std::uint64_t GetPercentile(std::vector<std::uint64_t> const &vecSorted, double fFraction)
+{
+    if (vecSorted.empty())
+    {
+        return 0u;
+    }
+    auto const uIndex = static_cast<std::size_t>(fFraction * static_cast<double>(vecSorted.size() - 1u) + 0.5);
+    return vecSorted[std::min(uIndex, vecSorted.size() - 1u)];
+}
+
+void PrintDistribution(char const *pchName, std::vector<std::uint64_t> &vecValues)
+{
+    std::sort(vecValues.begin(), vecValues.end());
+    std::printf("%-20s n %8llu  p50 %9.3f  p99 %9.3f  p99.9 %9.3f  max %9.3f us\n", pchName,
+        static_cast<unsigned long long>(vecValues.size()),
+        static_cast<double>(GetPercentile(vecValues, 0.5)) / 1e3,
+        static_cast<double>(GetPercentile(vecValues, 0.99)) / 1e3,
+        static_cast<double>(GetPercentile(vecValues, 0.999)) / 1e3,
+        static_cast<double>(vecValues.empty() ? 0u : vecValues.back()) / 1e3);
+}
+
+void PrintUsage(char const *pchProgram)
+{
+    std::fprintf(stderr,
+        "usage: %s [--driver <path>] [--rate <RunFrame Hz>] [--duration <s>] [--config-dir <dir>]\n"
+        "          [--max-updates <n>] [--set <section>/<key>=<value>]... [--debug-request <request>]...\n"
+        "          [--verbose]\n", pchProgram);
+}
+
+} // unnamed namespace
+
+int main(int argc, char **argv)
+{
+    std::string strDriver{SPVR_TEST_HOST_DRIVER};
+    std::string strConfigDir{"."};
+    double fRate = 90.0;
+    double fDuration = 5.0;
+    std::size_t uMaxUpdates = 1u << 20;
+    bool bVerbose = false;
+    TestSettings oSettings{};
+    // sent to every device after the run, before it is deactivated
+    std::vector<std::string> vecDebugRequests{};
+    for (int iArg = 1; iArg < argc; ++iArg)
+    {
+        bool const bHasValue = iArg + 1 < argc;
+        if (std::strcmp(argv[iArg], "--driver") == 0 && bHasValue)
+        {
+            strDriver = argv[++iArg];
+        }
+        else if (std::strcmp(argv[iArg], "--rate") == 0 && bHasValue)
+        {
+            fRate = std::max(1.0, std::strtod(argv[++iArg], nullptr));
+        }
+        else if (std::strcmp(argv[iArg], "--duration") == 0 && bHasValue)
+        {
+            fDuration = std::max(0.0, std::strtod(argv[++iArg], nullptr));
+        }
+        else if (std::strcmp(argv[iArg], "--config-dir") == 0 && bHasValue)
+        {
+            strConfigDir = argv[++iArg];
+        }
+        else if (std::strcmp(argv[iArg], "--max-updates") == 0 && bHasValue)
+        {
+            uMaxUpdates = static_cast<std::size_t>(std::strtoull(argv[++iArg], nullptr, 10));
+        }
+        else if (std::strcmp(argv[iArg], "--set") == 0 && bHasValue)
+        {
+            std::string const strSetting{argv[++iArg]};
+            auto const uSlash = strSetting.find('/');
+            auto const uEquals = strSetting.find('=');
+            if (uSlash == std::string::npos || uEquals == std::string::npos || uEquals < uSlash)
+            {
+                PrintUsage(argv[0]);
+                return 1;
+            }
+            oSettings.Set(strSetting.substr(0u, uSlash), strSetting.substr(uSlash + 1u, uEquals - uSlash - 1u), strSetting.substr(uEquals + 1u));
+        }
+        else if (std::strcmp(argv[iArg], "--debug-request") == 0 && bHasValue)
+        {
+            vecDebugRequests.emplace_back(argv[++iArg]);
+        }
+        else if (std::strcmp(argv[iArg], "--verbose") == 0)
+        {
+            bVerbose = true;
+        }
+        else
+        {
+            PrintUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    try
+    {
+        DriverLibrary oLibrary{strDriver};
+        auto const pFactory = oLibrary.GetFactory();
+        int iReturnCode = vr::VRInitError_None;
+        auto *pClient = static_cast<vr::IClientTrackedDeviceProvider *>(pFactory(vr::IClientTrackedDeviceProvider_Version, &iReturnCode));
+        auto *pServer = static_cast<vr::IServerTrackedDeviceProvider *>(pFactory(vr::IServerTrackedDeviceProvider_Version, &iReturnCode));
+        if (!pClient || !pServer)
+        {
+            std::fprintf(stderr, "spvr_test_host: HmdDriverFactory failed with %d\n", iReturnCode);
+            return 1;
+        }
+
+        TestDriverLog oLog{bVerbose};
+        TestClientDriverHost oClientHost{oSettings};
+        TestServerDriverHost oServerHost{oSettings, uMaxUpdates};
+        if (pClient->Init(&oLog, &oClientHost, strConfigDir.c_str(), strConfigDir.c_str()) != vr::VRInitError_None
+            || pServer->Init(&oLog, &oServerHost, strConfigDir.c_str(), strConfigDir.c_str()) != vr::VRInitError_None)
+        {
+            std::fprintf(stderr, "spvr_test_host: the driver failed to initialize\n");
+            return 1;
+        }
+
+        // vrserver activates every device the driver announced
+        std::uint32_t uActivated = 0u;
+        for (std::uint32_t uDevice = 0u; uDevice < pServer->GetTrackedDeviceCount(); ++uDevice)
+        {
+            auto *pDevice = pServer->GetTrackedDeviceDriver(uDevice, vr::ITrackedDeviceServerDriver_Version);
+            if (pDevice && pDevice->Activate(uDevice) == vr::VRInitError_None)
+            {
+                ++uActivated;
+            }
+        }
+
+        std::vector<std::uint64_t> vecRunFrame{};
+        vecRunFrame.reserve(static_cast<std::size_t>(fRate * fDuration) + 1u);
+        auto const oPeriod = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>{1.0 / fRate});
+        auto const oStart = std::chrono::steady_clock::now();
+        auto const oEnd = oStart + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>{fDuration});
+        for (auto oNext = oStart; oNext < oEnd; oNext += oPeriod)
+        {
+            std::this_thread::sleep_until(oNext);
+            auto const uBefore = Now();
+            pServer->RunFrame();
+            vecRunFrame.push_back(Now() - uBefore);
+        }
+        auto const fElapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - oStart).count();
+
+        oServerHost.SetIsExiting();
+        std::vector<char> vecResponse(4096u);
+        for (std::uint32_t uDevice = 0u; uDevice < pServer->GetTrackedDeviceCount(); ++uDevice)
+        {
+            auto *pDevice = pServer->GetTrackedDeviceDriver(uDevice, vr::ITrackedDeviceServerDriver_Version);
+            if (pDevice)
+            {
+                for (auto const &rRequest : vecDebugRequests)
+                {
+                    vecResponse[0] = '\0';
+                    pDevice->DebugRequest(rRequest.c_str(), vecResponse.data(), static_cast<std::uint32_t>(vecResponse.size()));
+                    std::printf("device %u, debug request \"%s\":\n%s\n", uDevice, rRequest.c_str(), vecResponse.data());
+                }
+                pDevice->Deactivate();
+            }
+        }
+        pServer->Cleanup();
+        pClient->Cleanup();
+
+        auto const vecUpdates = oServerHost.GetUpdates();
+        std::vector<std::uint64_t> vecIntervals{};
+        vecIntervals.reserve(vecUpdates.size());
+        std::uint64_t uInvalid = 0u;
+        for (std::size_t i = 0; i < vecUpdates.size(); ++i)
+        {
+            if (!vecUpdates[i].m_bPoseIsValid)
+            {
+                ++uInvalid;
+            }
+            if (i > 0u && vecUpdates[i].m_uTimestampNs >= vecUpdates[i - 1u].m_uTimestampNs)
+            {
+                vecIntervals.push_back(vecUpdates[i].m_uTimestampNs - vecUpdates[i - 1u].m_uTimestampNs);
+            }
+        }
+
+        std::printf("devices added %u, activated %u, property changes %u\n",
+            oServerHost.GetDevicesAdded(), uActivated, oServerHost.GetPropertiesChanged());
+        std::printf("pose updates %llu (%.1f /s), invalid %llu, not recorded %llu\n",
+            static_cast<unsigned long long>(vecUpdates.size()),
+            fElapsed > 0.0 ? static_cast<double>(vecUpdates.size()) / fElapsed : 0.0,
+            static_cast<unsigned long long>(uInvalid),
+            static_cast<unsigned long long>(oServerHost.GetOverflowCount()));
+        PrintDistribution("pose update interval", vecIntervals);
+        PrintDistribution("RunFrame duration", vecRunFrame);
+    }
+    catch (std::exception const &e)
+    {
+        std::fprintf(stderr, "spvr_test_host: %s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
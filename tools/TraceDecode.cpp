@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2016
+ *  Somebody
+ */
+#include "TraceFormat.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+void PrintUsage(char const *pchProgram)
+{
+    std::fprintf(stderr, "usage: %s [--csv] <spvr-trace.bin>\n", pchProgram);
+}
+
+} // unnamed namespace
+
+int main(int argc, char **argv)
+{
+    bool bCsv = false;
+    char const *pchFileName = nullptr;
+    for (int iArg = 1; iArg < argc; ++iArg)
+    {
+        if (std::strcmp(argv[iArg], "--csv") == 0)
+        {
+            bCsv = true;
+        }
+        else
+        {
+            pchFileName = argv[iArg];
+        }
+    }
+    if (!pchFileName)
+    {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    std::ifstream oFile{pchFileName, std::ios::binary};
+    std::vector<char> vecData{std::istreambuf_iterator<char>{oFile}, std::istreambuf_iterator<char>{}};
+    if (vecData.size() < sizeof(spvr::TraceFileHeader))
+    {
+        std::fprintf(stderr, "%s: not a trace file\n", pchFileName);
+        return 1;
+    }
+    auto const *pHeader = reinterpret_cast<spvr::TraceFileHeader const *>(vecData.data());
+    if (std::memcmp(pHeader->m_aMagic, spvr::S_aTraceMagic, sizeof(spvr::S_aTraceMagic)) != 0
+        || pHeader->m_uVersion != spvr::S_uTraceVersion
+        || pHeader->m_uRecordSize != sizeof(spvr::TraceRecord)
+        || vecData.size() < sizeof(spvr::TraceFileHeader) + pHeader->m_uCapacity * sizeof(spvr::TraceRecord))
+    {
+        std::fprintf(stderr, "%s: unsupported trace format\n", pchFileName);
+        return 1;
+    }
+    auto const *pRecords = reinterpret_cast<spvr::TraceRecord const *>(pHeader + 1);
+    auto const uCapacity = pHeader->m_uCapacity;
+    auto const uNext = pHeader->m_uNextRecord.load();
+    auto const uFirst = uNext > uCapacity ? uNext - uCapacity : 0u;
+
+    std::uint64_t uFirstTimestamp = 0u;
+    std::uint64_t uSkipped = 0u;
+    if (bCsv)
+    {
+        std::printf("index,timestamp_ns,event,arg0,arg1\n");
+    }
+    for (auto uIndex = uFirst; uIndex < uNext; ++uIndex)
+    {
+        auto const &rRecord = pRecords[uIndex % uCapacity];
+        if (rRecord.m_uSequence.load() != static_cast<std::uint32_t>(uIndex + 1u))
+        {
+            ++uSkipped;
+            continue;
+        }
+        if (uFirstTimestamp == 0u)
+        {
+            uFirstTimestamp = rRecord.m_uTimestampNs;
+        }
+        auto const *pchEvent = spvr::GetTraceEventName(rRecord.m_eEvent);
+        if (bCsv)
+        {
+            std::printf("%llu,%llu,%s,%lld,%lld\n",
+                static_cast<unsigned long long>(uIndex), static_cast<unsigned long long>(rRecord.m_uTimestampNs),
+                pchEvent, static_cast<long long>(rRecord.m_aArgs[0]), static_cast<long long>(rRecord.m_aArgs[1]));
+        }
+        else
+        {
+            std::printf("%10llu %14.6f ms  %-16s %lld %lld\n",
+                static_cast<unsigned long long>(uIndex),
+                static_cast<double>(rRecord.m_uTimestampNs - uFirstTimestamp) * 1e-6,
+                pchEvent, static_cast<long long>(rRecord.m_aArgs[0]), static_cast<long long>(rRecord.m_aArgs[1]));
+        }
+    }
+    std::fprintf(stderr, "%llu records, %llu overwritten, %llu incomplete\n",
+        static_cast<unsigned long long>(uNext - uFirst - uSkipped),
+        static_cast<unsigned long long>(uFirst),
+        static_cast<unsigned long long>(uSkipped));
+    return 0;
+}